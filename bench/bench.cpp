@@ -0,0 +1,686 @@
+// Benchmarks of the native hot paths.
+//
+// usage: orbit_bench [--no-gpu] [--filter <text>] [--output <file>]
+//
+// Every benchmark runs once to warm up, then SAMPLES times over the same
+// number of iterations. The inputs are generated from fixed seeds, so two
+// runs, or two versions, do exactly the same work. The results are written as
+// JSON, with the times per iteration in nanoseconds.
+//
+// The GPU benchmarks need a hidden window; they're skipped with --no-gpu, or
+// when no graphics context can be created. Before they run, the CPU blitter is
+// checked against the copy shaders, and before the parser benchmarks, the
+// streaming parser against the replay of its tree; the exit status is 1 if
+// either disagrees.
+
+#include <chrono>
+#include <cstdlib>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <utility>
+#include <memory>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <algorithm>
+#include <filesystem>
+#include <string_view>
+#include <functional>
+
+#include <Orbit/Lua/runtime.h>
+#include <Orbit/Lua/castlib.h>
+#include <Orbit/Lua/random.h>
+#include <Orbit/Lua/reader.h>
+#include <Orbit/RlExt/image.h>
+#include <Orbit/RlExt/canvas.h>
+#include <Orbit/shaders.h>
+#include <Orbit/config.h>
+#include <Orbit/paths.h>
+
+#include <MobitParser/nodes.h>
+
+#include <spdlog/spdlog.h>
+#include <spdlog/sinks/null_sink.h>
+
+#include <raylib.h>
+
+namespace fs = std::filesystem;
+
+using Orbit::Lua::Rect;
+using Orbit::Lua::Quad;
+using Orbit::RlExt::Canvas;
+
+namespace {
+
+constexpr int SAMPLES = 10;
+
+struct Result {
+    std::string name;
+    size_t iterations;
+    // bytes read per iteration, for the throughput of the parsers
+    size_t bytes;
+    // nanoseconds per iteration, one for each sample
+    std::vector<double> samples;
+};
+
+struct Bench {
+    std::string filter;
+    std::vector<Result> results;
+
+    inline bool selected(const std::string &name) const {
+        return filter.empty() || name.find(filter) != std::string::npos;
+    }
+
+    // body(n) runs n iterations of the benchmark.
+    void run(const std::string &name, size_t iterations, const std::function<void(size_t)> &body, size_t bytes = 0) {
+        if (!selected(name)) return;
+
+        std::cerr << name << std::endl;
+
+        body(iterations);
+
+        Result result{ name, iterations, bytes, {} };
+
+        for (int s = 0; s < SAMPLES; s++) {
+            const auto start = std::chrono::steady_clock::now();
+            body(iterations);
+            const auto end = std::chrono::steady_clock::now();
+
+            const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+            result.samples.push_back(static_cast<double>(elapsed) / iterations);
+        }
+
+        results.push_back(std::move(result));
+    }
+};
+
+// Keeps the optimizer from dropping the work.
+volatile int64_t sink = 0;
+
+// A level file's geometry line: a matrix of cells with three layers each.
+std::string make_geometry(int width, int height) {
+    Orbit::Lua::RandomGenerator random(7);
+    std::string str = "[";
+
+    for (int x = 0; x < width; x++) {
+        str += x ? ", [" : "[";
+
+        for (int y = 0; y < height; y++) {
+            str += y ? ", [" : "[";
+
+            for (int l = 0; l < 3; l++) {
+                if (l) str += ", ";
+
+                str += '[' + std::to_string(random.next(10) < 7 ? 1 : 0) + ", [";
+                if (random.next(10) == 0) str += std::to_string(random.next(12));
+                str += "]]";
+            }
+
+            str += ']';
+        }
+
+        str += ']';
+    }
+
+    return str + ']';
+}
+
+// A level file's effects line: each effect with a matrix of amounts over the tiles.
+std::string make_effects(int count, int width, int height) {
+    Orbit::Lua::RandomGenerator random(13);
+    std::string str = "[#effects: [";
+
+    for (int i = 0; i < count; i++) {
+        str += i ? ", [#nm: \"Slime\", #mtrx: [" : "[#nm: \"Slime\", #mtrx: [";
+
+        for (int x = 0; x < width; x++) {
+            str += x ? ", [" : "[";
+
+            for (int y = 0; y < height; y++) {
+                if (y) str += ", ";
+                str += std::to_string(random.next(101));
+            }
+
+            str += ']';
+        }
+
+        str += "]]";
+    }
+
+    return str + "], #emPos: point(1, 1)]";
+}
+
+// A level file's props line: property lists, symbols, strings, points and floats.
+std::string make_props(int count) {
+    Orbit::Lua::RandomGenerator random(11);
+    std::string str = "[#props: [";
+
+    for (int i = 0; i < count; i++) {
+        if (i) str += ", ";
+
+        str += "[" + std::to_string(-random.next(30)) + ", \"Wire Bundle " + std::to_string(i) + "\", point(" +
+            std::to_string(random.next(20)) + ", " + std::to_string(random.next(60)) + "), [";
+
+        for (int p = 0; p < 4; p++) {
+            if (p) str += ", ";
+            str += "point(" + std::to_string(random.next(2000)) + "." + std::to_string(random.next(100)) + ", " +
+                std::to_string(random.next(1000)) + "." + std::to_string(random.next(100)) + ")";
+        }
+
+        str += "], [#settings: [#renderorder: 0, #seed: " + std::to_string(random.next(1000)) +
+            ", #renderTime: 0, #customDepth: " + std::to_string(random.next(10)) + "]]]";
+    }
+
+    return str + "], #lastKeys: [#L: 0, #m1: 0, #m2: 0], #Keys: [#L: 0, #m1: 0, #m2: 0], #workLayer: 1, #lstMsPs: point(0, 0), #pmPos: point(1, 1), #pmSavPosL: [], #propRotation: 0, #propStretchX: 1, #propStretchY: 1, #propFlipX: 1, #propFlipY: 1, #depth: 0, #color: 0]";
+}
+
+// A flat cast directory, like the one the runtime loads.
+fs::path make_cast(const fs::path &dir, int per_lib) {
+    static const char *libs[] = { "Internal", "customMems", "soundCast", "levelEditor", "exportBitmaps", "Drought", "Dry Editor", "MSC" };
+
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+
+    Image image = GenImageChecked(20, 20, 4, 4, BLACK, WHITE);
+
+    for (int l = 0; l < 8; l++) {
+        for (int i = 1; i <= per_lib; i++) {
+            const auto stem = std::string(libs[l]) + "_" + std::to_string(i) + "_member " + std::to_string(i);
+
+            if (i % 10 == 0) std::ofstream(dir / (stem + ".txt")) << "[#nm: \"member " << i << "\", #sz: point(20, 20)]";
+            else ExportImage(image, (dir / (stem + ".png")).string().c_str());
+        }
+    }
+
+    UnloadImage(image);
+
+    return dir;
+}
+
+// Noise over a white background, half of it translucent, so every ink has something to keep and something to drop.
+Image make_sprite(int width, int height, uint64_t seed) {
+    Orbit::Lua::RandomGenerator random(seed);
+    Image image = GenImageColor(width, height, WHITE);
+    auto *pixels = static_cast<Color *>(image.data);
+
+    for (int i = 0; i < width * height; i++) {
+        if (random.next(3) == 0) continue;
+
+        pixels[i] = Color{
+            static_cast<unsigned char>(random.next(256)),
+            static_cast<unsigned char>(random.next(256)),
+            static_cast<unsigned char>(random.next(256)),
+            static_cast<unsigned char>(random.next(2) ? 255 : 96 + random.next(160))
+        };
+    }
+
+    return image;
+}
+
+// Writes down every call a parser makes, so two passes over the same text can
+// be compared. Floats are written in hex, so they only match when they're equal.
+class Recorder : public mp::handler {
+public:
+    std::string log;
+
+    void on_void() override { log += "void\n"; }
+    void on_integer(int number) override { log += "int " + std::to_string(number) + '\n'; }
+    void on_floating(float number) override { log += "float " + hex(number) + '\n'; }
+    void on_string(std::string_view str) override { log += "string \""; log += str; log += "\"\n"; }
+    void on_symbol(std::string_view str) override { log += "symbol "; log += str; log += '\n'; }
+
+    void begin_list() override { log += "[\n"; }
+    void end_list() override { log += "]\n"; }
+
+    void on_integers(const int32_t *numbers, size_t count) override {
+        log += "ints";
+        for (size_t i = 0; i < count; i++) log += ' ' + std::to_string(numbers[i]);
+        log += '\n';
+    }
+
+    void on_floats(const float *numbers, size_t count) override {
+        log += "floats";
+        for (size_t i = 0; i < count; i++) log += ' ' + hex(numbers[i]);
+        log += '\n';
+    }
+
+    void begin_props() override { log += "[:\n"; }
+    void on_key(std::string_view key) override { log += "key "; log += key; log += '\n'; }
+    void end_props() override { log += ":]\n"; }
+
+    void begin_call(std::string_view name) override { log += "call "; log += name; log += "(\n"; }
+    void end_call() override { log += ")\n"; }
+
+private:
+    static std::string hex(float number) {
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "%a", static_cast<double>(number));
+        return buffer;
+    }
+};
+
+// Parses every input straight off the lexer and by replaying its tree, and
+// returns the number of inputs where the two disagree.
+int verify_parser(const std::vector<std::pair<const char *, std::string_view>> &inputs) {
+    int failed = 0;
+
+    for (const auto &[name, input] : inputs) {
+        Recorder streamed, replayed;
+
+        mp::parse(input, streamed);
+        mp::parse(mp::parse(input), replayed);
+
+        if (streamed.log != replayed.log) {
+            const auto [a, b] = std::mismatch(streamed.log.begin(), streamed.log.end(), replayed.log.begin(), replayed.log.end());
+            const auto line = std::count(streamed.log.begin(), a, '\n') + 1;
+
+            std::cerr << "parser/verify: " << name << ": the streaming parser and the tree differ at call " << line << std::endl;
+            failed++;
+        }
+    }
+
+    return failed;
+}
+
+// Runs every ink through both blitters, with and without blend, color and mask,
+// and returns the number of cases where a pixel differs by more than the
+// rounding of the shaders.
+//
+// The source has odd dimensions so no destination pixel samples exactly between
+// two texels, where either neighbour would be right.
+int verify_copies() {
+    constexpr int TOLERANCE = 2;
+
+    const Rect from(0, 0, 31, 31);
+    const Rect to(5, 3, 55, 48);
+    const Quad quad(Vector2{ 4, 2 }, Vector2{ 60, 8 }, Vector2{ 55, 58 }, Vector2{ 1, 50 });
+
+    const std::pair<Orbit::RlExt::CopyImageInk, const char *> inks[] = {
+        { Orbit::RlExt::CopyImageInk::None, "none" },
+        { Orbit::RlExt::CopyImageInk::TransparentBackground, "transparent" },
+        { Orbit::RlExt::CopyImageInk::Darkest, "darkest" },
+    };
+
+    Orbit::Shaders shaders;
+    Image src = make_sprite(32, 32, 17);
+    Image dst = make_sprite(64, 64, 19);
+    Canvas source(ImageCopy(src));
+    Canvas mask(GenImageChecked(31, 31, 3, 3, WHITE, BLACK));
+
+    int failed = 0;
+
+    for (const auto &[ink, ink_name] : inks) {
+        for (int variant = 0; variant < 8; variant++) {
+            const bool quads = variant & 1;
+            const bool tinted = variant & 2;
+            const bool masked = variant & 4;
+
+            Orbit::RlExt::CopyImageParams params;
+            params.ink = ink;
+
+            if (tinted) {
+                params.blend = 0.5f;
+                params.color = Color{ 200, 40, 90, 255 };
+            }
+
+            if (masked) params.mask = &mask;
+
+            Image cpu = ImageCopy(dst);
+            Canvas gpu(ImageCopy(dst));
+
+            if (quads) {
+                Orbit::RlExt::CopyImage_CPU(&src, &cpu, &from, &quad, params);
+                Orbit::RlExt::CopyImage_GPU(&shaders.invb_copy_pixels, &source, &gpu, &from, &quad, params);
+            } else {
+                Orbit::RlExt::CopyImage_CPU(&src, &cpu, &from, &to, params);
+                Orbit::RlExt::CopyImage_GPU(&shaders.copy_pixels, &source, &gpu, &from, &to, params);
+            }
+
+            const auto *a = static_cast<const Color *>(cpu.data);
+            const auto *b = static_cast<const Color *>(gpu.pixels().data);
+            int mismatches = 0, worst = 0;
+
+            for (int i = 0; i < cpu.width * cpu.height; i++) {
+                const int difference = std::max({
+                    std::abs(a[i].r - b[i].r),
+                    std::abs(a[i].g - b[i].g),
+                    std::abs(a[i].b - b[i].b),
+                    std::abs(a[i].a - b[i].a)
+                });
+
+                worst = std::max(worst, difference);
+                if (difference > TOLERANCE) mismatches++;
+            }
+
+            if (mismatches > 0) {
+                std::cerr << "copy/verify: " << ink_name << (quads ? " quad" : " rect") << (tinted ? " tinted" : "") << (masked ? " masked" : "")
+                    << ": " << mismatches << " pixels differ, by up to " << worst << std::endl;
+                failed++;
+            }
+
+            UnloadImage(cpu);
+        }
+    }
+
+    UnloadImage(src);
+    UnloadImage(dst);
+
+    return failed;
+}
+
+const char *SCRIPT = R"(
+local q = quad(point(0, 0), point(40, 2), point(38, 41), point(1, 39))
+local img
+
+function geometry()
+  local t = 0
+  for i = 1, 1000 do
+    local p = point(i, 2) + point(1, i) * 2
+    local r = rect(0, 0, i, 5) + rect(1, 1, 1, 1)
+    local m = mix(p, point(10, 10), 0.25)
+    local rq = rotate(q, i % 360)
+    t = t + r.width + m.x + distance(p, m) + rq.topleft.y
+  end
+  return t
+end
+
+function from_lingo()
+  local props = fromLingo(PROPS)
+  local geometry = fromLingo(GEOMETRY)
+end
+
+function from_lingo_effects()
+  local effects = fromLingo(EFFECTS)
+end
+
+local values
+
+function to_lingo()
+  if values == nil then values = { fromLingo(PROPS), fromLingo(GEOMETRY) } end
+  local props = toLingo(values[1])
+  local geometry = toLingo(values[2])
+end
+
+-- A level's geometry matrix, 72x43 cells of 3 layers, as tables and as an array
+local cells
+
+function matrix_tables()
+  if cells == nil then
+    cells = {}
+    for x = 1, 72 do
+      cells[x] = {}
+      for y = 1, 43 do cells[x][y] = { 0, 0, 0 } end
+    end
+  end
+  local solid = 0
+  for x = 1, 72 do
+    for y = 1, 43 do
+      local cell = cells[x][y]
+      for l = 1, 3 do
+        local v = cell[l] + x % 3
+        if v > 9 then v = 9 end
+        cell[l] = v
+        if v == 1 then solid = solid + 1 end
+      end
+    end
+  end
+  return solid
+end
+
+local matrix = array("int8", 72, 43, 3)
+
+function matrix_arrays()
+  local solid = 0
+  for x = 1, 72 do
+    matrix[x]:map("+", x % 3):map("min", 9)
+    solid = solid + matrix[x]:count(1)
+  end
+  return solid
+end
+
+function silhouettes()
+  if img == nil then
+    img = image(128, 128)
+    img:copyPixels(image(64, 64), rect(0, 0, 64, 64), rect(0, 0, 64, 64))
+  end
+  for i = 1, 10 do
+    local s = img:silhouette(i % 2 == 0)
+  end
+end
+)";
+
+void write_json(std::ostream &out, const std::vector<Result> &results, bool gpu) {
+    out << std::fixed << std::setprecision(1);
+    out << "{\n  \"version\": \"" << APP_VERSION << "\",\n  \"gpu\": " << (gpu ? "true" : "false") << ",\n  \"benchmarks\": [";
+
+    for (size_t i = 0; i < results.size(); i++) {
+        const auto &r = results[i];
+
+        auto sorted = r.samples;
+        std::sort(sorted.begin(), sorted.end());
+
+        double mean = 0;
+        for (double s : sorted) mean += s;
+        mean /= sorted.size();
+
+        out << (i ? ",\n" : "\n") << "    { \"name\": \"" << r.name << "\", \"iterations\": " << r.iterations
+            << ", \"samples\": " << sorted.size()
+            << ", \"mean_ns\": " << mean
+            << ", \"median_ns\": " << sorted[sorted.size() / 2]
+            << ", \"min_ns\": " << sorted.front()
+            << ", \"max_ns\": " << sorted.back();
+
+        // bytes per nanosecond, times 1000
+        if (r.bytes > 0) out << ", \"median_mb_per_s\": " << r.bytes * 1e3 / sorted[sorted.size() / 2];
+
+        out << " }";
+    }
+
+    out << "\n  ]\n}\n";
+}
+
+};
+
+int main(int argc, char **argv) {
+    Bench bench;
+    bool gpu = true;
+    int failed = 0;
+    fs::path output;
+
+    for (int i = 1; i < argc; i++) {
+        const std::string arg(argv[i]);
+
+        if (arg == "--no-gpu") gpu = false;
+        else if (arg == "--filter" && i + 1 < argc) bench.filter = argv[++i];
+        else if (arg == "--output" && i + 1 < argc) output = argv[++i];
+        else {
+            std::cerr << "usage: orbit_bench [--no-gpu] [--filter <text>] [--output <file>]" << std::endl;
+            return 1;
+        }
+    }
+
+    SetTraceLogLevel(LOG_WARNING);
+
+    if (gpu) {
+        SetConfigFlags(FLAG_WINDOW_HIDDEN);
+        InitWindow(64, 64, "orbit_bench");
+        gpu = IsWindowReady();
+    }
+
+    // Native
+
+    bench.run("random/next", 1000000, [](size_t n) {
+        Orbit::Lua::RandomGenerator random(1234);
+        int64_t total = 0;
+        for (size_t i = 0; i < n; i++) total += random.next(1000);
+        sink = total;
+    });
+
+    const auto geometry = make_geometry(72, 43);
+    const auto props = make_props(200);
+    const auto effects = make_effects(4, 72, 43);
+
+    // Literals the generated files don't have: strings, negative and unary values,
+    // global calls and empty collections
+    const std::string literals = "[#nm: \"a [b] \" & QUOTE & \"c\", #n: -3, #f: -2.5, #x: -point(1, 2), #l: [], #p: [:], "
+        "#r: rect(1, 2.5, 3, 4), #c: color(255, 0, 0), #v: VOID, #m: [[1, 2.0], [-1, 3]], #s: [#a, #b, \"c\"]]";
+
+    if (bench.selected("parser/verify")) {
+        failed += verify_parser({ { "geometry", geometry }, { "props", props }, { "effects", effects }, { "literals", literals } });
+    }
+
+    bench.run("parser/tokenize", 20, [&](size_t n) {
+        for (size_t i = 0; i < n; i++) sink = sink + mp::tokenize_view(geometry).size() + mp::tokenize_view(props).size();
+    }, geometry.size() + props.size());
+
+    bench.run("parser/geometry", 5, [&](size_t n) {
+        for (size_t i = 0; i < n; i++) sink = sink + !mp::parse(geometry).empty();
+    });
+
+    bench.run("parser/props", 20, [&](size_t n) {
+        for (size_t i = 0; i < n; i++) sink = sink + !mp::parse(props).empty();
+    });
+
+    bench.run("parser/effects", 20, [&](size_t n) {
+        for (size_t i = 0; i < n; i++) sink = sink + !mp::parse(effects).empty();
+    });
+
+    // A project file is a few of both, a line each
+    const auto project = fs::temp_directory_path() / "orbit_bench_project.txt";
+    std::ofstream(project) << geometry << "\r\n" << props << "\r\n" << geometry << "\r\n" << props << "\r\n";
+
+    bench.run("parser/read_lingo_file", 3, [&](size_t n) {
+        for (size_t i = 0; i < n; i++) sink = sink + Orbit::Lua::read_lingo_file(project).size();
+    }, fs::file_size(project));
+
+    fs::remove(project);
+
+    const auto cast = make_cast(fs::temp_directory_path() / "orbit_bench_cast", 250);
+
+    bench.run("castlib/load_members", 3, [&](size_t n) {
+        for (size_t i = 0; i < n; i++) {
+            std::vector<Orbit::Lua::CastLib> libs;
+            std::vector<Orbit::Lua::CastLib *> loading;
+            const char *names[] = { "Internal", "customMems", "soundCast", "levelEditor", "exportBitmaps", "Drought", "Dry Editor", "MSC" };
+
+            libs.reserve(8);
+            for (int l = 0; l < 8; l++) {
+                libs.emplace_back(Orbit::Lua::CastLib::OFFSET * l, names[l]);
+                loading.push_back(&libs.back());
+            }
+
+            Orbit::Lua::CastLib::load_members(cast, loading);
+            sink = sink + libs.back().members().size();
+        }
+    });
+
+    fs::remove_all(cast);
+
+    {
+        const Rect from(0, 0, 128, 128);
+        const Rect to(10, 20, 200, 180);
+        const Quad quad(Vector2{ 10, 20 }, Vector2{ 220, 5 }, Vector2{ 200, 230 }, Vector2{ 3, 190 });
+
+        Orbit::RlExt::CopyImageParams params;
+        params.ink = Orbit::RlExt::CopyImageInk::TransparentBackground;
+
+        Image src = GenImageChecked(128, 128, 8, 8, WHITE, RED);
+        Image dst = GenImageColor(256, 256, BLUE);
+
+        bench.run("copy/cpu_rect", 200, [&](size_t n) {
+            for (size_t i = 0; i < n; i++) Orbit::RlExt::CopyImage_CPU(&src, &dst, &from, &to, params);
+        });
+
+        bench.run("copy/cpu_quad", 200, [&](size_t n) {
+            for (size_t i = 0; i < n; i++) Orbit::RlExt::CopyImage_CPU(&src, &dst, &from, &quad, params);
+        });
+
+        UnloadImage(dst);
+
+        if (gpu) {
+            if (bench.selected("copy/verify")) failed += verify_copies();
+
+            Orbit::Shaders shaders;
+            Canvas source(GenImageChecked(128, 128, 8, 8, WHITE, RED));
+            Canvas target(256, 256);
+
+            // Reading the pixels back waits for the GPU to be done with the copies
+            bench.run("copy/gpu_rect", 1000, [&](size_t n) {
+                for (size_t i = 0; i < n; i++) Orbit::RlExt::CopyImage_GPU(&shaders.copy_pixels, &source, &target, &from, &to, params);
+                sink = sink + target.pixels().width;
+            });
+
+            bench.run("copy/gpu_quad", 1000, [&](size_t n) {
+                for (size_t i = 0; i < n; i++) Orbit::RlExt::CopyImage_GPU(&shaders.invb_copy_pixels, &source, &target, &from, &quad, params);
+                sink = sink + target.pixels().width;
+            });
+        }
+
+        UnloadImage(src);
+    }
+
+    // Through the scripts
+
+    {
+        auto paths = std::make_shared<Orbit::Paths>();
+        auto logger = spdlog::create<spdlog::sinks::null_sink_mt>("bench");
+        auto config = std::make_shared<Orbit::Config>();
+        auto shaders = gpu ? std::make_shared<Orbit::Shaders>() : nullptr;
+
+        const auto script = fs::temp_directory_path() / "orbit_bench.lua";
+        std::ofstream(script) << SCRIPT << "PROPS = [==[" << props << "]==]\nGEOMETRY = [==[" << geometry << "]==]\nEFFECTS = [==[" << effects << "]==]\n";
+
+        Orbit::Lua::LuaRuntime runtime(64, 64, paths, logger, shaders, config);
+        runtime.load_file(script);
+
+        fs::remove(script);
+
+        // An iteration is a call into the script, which loops on its own
+        bench.run("lua/geometry", 20, [&](size_t n) {
+            runtime.set_entry("geometry");
+            for (size_t i = 0; i < n; i++) runtime.process_frame();
+        });
+
+        bench.run("lua/from_lingo", 5, [&](size_t n) {
+            runtime.set_entry("from_lingo");
+            for (size_t i = 0; i < n; i++) runtime.process_frame();
+        });
+
+        bench.run("lua/from_lingo_effects", 5, [&](size_t n) {
+            runtime.set_entry("from_lingo_effects");
+            for (size_t i = 0; i < n; i++) runtime.process_frame();
+        });
+
+        bench.run("lua/to_lingo", 5, [&](size_t n) {
+            runtime.set_entry("to_lingo");
+            for (size_t i = 0; i < n; i++) runtime.process_frame();
+        });
+
+        bench.run("lua/matrix_tables", 100, [&](size_t n) {
+            runtime.set_entry("matrix_tables");
+            for (size_t i = 0; i < n; i++) runtime.process_frame();
+        });
+
+        bench.run("lua/matrix_arrays", 100, [&](size_t n) {
+            runtime.set_entry("matrix_arrays");
+            for (size_t i = 0; i < n; i++) runtime.process_frame();
+        });
+
+        bench.run("lua/silhouette", 20, [&](size_t n) {
+            runtime.set_entry("silhouettes");
+            for (size_t i = 0; i < n; i++) runtime.process_frame();
+        });
+    }
+
+    if (gpu) CloseWindow();
+
+    if (output.empty()) {
+        write_json(std::cout, bench.results, gpu);
+    } else {
+        std::ofstream out(output);
+        write_json(out, bench.results, gpu);
+    }
+
+    return failed ? 1 : 0;
+}
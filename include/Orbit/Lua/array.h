@@ -0,0 +1,99 @@
+#pragma once
+
+#include <array>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+#include <string_view>
+
+namespace Orbit::Lua {
+
+// An N-dimensional array of numbers of one type, for the bulk data of the
+// scripts like the level matrices.
+//
+// The elements live packed in a buffer that's shared with the arrays taken
+// out of it, so indexing and slicing make views instead of copies. A view is
+// an offset, a shape and strides, in elements, over the buffer; the last
+// dimension is walked in runs, and runs of adjacent elements are worked on in
+// SIMD batches.
+//
+// Numbers stored in integer arrays are truncated, and clamped to the range of
+// the type; the operands of map are too, but its results wrap around, the way
+// the integers of the type do.
+class Array {
+
+public:
+
+	enum class Type : uint8_t { Int8, Int16, Int32, Float32 };
+
+	enum class Op : uint8_t { Add, Subtract, Multiply, Divide, Min, Max };
+
+	static constexpr int MAX_DIMENSIONS = 4;
+	// 256M elements
+	static constexpr size_t MAX_SIZE = size_t(1) << 28;
+
+private:
+
+	std::shared_ptr<char[]> _storage;
+	Type _type;
+	int _dimensions;
+	size_t _offset;
+	std::array<size_t, MAX_DIMENSIONS> _shape;
+	std::array<size_t, MAX_DIMENSIONS> _strides;
+
+	template <typename T>
+	inline T *_data() const { return reinterpret_cast<T *>(_storage.get()) + _offset; }
+
+	// The number of runs of the last dimension, and where one starts.
+	size_t _runs() const;
+	size_t _run(size_t run) const;
+
+	template <typename T, typename F>
+	void _each_run(F &&fn) const;
+
+	template <typename T> void _fill(double value);
+	template <typename T> void _map(Op op, double value);
+	template <typename T> size_t _count(double value) const;
+	template <typename T> double _sum() const;
+	template <typename T, typename U> void _copy(const Array &from);
+
+public:
+
+	static size_t type_size(Type);
+	static const char *type_name(Type);
+	// Returns false if there's no type of that name.
+	static bool find_type(std::string_view name, Type &type);
+
+	inline Type type() const { return _type; }
+	inline int dimensions() const { return _dimensions; }
+	inline size_t shape(int dimension) const { return _shape[dimension]; }
+	size_t size() const;
+
+	// Whether the elements are adjacent in the buffer, in order.
+	bool contiguous() const;
+	bool same_shape(const Array &) const;
+
+	// The element at the indexes, one per dimension, starting at 0.
+	double get(const size_t *indexes) const;
+	void set(const size_t *indexes, double value);
+
+	// The array of the other dimensions at the index of the first one.
+	Array at(size_t index) const;
+	// Every step-th index of the first dimension, from first up to last.
+	Array slice(size_t first, size_t last, size_t step = 1) const;
+	// A contiguous copy, with a buffer of its own.
+	Array clone() const;
+
+	void fill(double value);
+	// Copies the elements of an array of the same shape, converting them.
+	void copy(const Array &from);
+	// Applies the operation with the value to every element, in place.
+	void map(Op op, double value);
+	size_t count(double value) const;
+	double sum() const;
+
+	Array(Type type, const size_t *shape, int dimensions);
+
+};
+
+};
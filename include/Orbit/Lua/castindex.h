@@ -0,0 +1,78 @@
+#pragma once
+
+#include <filesystem>
+#include <cstdint>
+#include <vector>
+#include <string>
+
+namespace Orbit::Lua {
+
+// The cast members found in a directory, persisted in a binary file so that
+// warm starts neither list the directory nor parse the file names again.
+//
+// Entries are validated against the size and modification time of their file,
+// and only the ones that changed are scanned again. The directory itself is
+// only listed when its own modification time changes.
+class CastIndex {
+
+public:
+
+	struct Entry {
+		std::string filename, lib, name;
+		int id, width, height;
+		int64_t mtime;
+		uint64_t size;
+	};
+
+	// Where the names of an entry are in the string table of an index or pack
+	// file. Library and member names are slices of the file name.
+	struct Names {
+		uint32_t filename, filename_length;
+		uint32_t lib_length;
+		uint32_t name_start, name_length;
+
+		// Appends the file name of the entry to the string table.
+		static Names append(const Entry &, std::string &strings);
+
+		// Whether the slices fit in a string table of the given size.
+		bool valid(size_t strings) const;
+
+		void read(const char *strings, std::string &filename, std::string &lib, std::string &name) const;
+	};
+
+	// A modification time, the way index and pack files store them.
+	static int64_t stamp(std::filesystem::file_time_type);
+
+private:
+
+	std::filesystem::path _dir, _file;
+	// sorted by file name
+	std::vector<Entry> _entries;
+	int64_t _dir_mtime;
+	bool _dirty;
+	size_t _reused, _rescanned;
+
+	bool _read();
+
+public:
+
+	static const uint32_t VERSION = 1;
+
+	inline const auto &dir() const { return _dir; }
+	inline const auto &entries() const { return _entries; }
+	inline int64_t dir_mtime() const { return _dir_mtime; }
+	inline size_t reused() const { return _reused; }
+	inline size_t rescanned() const { return _rescanned; }
+
+	// Brings the entries up to date with the directory.
+	void update();
+
+	// Writes the index file back if anything changed since it was read.
+	void save();
+
+	// An empty file path keeps the index in memory only.
+	CastIndex(const std::filesystem::path &dir, const std::filesystem::path &file = {});
+
+};
+
+};
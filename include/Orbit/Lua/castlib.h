@@ -1,21 +1,29 @@
 #pragma once
 
 #include <Orbit/hash.h>
+#include <Orbit/RlExt/canvas.h>
+#include <Orbit/Lua/castpack.h>
 
 #include <unordered_map>
+#include <functional>
 #include <filesystem>
 #include <algorithm>
 #include <memory>
+#include <list>
 #include <vector>
 #include <string>
 #include <regex>
 
 #include <raylib.h>
 
+struct lua_State;
+
 namespace Orbit::Lua {
 
 extern const std::regex CAST_MEMBER_NAME_PATTERN;
 
+class CastIndex;
+
 class CastMember {
 
 	// bool _loaded;
@@ -25,9 +33,19 @@ public:
 	int id;
 	std::string name;
 	std::filesystem::path path;
+	// read from the PNG header; zero for text members
+	int width, height;
+	// set when the member comes from a cast pack instead of a loose file
+	const CastPack *pack;
+	const CastPack::Entry *packed;
 	// Image image;
 	// std::string text;
 
+	// Decodes the image; the caller owns it.
+	Image load_image() const;
+	// Throws std::runtime_error if the text can't be read.
+	std::string load_text() const;
+
 	// void load();
 	// void unload();
 	// inline void reload() { unload(); load(); }
@@ -37,8 +55,9 @@ public:
 
 	CastMember(CastMember &&) noexcept;
 	CastMember(const CastMember &) = delete;
+	// Parses the file name and reads the image dimensions.
 	CastMember(const std::filesystem::path &);
-	CastMember(int, const std::string &, const std::filesystem::path &, Image);
+	CastMember(int id, const std::string &name, const std::filesystem::path &, int width, int height);
 
 	~CastMember();
 };
@@ -49,6 +68,9 @@ class CastLib {
 	std::string _name;
 	std::vector<std::shared_ptr<CastMember>> _members;
 	std::unordered_map<std::string, std::shared_ptr<CastMember>, CaseInsensitiveHash, CaseInsensitiveEqual> _names;
+
+	// by id; duplicates keep their load order
+	static void _sort_members(const std::vector<CastLib *> &);
 	
 public:
 
@@ -70,6 +92,16 @@ public:
 
 	// Load all members from a given directory.
 	void load_members(const std::filesystem::path &);
+
+	// Load the members of several libraries with a single scan of the directory.
+	// Members are parsed in parallel, but the result doesn't depend on the scheduling.
+	static void load_members(const std::filesystem::path &, const std::vector<CastLib *> &);
+
+	// Same as above, from an index that is already up to date.
+	static void load_members(const CastIndex &, const std::vector<CastLib *> &);
+
+	// Same as above, from a cast pack. The pack must outlive the members.
+	static void load_members(const CastPack &, const std::vector<CastLib *> &);
 	CastLib &operator<<(const std::filesystem::path &);
 
 	CastLib(CastLib &&) noexcept;
@@ -79,4 +111,57 @@ public:
 	~CastLib();
 };
 
+// Keeps the decoded images and the text of recently used cast members, up to a memory budget.
+//
+// A member's image is handed out as the same userdata on every lookup, so what a script
+// draws into it is the member's image from then on, like in Director. The canvas borrows
+// the decoded pixels and only gets its own copy once it's written to; a written image is
+// pinned, since dropping it would lose the changes, and the decoded pixels are let go.
+// The least recently used members that weren't written to are released first.
+class CastMemberCache {
+
+	struct Entry {
+		const CastMember *member;
+		// the decoded image as it is on disk; null for text members, and once
+		// the canvas was written to
+		std::shared_ptr<const Image> pixels;
+		// registry reference to the text, or to the canvas of the image
+		int ref;
+		const Orbit::RlExt::Canvas *canvas;
+		// the version of the canvas when it was made
+		unsigned version;
+		size_t bytes;
+	};
+
+	size_t _budget, _size;
+	std::list<Entry> _entries;
+	std::unordered_map<const CastMember *, std::list<Entry>::iterator> _lookup;
+
+	// Moves the entry to the front if it's resident.
+	Entry *_find(const CastMember &);
+	Entry &_insert(const CastMember &, std::shared_ptr<const Image>, int ref, size_t bytes);
+	// Whether the image was written to, and thus pinned.
+	bool _written(Entry &);
+	void _evict(lua_State *);
+
+public:
+
+	// Called right before decoded pixels are unloaded, i.e. to forget where they're packed.
+	std::function<void(const Image *)> on_unload;
+
+	inline size_t size() const { return _size; }
+	inline size_t budget() const { return _budget; }
+	inline size_t count() const { return _entries.size(); }
+
+	// Pushes the image of the member, decoding it if it isn't resident.
+	// Pushes nil if the file can't be decoded.
+	void push_image(lua_State *, const CastMember &);
+
+	// Pushes the text of the member, reading it if it isn't resident.
+	// Throws std::runtime_error if the text can't be read.
+	void push_text(lua_State *, const CastMember &);
+
+	CastMemberCache(size_t budget);
 };
+
+};
\ No newline at end of file
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <Orbit/io.h>
+
+#include <filesystem>
+#include <string_view>
+#include <cstdint>
+#include <vector>
+#include <string>
+
+#include <raylib.h>
+
+namespace Orbit::Lua {
+
+class CastIndex;
+
+// The whole cast in a single file, memory-mapped.
+//
+// Images are stored as decoded RGBA8 pixels, or as their original PNG when the
+// pack was built compressed. Text members are stored inline. Either way, reading
+// a member never touches the file system.
+class CastPack {
+
+public:
+
+	enum class Kind : uint32_t { Image = 0, Text = 1 };
+	enum class Encoding : uint32_t { Raw = 0, Png = 1 };
+
+	struct Entry {
+		std::string filename, lib, name;
+		int id, width, height;
+		Kind kind;
+		Encoding encoding;
+		// where the stored bytes are in the file
+		uint64_t offset, size;
+		// the loose file the member was packed from, as it was then
+		int64_t source_mtime;
+		uint64_t source_size;
+	};
+
+private:
+
+	MappedFile _file;
+	std::filesystem::path _dir;
+	// sorted by file name
+	std::vector<Entry> _entries;
+	int64_t _dir_mtime;
+
+public:
+
+	static const uint32_t VERSION = 2;
+
+	// The directory the members were packed from; member paths are resolved against it.
+	inline const auto &dir() const { return _dir; }
+	inline const auto &entries() const { return _entries; }
+
+	// The stored bytes of a member, straight out of the mapping.
+	std::string_view bytes(const Entry &) const;
+
+	// Returns a new RGBA8 image owned by the caller.
+	Image image(const Entry &) const;
+
+	// Whether the loose files changed since the pack was built: a member's file
+	// is newer, resized or gone, or files were added to the directory.
+	// A pack shipped without its directory is never stale.
+	bool stale() const;
+
+	// Writes every member of the index into a pack file.
+	// When compress is true, images keep their PNG encoding instead of being decoded.
+	static void build(const CastIndex &, const std::filesystem::path &file, bool compress);
+
+	// Throws std::runtime_error if the file isn't a valid pack.
+	CastPack(const std::filesystem::path &file, const std::filesystem::path &dir);
+
+};
+
+};
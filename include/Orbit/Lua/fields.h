@@ -0,0 +1,116 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <stdexcept>
+#include <string_view>
+
+extern "C" {
+    #include <lua.h>
+    #include <lauxlib.h>
+}
+
+namespace Orbit::Lua {
+
+// Field names of a userdata type, looked up with a perfect hash.
+//
+// The hash seed is searched at compile time so that every name lands in a
+// slot of its own; a lookup is then one hash and one comparison, instead of
+// comparing the key against the names one by one.
+//
+// The index of a name is a constant expression, so __index and __newindex
+// can switch over it:
+//
+//	constexpr auto FIELDS = fields("x", "y");
+//
+//	switch (FIELDS.find(L, 2)) {
+//		case FIELDS["x"]: ...
+//		case FIELDS["y"]: ...
+//		default: ...
+//	}
+
+// FNV-1a, folded so that the slots can be taken from the low bits
+constexpr uint32_t field_hash(std::string_view name, uint32_t seed) {
+	uint32_t hash = 2166136261u ^ seed;
+
+	for (char c : name) {
+		hash ^= static_cast<unsigned char>(c);
+		hash *= 16777619u;
+	}
+
+	// The low bits alone only depend on the low bits of each character
+	return hash ^ (hash >> 16);
+}
+
+template <size_t N>
+class FieldSet {
+
+	static_assert(N > 0 && N < 255, "too many fields");
+
+	// Smallest power of two with at least twice as many slots as names
+	static constexpr size_t SLOTS = [] {
+		size_t slots = 1;
+		while (slots < N * 2) slots *= 2;
+		return slots;
+	}();
+
+	std::array<std::string_view, N> _names;
+	// index of the name in each slot, plus one; zero for empty slots
+	std::array<uint8_t, SLOTS> _slots;
+	uint32_t _seed;
+
+	constexpr size_t _slot(std::string_view name) const {
+		return field_hash(name, _seed) & (SLOTS - 1);
+	}
+
+public:
+
+	// Returns the index of the name, or -1 if it's not in the set.
+	constexpr int find(std::string_view name) const {
+		const int index = static_cast<int>(_slots[_slot(name)]) - 1;
+
+		return (index >= 0 && _names[index] == name) ? index : -1;
+	}
+
+	// Same as find(), with the string at the stack index as the name.
+	inline int find(lua_State *L, int index) const {
+		size_t length = 0;
+		const char *name = luaL_checklstring(L, index, &length);
+
+		return find(std::string_view(name, length));
+	}
+
+	// The index of a name that must be in the set; fails to compile if it isn't.
+	constexpr int operator[](std::string_view name) const {
+		const int index = find(name);
+
+		if (index < 0) throw std::logic_error("field is not in the set");
+
+		return index;
+	}
+
+	constexpr FieldSet(const std::array<std::string_view, N> &names) : _names(names), _slots({}), _seed(0) {
+		for (;; _seed++) {
+			bool placed = true;
+			_slots = {};
+
+			for (size_t i = 0; i < N && placed; i++) {
+				auto &slot = _slots[_slot(_names[i])];
+
+				if (slot != 0) placed = false;
+				else slot = static_cast<uint8_t>(i + 1);
+			}
+
+			if (placed) break;
+		}
+	}
+
+};
+
+template <typename... Names>
+constexpr FieldSet<sizeof...(Names)> fields(Names... names) {
+	return FieldSet<sizeof...(Names)>({ std::string_view(names)... });
+}
+
+};
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <cstddef>
+
+namespace Orbit::Lua {
+
+// The allocator of the Lua state.
+//
+// The scripts make and drop temporary points, rects, quads and colors by the
+// million, and each of them is a small block of its own, next to the strings,
+// tables and closures that are just as small. Blocks of up to MAX_SIZE bytes
+// are rounded up to a multiple of GRANULE and served from a free list per
+// size; the lists are carved out of large slabs, and collected blocks go back
+// to their list, so the system allocator only sees the slabs and the larger
+// blocks.
+//
+// The slabs are only given back when the pool is destroyed, which has to be
+// after the state is closed.
+class Pool {
+
+public:
+
+	static constexpr size_t GRANULE = 16;
+	static constexpr size_t MAX_SIZE = 256;
+	static constexpr size_t SLAB_SIZE = 64 << 10;
+
+	// Counted since the last reset, by both allocators.
+	struct Stats {
+		size_t allocations, frees;
+		// requested by allocations and growing reallocations
+		size_t bytes;
+	};
+
+	Stats stats;
+
+private:
+
+	static constexpr size_t CLASSES = MAX_SIZE / GRANULE;
+
+	struct Slot { Slot *next; };
+
+	std::array<Slot *, CLASSES> _free;
+	std::vector<char *> _slabs;
+	// the part of the last slab that hasn't been handed out yet
+	char *_cursor, *_end;
+	// held by the state
+	size_t _in_use;
+
+	static constexpr size_t _class(size_t size) { return (size - 1) / GRANULE; }
+
+	void *_carve(size_t size_class);
+
+	void _count(void *block, size_t old_size, size_t new_size);
+
+public:
+
+	// Bytes held by the state; Lua's own count, without the rounding.
+	inline size_t in_use() const { return _in_use; }
+	// Bytes taken from the system for the slabs.
+	inline size_t reserved() const { return _slabs.size() * SLAB_SIZE; }
+
+	void *allocate(size_t size);
+	void deallocate(void *block, size_t size);
+	void *reallocate(void *block, size_t old_size, size_t new_size);
+
+	// A lua_Alloc, with the pool as its user data.
+	static void *lua_alloc(void *pool, void *block, size_t old_size, size_t new_size);
+	// A lua_Alloc that goes straight to the system allocator, and only keeps
+	// the statistics of the pool.
+	static void *lua_system_alloc(void *pool, void *block, size_t old_size, size_t new_size);
+
+	Pool &operator=(const Pool &) = delete;
+	Pool(const Pool &) = delete;
+
+	Pool();
+	~Pool();
+
+};
+
+};
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <filesystem>
+#include <vector>
+
+#include <MobitParser/nodes.h>
+
+namespace Orbit::Lua {
+
+// Maps a project file and parses its top-level lines (the sections
+// mp::split_sections finds) independently, over the available hardware threads.
+//
+// Returns a tree per section, in order; the trees of empty lines are empty.
+// Throws std::runtime_error if the file can't be read, or with the line the
+// first invalid section starts on.
+std::vector<mp::tree> read_lingo_file(const std::filesystem::path &);
+
+};
@@ -7,6 +7,10 @@
 #include <unordered_map>
 
 #include <Orbit/Lua/castlib.h>
+#include <Orbit/Lua/pool.h>
+#include <Orbit/Lua/sampler.h>
+#include <Orbit/RlExt/atlas.h>
+#include <Orbit/RlExt/drawqueue.h>
 #include <Orbit/Lua/random.h>
 #include <Orbit/hash.h>
 #include <Orbit/paths.h>
@@ -32,13 +36,25 @@ class LuaRuntime {
 private:
 
 	int _width, _height;
-	bool _redraw;
+	bool _redraw, _halted;
 	std::string _entry, _init;
+	std::filesystem::path _output;
+	// the members of the cast libraries point into it
+	std::unique_ptr<CastPack> _cast_pack;
 	std::vector<std::shared_ptr<CastLib>> _castlibs;
 	std::unordered_map<std::string, std::shared_ptr<CastMember>> _castmembers;
 	std::unordered_map<std::string, std::shared_ptr<CastLib>, CaseInsensitiveHash, CaseInsensitiveEqual> _castlib_names;
     
+	// allocates for the state, so it has to outlive it
+	Pool _pool;
 	lua_State *L;
+	Sampler _sampler;
+	// the pieces of the warning being built, and whether warn() is on
+	std::string _warning;
+	bool _warnings;
+
+	// The warning function of the state; logs what warn() is given.
+	static void _warn(void *runtime, const char *message, int to_continue);
 
 	void _register_point();
 	void _register_vector();
@@ -46,6 +62,7 @@ private:
 	void _register_rectangle();
 	void _register_quad();
 	void _register_image();
+	void _register_array();
 	void _register_utils();
 	void _register_lingo_api();
 	void _register_xtra();
@@ -54,6 +71,9 @@ private:
 	void _register_lib();
 
 	void _load_cast_libs();
+
+	// Logs the allocations made by the state since its stats were last reset.
+	void _log_allocations(const char *call) const;
 	
 public:
 
@@ -63,17 +83,33 @@ public:
 	std::shared_ptr<Orbit::Config> config;
 
 	RandomGenerator random;
+	CastMemberCache cast_cache;
+	// small cast images, packed for the GPU blits
+	Orbit::RlExt::Atlas atlas;
 	
 	inline int width() const { return _width; }
 	inline int height() const { return _height; }
 	inline void _set_redraw() { _redraw = true; }
 
 	inline void set_entry(const std::string &name) { _entry = name; }
+
+	// Set by _movie.halt(); the frame loop stops once it's true.
+	inline bool halted() const { return _halted; }
+	inline void halt() { _halted = true; }
+
+	// Where images saved by the scripts go when given a relative file name.
+	inline const auto &output() const { return _output; }
+	inline void set_output(const std::filesystem::path &dir) { _output = dir; }
 	inline const auto &castlibs() const { return _castlibs; }
 	inline const auto &castmembers() const { return _castmembers; }
 	inline const auto &castlib_names() const { return _castlib_names; }
+	inline const Pool &allocator() const { return _pool; }
+	inline const Sampler &sampler() const { return _sampler; }
 
+	// Left empty when there's no graphics context.
 	RenderTexture2D viewport;
+	// draw() and clear() into the viewport; flushed after every call into the scripts
+	Orbit::RlExt::DrawQueue draw_queue;
 
     void load_file(std::filesystem::path const &);
 	void load_directory(std::filesystem::path const &);
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <filesystem>
+#include <unordered_map>
+
+extern "C" {
+    #include <lua.h>
+}
+
+namespace Orbit::Lua {
+
+// Samples the Lua call stack, for flame graphs of the scripts.
+//
+// A count hook stops the state every PERIOD instructions and records the
+// stack, weighed by the time since the previous sample. That time is charged
+// to whatever is running at the sample, which isn't always what spent it: a
+// slow native binding shows up in the function that runs its next PERIOD
+// instructions, which may be a different one. The stacks are
+// written in the folded format of flamegraph.pl, inferno and speedscope, with
+// the weights in microseconds.
+//
+// Nothing is hooked unless the sampler is attached, so it costs nothing when
+// it's off.
+class Sampler {
+
+public:
+
+	static constexpr int PERIOD = 1000;
+
+private:
+
+	using clock = std::chrono::steady_clock;
+
+	bool _attached;
+	clock::time_point _last;
+	// folded stack -> nanoseconds
+	std::unordered_map<std::string, uint64_t> _stacks;
+	// scratch for a sample: the frames, innermost first, and the folded stack
+	std::vector<std::string> _frames;
+	std::string _stack;
+
+	static void _hook(lua_State *L, lua_Debug *ar);
+
+	void _sample(lua_State *L);
+
+public:
+
+	inline bool attached() const { return _attached; }
+
+	// Hooks the state; it keeps a pointer to the sampler in its extra space.
+	void attach(lua_State *L);
+
+	// Called right before the state is run, so that the time spent outside of
+	// it isn't charged to the next sample.
+	inline void resume() { _last = clock::now(); }
+
+	void write(const std::filesystem::path &file) const;
+
+	Sampler &operator=(const Sampler &) = delete;
+	Sampler(const Sampler &) = delete;
+
+	Sampler();
+
+};
+
+};
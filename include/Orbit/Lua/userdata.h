@@ -0,0 +1,56 @@
+#pragma once
+
+#include <new>
+#include <cstdint>
+#include <type_traits>
+
+extern "C" {
+    #include <lua.h>
+    #include <lauxlib.h>
+}
+
+namespace Orbit::Lua {
+
+// Helpers for values stored inline in a full userdata, like point and color.
+//
+// Lua only aligns userdata blocks for its largest scalar type (LUAI_MAXALIGN),
+// which is short of what the xsimd-backed types need, so the block is padded
+// and the value starts at the first suitably aligned address in it.
+// The values are never destroyed, so they don't need a __gc metamethod.
+
+// Returns the value in a userdata block, or nullptr if there's no block.
+template <typename T>
+inline T *userdata_value(void *block) {
+	if (block == nullptr) return nullptr;
+
+	const auto mask = static_cast<std::uintptr_t>(alignof(T) - 1);
+	const auto address = (reinterpret_cast<std::uintptr_t>(block) + mask) & ~mask;
+
+	return reinterpret_cast<T *>(address);
+}
+
+// Pushes a new userdata holding a copy of the value, and sets its metatable.
+template <typename T>
+inline T *push_value(lua_State *L, const T &value, const char *meta) {
+	static_assert(std::is_trivially_destructible_v<T>, "inline userdata values are never destroyed");
+
+	void *block = lua_newuserdatauv(L, sizeof(T) + alignof(T) - 1, 0);
+	T *result = new (userdata_value<T>(block)) T(value);
+
+	luaL_setmetatable(L, meta);
+
+	return result;
+}
+
+template <typename T>
+inline T *check_value(lua_State *L, int index, const char *meta) {
+	return userdata_value<T>(luaL_checkudata(L, index, meta));
+}
+
+// Returns nullptr if the value at the index isn't a userdata with the metatable.
+template <typename T>
+inline T *test_value(lua_State *L, int index, const char *meta) {
+	return userdata_value<T>(luaL_testudata(L, index, meta));
+}
+
+};
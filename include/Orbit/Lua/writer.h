@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include <string_view>
+
+#include <Orbit/Lua/array.h>
+
+extern "C" {
+    #include <lua.h>
+}
+
+namespace Orbit::Lua {
+
+// Writes Lua values as Lingo literals, the way Director prints them.
+//
+// Tables with the keys 1..n become linear lists, other tables property lists
+// with their keys sorted; point, rect and color userdata become the calls that
+// make them, quads lists of four points and arrays nested lists. Everything goes into one buffer,
+// which is written to the file whenever it fills up, if there's one.
+//
+// Nothing in here raises a Lua error, so the buffer can't be leaked; values
+// that have no Lingo form throw a std::invalid_argument instead.
+class LingoWriter {
+
+public:
+
+	static constexpr size_t FLUSH_SIZE = 64 * 1024;
+	static constexpr int MAX_DEPTH = 100;
+
+private:
+
+	std::string _buffer;
+	std::FILE *_file;
+
+	void _value(lua_State *L, int index, int depth);
+	void _table(lua_State *L, int index, int depth);
+	void _string(std::string_view str);
+	void _array(const Array &array, size_t *indexes, int dimension);
+
+	void _integer(lua_Integer number);
+	void _float(double number);
+	// Whole numbers are written without decimals
+	void _coordinate(float number);
+
+	inline void _put(std::string_view str) { _buffer.append(str); }
+	inline void _put(char c) { _buffer.push_back(c); }
+
+public:
+
+	// Appends the value at the index.
+	void write(lua_State *L, int index);
+
+	// Writes out what's buffered, if there's a file.
+	void flush();
+
+	inline const std::string &str() const { return _buffer; }
+
+	LingoWriter(std::FILE *file = nullptr);
+
+};
+
+};
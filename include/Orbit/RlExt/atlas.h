@@ -0,0 +1,116 @@
+#pragma once
+
+#include <Orbit/RlExt/canvas.h>
+
+#include <unordered_map>
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <raylib.h>
+
+namespace Orbit::RlExt {
+
+// Where to sample an image from on the GPU.
+struct TextureView {
+	// Has the dimensions of the image, so texture coordinates computed against it stay image-relative.
+	Texture2D texture;
+	// The part of the bound texture that holds the image, normalized (see the source_region uniform of the copy shaders).
+	Rectangle region;
+
+	// The bound texture with its actual dimensions, for raylib's own draw functions.
+	inline Texture2D bound() const {
+		return Texture2D{
+			texture.id,
+			static_cast<int>(std::lround(texture.width / region.width)),
+			static_cast<int>(std::lround(texture.height / region.height)),
+			texture.mipmaps,
+			texture.format
+		};
+	}
+
+	// Where the image is in bound(), in pixels.
+	inline Rectangle source() const {
+		const auto full = bound();
+		return Rectangle{ region.x * full.width, region.y * full.height, static_cast<float>(texture.width), static_cast<float>(texture.height) };
+	}
+};
+
+// Packs small images that never change into a few large textures, so that
+// blitting them doesn't take a texture (and a framebuffer) per image.
+//
+// Only canvases showing pixels borrowed from the cast cache qualify: those are
+// immutable, so they can be uploaded once and shared by every lookup.
+// Images are placed with a skyline packer on first use, and forgotten when
+// their pixels are unloaded. When every page is full, the images still loaded
+// are packed again if enough space was freed, or the atlas starts over; either
+// way a view is only valid until the next call.
+class Atlas {
+
+	// Bottom-left skyline: the top edge of the packed area, as horizontal segments.
+	struct Skyline {
+		struct Segment { int x, y, width; };
+
+		int width, height;
+		std::vector<Segment> segments;
+
+		// Returns false if the rectangle doesn't fit.
+		bool insert(int w, int h, int &x, int &y);
+		void clear();
+	};
+
+	struct Page {
+		Texture2D texture;
+		Skyline skyline;
+	};
+
+	struct Region {
+		std::weak_ptr<const Image> owner;
+		size_t page;
+		int x, y;
+		// with the gutter
+		int width, height;
+	};
+
+	std::vector<Page> _pages;
+	std::unordered_map<const Image *, Region> _regions;
+	// pixels of the pages taken by regions that were released since the last repack
+	size_t _freed;
+
+	bool _place(const Image &, Region &);
+	// Packs the regions that are left from scratch, which frees the space of the others.
+	void _repack();
+
+public:
+
+	static const int PAGE_SIZE = 2048;
+	static const int MAX_PAGES = 4;
+	// images larger than this on either side keep their own texture
+	static const int MAX_SIZE = 256;
+
+	// Called before the regions are forgotten, i.e. to submit draws that still sample them.
+	std::function<void()> on_clear;
+
+	inline size_t pages() const { return _pages.size(); }
+	inline size_t count() const { return _regions.size(); }
+
+	// Returns where to sample the canvas from, packing its pixels on first use.
+	// Canvases that don't qualify are sampled from their own texture.
+	TextureView view(Canvas &);
+
+	// Forgets the region of the pixels, which are about to be unloaded.
+	void release(const Image *);
+
+	// Forgets every region; the pages are kept for reuse.
+	void clear();
+
+	Atlas &operator=(const Atlas &) = delete;
+	Atlas(const Atlas &) = delete;
+
+	Atlas();
+	~Atlas();
+
+};
+
+};
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <raylib.h>
+
+#include <memory>
+
+namespace Orbit::RlExt {
+
+class DrawQueue;
+
+// An image whose pixels can live in system memory, in video memory, or both.
+//
+// The GPU side is a persistent render texture, so consecutive blits into the
+// same canvas never leave the GPU. The CPU side is only brought up to date
+// when something actually reads the pixels.
+//
+// Render textures are stored bottom-up: sampling them requires flipping the
+// vertical texture coordinate (see the vflip uniform of the copy shaders).
+struct Canvas {
+
+	Image image;
+	RenderTexture2D target;
+	RenderTexture2D scratch;
+
+	// image is out of date with target
+	bool cpu_stale;
+	// target is out of date with image
+	bool gpu_stale;
+	// target and scratch are swapped at the end of a feedback blit
+	bool swap;
+	// bumped whenever the pixels are written to
+	unsigned version;
+	// set while image borrows its pixels (i.e. from the cast cache); they're copied before the first write
+	std::shared_ptr<const Image> shared;
+	// set while a queued draw samples the texture; the queue is flushed before the texture changes
+	DrawQueue *pending;
+
+	inline int width() const { return image.width; }
+	inline int height() const { return image.height; }
+	inline bool resident() const { return target.id != 0; }
+
+	// Brings the CPU pixels up to date, in RGBA8.
+	const Image &pixels();
+
+	// Same as pixels(), but invalidates the GPU copy since the caller is about to modify the image.
+	Image &pixels_mut();
+
+	// Brings the GPU pixels up to date and returns the texture.
+	// The texture is stored bottom-up.
+	Texture2D texture();
+
+	// Gives the canvas its own copy of borrowed pixels.
+	void detach();
+
+	// Fills both copies without transferring any pixels.
+	void clear(Color);
+
+	// Starts rendering into the canvas.
+	//
+	// When feedback is true, the shader may sample the previous contents
+	// through the texture returned by texture() during the blit.
+	void begin(bool feedback = false);
+	void end();
+
+	// Returns a new canvas with the same pixels, copied on the side that is currently up to date.
+	// Borrowed pixels stay borrowed.
+	Canvas duplicate();
+
+	void unload();
+
+	Canvas &operator=(Canvas &&) noexcept;
+	Canvas &operator=(const Canvas &) = delete;
+
+	Canvas(Canvas &&) noexcept;
+	Canvas(const Canvas &) = delete;
+
+	// Takes ownership of the image.
+	Canvas(Image);
+
+	// Borrows RGBA8 pixels that must never change; the canvas copies them before writing.
+	Canvas(std::shared_ptr<const Image>);
+
+	// A canvas that only exists on the GPU until its pixels are read.
+	Canvas(int width, int height);
+
+	~Canvas();
+
+private:
+
+	// Drops the CPU pixels, whether they're owned or borrowed.
+	void _release_pixels();
+
+	// Submits the queued draws that sample the texture.
+	void _settle();
+
+};
+
+};
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <Orbit/shaders.h>
+
+#include <string>
+#include <vector>
+
+#include <raylib.h>
+
+namespace Orbit::RlExt {
+
+struct Canvas;
+
+// Records draws into a render texture, and submits them all at once.
+//
+// Opening the render texture for every single draw flushes rlgl's batch each
+// time. The queue renders its commands in order within one texture mode
+// instead, so consecutive draws that sample the same texture (lines, text, or
+// images packed in the atlas) end up in a single draw call.
+//
+// The textures are only sampled when the queue is flushed: a canvas with queued
+// draws flushes the queue before its texture is written to or unloaded.
+class DrawQueue {
+
+	enum class Kind { Clear, Text, Line, Texture, Quad };
+
+	struct Command {
+		Kind kind;
+		Color color;
+		Texture2D texture;
+		Rectangle source, dest;
+		Vector2 vertices[4];
+		float thickness;
+		int size;
+		// offset of the text in _text
+		size_t text;
+	};
+
+	const RenderTexture2D *_target;
+	const Orbit::Shaders *_shaders;
+
+	std::vector<Command> _commands;
+	// queued texts, back to back, each terminated with a NUL
+	std::string _text;
+	// canvases whose texture is sampled by a queued command
+	std::vector<Canvas *> _sampled;
+
+	void _sample(Canvas *);
+
+public:
+
+	inline size_t size() const { return _commands.size(); }
+	inline bool empty() const { return _commands.empty(); }
+
+	// Drops every queued command, since they would all be covered.
+	void clear(Color);
+
+	void text(const char *, int x, int y, int size, Color);
+	void line(Vector2 from, Vector2 to, float thickness, Color);
+
+	// Same as DrawTexturePro(), without rotation.
+	// The canvas the texture belongs to, if any, is kept from changing until the queue is flushed.
+	void texture(Texture2D, Rectangle source, Rectangle dest, Color, Canvas * = nullptr);
+
+	// Maps the texture onto the quad with the invb shader.
+	void quad(Texture2D, Rectangle source, const Vector2 vertices[4], Color, Canvas * = nullptr);
+
+	// Renders the queued commands into the target.
+	void flush();
+
+	DrawQueue &operator=(const DrawQueue &) = delete;
+	DrawQueue(const DrawQueue &) = delete;
+
+	// Both must outlive the queue; the target may be left empty, in which case nothing is drawn.
+	DrawQueue(const RenderTexture2D &target, const Orbit::Shaders *);
+
+};
+
+};
@@ -5,6 +5,8 @@
 
 #include <Orbit/Lua/rect.h>
 #include <Orbit/Lua/quad.h>
+#include <Orbit/RlExt/canvas.h>
+#include <Orbit/RlExt/atlas.h>
 #include <Orbit/shaders.h>
 
 #include <raylib.h>
@@ -22,10 +24,13 @@ struct CopyImageParams {
 	float blend;
 	std::optional<Color> color;
 	CopyImageInk ink;
-	Image *mask;
+	Canvas *mask;
+
+	// Whether the blit has to read the destination pixels it overwrites.
+	bool samples_destination() const;
 
 	CopyImageParams();
-	CopyImageParams(float, std::optional<Color>, CopyImageInk, Image *);
+	CopyImageParams(float, std::optional<Color>, CopyImageInk, Canvas *);
 
 };
 
@@ -48,20 +53,22 @@ void CopyImage_CPU(
 
 void CopyImage_GPU(
 	const Orbit::CopyPixelsShader *shader, 
-	const Image *src, 
-	Image *dst, 
+	Canvas *src, 
+	Canvas *dst, 
 	const Orbit::Lua::Rect *from, 
 	const Orbit::Lua::Rect *to, 
-	const CopyImageParams &params
+	const CopyImageParams &params,
+	Atlas *atlas = nullptr
 );
 
 void CopyImage_GPU(
 	const Orbit::InvbCopyPixelsShader *shader, 
-	const Image *src, 
-	Image *dst, 
+	Canvas *src, 
+	Canvas *dst, 
 	const Orbit::Lua::Rect *from, 
 	const Orbit::Lua::Quad *to, 
-	const CopyImageParams &params
+	const CopyImageParams &params,
+	Atlas *atlas = nullptr
 );
 
 };
@@ -2,12 +2,37 @@
 
 #include <filesystem>
 
+#include <spdlog/common.h>
+
 namespace Orbit {
 
 struct Config {
 
     int width, height, fps;
 
+    // memory budget for decoded cast member images and text, in megabytes
+    int cast_cache_mb;
+
+    enum class Allocator { Pool, System };
+
+    // what the Lua state allocates its objects with
+    Allocator lua_allocator;
+
+    // time the frames and the native bindings; see Orbit/profiler.h
+    bool profile;
+
+    // sample the Lua call stacks; see Orbit/Lua/sampler.h
+    bool sample_lua;
+
+    // the least severe messages that are logged
+    spdlog::level::level_enum log_level;
+
+    enum class LogOverflow { Block, Drop };
+
+    // messages waiting to be written to the log file, and what happens when there are more
+    int log_queue_size;
+    LogOverflow log_overflow;
+
     Config();
     Config(const std::filesystem::path &file);
 
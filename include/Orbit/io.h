@@ -8,4 +8,33 @@ namespace Orbit {
 std::filesystem::path get_executable_dir();
 size_t get_path_max_len();
 
+// A read-only view of a whole file, mapped into memory.
+class MappedFile {
+
+    const char *_data;
+    size_t _size;
+
+#ifdef _WIN32
+    void *_file, *_mapping;
+#endif
+
+    void _unmap();
+
+public:
+
+    inline const char *data() const { return _data; }
+    inline size_t size() const { return _size; }
+
+    MappedFile &operator=(MappedFile &&) noexcept;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    MappedFile(MappedFile &&) noexcept;
+    MappedFile(const MappedFile &) = delete;
+
+    // Throws std::runtime_error if the file can't be opened or mapped.
+    MappedFile(const std::filesystem::path &);
+
+    ~MappedFile();
+};
+
 };
\ No newline at end of file
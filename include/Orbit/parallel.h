@@ -0,0 +1,52 @@
+#pragma once
+
+#include <algorithm>
+#include <exception>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <mutex>
+
+namespace Orbit {
+
+// Calls fn(i) for every i in [0, count), spread over the available hardware threads.
+//
+// Indexes are handed out one at a time, so uneven workloads balance themselves.
+// The first exception thrown by fn is rethrown once all workers are done.
+template <typename F>
+void parallel_for(size_t count, F &&fn) {
+	const size_t workers = std::min<size_t>(count, std::max(1u, std::thread::hardware_concurrency()));
+
+	if (workers <= 1) {
+		for (size_t i = 0; i < count; i++) fn(i);
+		return;
+	}
+
+	std::atomic<size_t> next(0);
+	std::exception_ptr error = nullptr;
+	std::mutex error_mutex;
+
+	auto work = [&]() {
+		for (size_t i = next++; i < count; i = next++) {
+			try {
+				fn(i);
+			} catch (...) {
+				std::lock_guard<std::mutex> lock(error_mutex);
+				if (!error) error = std::current_exception();
+				next = count;
+			}
+		}
+	};
+
+	std::vector<std::thread> threads;
+	threads.reserve(workers - 1);
+
+	for (size_t t = 1; t < workers; t++) threads.emplace_back(work);
+	work();
+
+	for (auto &thread : threads) thread.join();
+
+	if (error) std::rethrow_exception(error);
+}
+
+};
@@ -0,0 +1,186 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+#include <string_view>
+#include <filesystem>
+#include <unordered_map>
+
+namespace Orbit {
+
+// Where the frames go: the time spent in the native bindings, the rest of the
+// frame (the scripts themselves), and the pixels moved between the CPU and
+// the GPU.
+//
+// There's one profiler for the whole program, since the bindings and the
+// canvases that report to it know nothing of each other. It does nothing
+// until enabled; then every scope is kept for a Chrome trace (chrome://tracing
+// or Perfetto), up to MAX_EVENTS, and the totals of the last frame can be
+// drawn over the window.
+//
+// It's only used from the thread that runs the scripts.
+class Profiler {
+
+public:
+
+	static constexpr size_t MAX_EVENTS = 1 << 20;
+
+	struct Totals {
+		double seconds;
+		size_t calls;
+	};
+
+	struct Transfers {
+		size_t uploads, upload_bytes;
+		size_t readbacks, readback_bytes;
+	};
+
+	struct Frame {
+		const char *name;
+		// the whole frame, and the part of it spent in the outermost scopes
+		double seconds, native;
+		Transfers transfers;
+		// by name, the slowest first
+		std::vector<std::pair<std::string_view, Totals>> scopes;
+	};
+
+	// Times its own lifetime, when the profiler is enabled.
+	//
+	// Not for the native bindings: a Lua error longjmps out of them, and
+	// skipping a destructor that way is undefined. They open a Mark instead.
+	class Scope {
+		const char *_name;
+		int64_t _start;
+
+	public:
+		inline explicit Scope(const char *name);
+		inline ~Scope();
+
+		Scope &operator=(const Scope &) = delete;
+		Scope(const Scope &) = delete;
+	};
+
+	// The start of a scope that's closed by hand, with close(). It has no
+	// destructor for a Lua error to skip; a scope the error cuts short is
+	// never closed, and the depth is restored where the error is caught.
+	struct Mark {
+		const char *name;
+		int64_t start;
+	};
+
+private:
+
+	using clock = std::chrono::steady_clock;
+
+	struct Event {
+		const char *name;
+		int64_t start, duration;
+	};
+
+	struct Sample {
+		int64_t time;
+		Transfers transfers;
+	};
+
+	bool _enabled;
+	clock::time_point _origin;
+
+	int _depth;
+	const char *_frame_name;
+	int64_t _frame_start;
+	double _native;
+	Transfers _transfers;
+	std::unordered_map<std::string_view, Totals> _scopes;
+
+	Frame _last;
+
+	std::vector<Event> _events;
+	// the transfers of every frame, for the counters of the trace
+	std::vector<Sample> _samples;
+	size_t _dropped;
+
+	// in nanoseconds since the profiler was enabled
+	inline int64_t _now() const {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - _origin).count();
+	}
+
+	void _record(const char *name, int64_t start, int64_t end);
+
+public:
+
+	// Whether draw_overlay() draws anything; toggled by the window loop.
+	bool overlay;
+
+	inline bool enabled() const { return _enabled; }
+	void enable();
+
+	// The frame that was last ended.
+	inline const Frame &last() const { return _last; }
+
+	void begin_frame(const char *name);
+	void end_frame();
+
+	inline Mark open(const char *name);
+	inline void close(const Mark &mark);
+
+	// How many scopes are open, to be restored after a Lua error is caught.
+	inline int depth() const { return _depth; }
+	inline void restore(int depth) { _depth = depth; }
+
+	inline void upload(size_t bytes) {
+		if (!_enabled) return;
+		_transfers.uploads++;
+		_transfers.upload_bytes += bytes;
+	}
+
+	inline void readback(size_t bytes) {
+		if (!_enabled) return;
+		_transfers.readbacks++;
+		_transfers.readback_bytes += bytes;
+	}
+
+	// Draws the totals of the last frame at the top left of the screen.
+	void draw_overlay() const;
+
+	// Writes the recorded scopes and transfers in the Chrome trace event format.
+	void write_trace(const std::filesystem::path &file) const;
+
+	Profiler &operator=(const Profiler &) = delete;
+	Profiler(const Profiler &) = delete;
+
+	Profiler();
+
+};
+
+extern Profiler profiler;
+
+inline Profiler::Mark Profiler::open(const char *name) {
+	if (!_enabled) return Mark{ name, -1 };
+
+	_depth++;
+	return Mark{ name, _now() };
+}
+
+inline void Profiler::close(const Mark &mark) {
+	if (mark.start < 0) return;
+
+	_depth--;
+	_record(mark.name, mark.start, _now());
+}
+
+inline Profiler::Scope::Scope(const char *name) : _name(name), _start(-1) {
+	if (!profiler._enabled) return;
+
+	_start = profiler._now();
+	profiler._depth++;
+}
+
+inline Profiler::Scope::~Scope() {
+	if (_start < 0) return;
+
+	profiler._depth--;
+	profiler._record(_name, _start, profiler._now());
+}
+
+};
@@ -108,8 +108,11 @@ struct SilhouetteShader {
     ) const { 
         SetShaderValueTexture(shader, texture_loc, t);
 
-        SetShaderValue(shader, invert_loc, &invert, SHADER_UNIFORM_INT);
-        SetShaderValue(shader, vflip_loc, &vflip, SHADER_UNIFORM_INT);
+        int invert_i = invert;
+        int vflip_i = vflip;
+
+        SetShaderValue(shader, invert_loc, &invert_i, SHADER_UNIFORM_INT);
+        SetShaderValue(shader, vflip_loc, &vflip_i, SHADER_UNIFORM_INT);
         SetShaderValue(shader, fault_tolerance_loc, &tolerance, SHADER_UNIFORM_FLOAT);
     }
 
@@ -162,6 +165,7 @@ struct CopyPixelsShader {
     int vflip_loc;
     int ink_loc;
     int blend_loc;
+    int source_region_loc;
 
     inline Shader operator=(const CopyPixelsShader &s) const { return s.shader; }
     inline void prepare(
@@ -171,7 +175,8 @@ struct CopyPixelsShader {
         int ink = 0,
         float blend = 1.0f,
         bool vflip = false,
-        const Texture2D *mask = nullptr 
+        const Texture2D *mask = nullptr,
+        const Rectangle &region = Rectangle{0, 0, 1, 1}
     ) const { 
         SetShaderValueTexture(shader, texture1_loc, t1);
         SetShaderValueTexture(shader, texture2_loc, t2);
@@ -179,6 +184,7 @@ struct CopyPixelsShader {
 
         int use_mask = mask != nullptr;
         int use_color = (int)color;
+        int use_vflip = (int)vflip;
         Vector2 t1s = Vector2{(float)t1.width, (float)t1.height};
         Vector2 t2s = Vector2{(float)t2.width, (float)t2.height};
         Vector2 ms = mask ? Vector2{(float)mask->width, (float)mask->height} : Vector2{0, 0};
@@ -187,11 +193,14 @@ struct CopyPixelsShader {
         SetShaderValueV(shader, texture2_size_loc, &t2s, SHADER_UNIFORM_VEC2, 1);
         SetShaderValueV(shader, mask_size_loc, &ms, SHADER_UNIFORM_VEC2, 1);
 
-        SetShaderValue(shader, vflip_loc, &vflip, SHADER_UNIFORM_INT);
+        SetShaderValue(shader, vflip_loc, &use_vflip, SHADER_UNIFORM_INT);
         SetShaderValue(shader, use_color_loc, &use_color, SHADER_UNIFORM_INT);
         SetShaderValue(shader, ink_loc, &ink, SHADER_UNIFORM_INT);
         SetShaderValue(shader, use_mask_loc, &use_mask, SHADER_UNIFORM_INT);
         SetShaderValue(shader, blend_loc, &blend, SHADER_UNIFORM_FLOAT);
+
+        float source_region[4] = { region.x, region.y, region.width, region.height };
+        SetShaderValue(shader, source_region_loc, source_region, SHADER_UNIFORM_VEC4);
     }
 
     inline CopyPixelsShader &operator=(const CopyPixelsShader &) = delete;
@@ -214,6 +223,7 @@ struct InvbCopyPixelsShader {
     int vflip_loc;
     int ink_loc;
     int blend_loc;
+    int source_region_loc;
     int vertices_loc;
     int src_coords_loc;
 
@@ -227,7 +237,8 @@ struct InvbCopyPixelsShader {
         int ink = 0,
         float blend = 1.0f,
         bool vflip = false,
-        const Texture2D *mask = nullptr 
+        const Texture2D *mask = nullptr,
+        const Rectangle &region = Rectangle{0, 0, 1, 1}
     ) const { 
         SetShaderValueTexture(shader, texture1_loc, t1);
         SetShaderValueTexture(shader, texture2_loc, t2);
@@ -240,6 +251,7 @@ struct InvbCopyPixelsShader {
 
         int use_mask = mask != nullptr;
         int use_color = (int)color;
+        int use_vflip = (int)vflip;
         Vector2 t1s = Vector2{(float)t1.width, (float)t1.height};
         Vector2 t2s = Vector2{(float)t2.width, (float)t2.height};
         Vector2 ms = mask ? Vector2{(float)mask->width, (float)mask->height} : Vector2{0, 0};
@@ -248,11 +260,14 @@ struct InvbCopyPixelsShader {
         SetShaderValueV(shader, texture2_size_loc, &t2s, SHADER_UNIFORM_VEC2, 1);
         SetShaderValueV(shader, mask_size_loc, &ms, SHADER_UNIFORM_VEC2, 1);
 
-        SetShaderValue(shader, vflip_loc, &vflip, SHADER_UNIFORM_INT);
+        SetShaderValue(shader, vflip_loc, &use_vflip, SHADER_UNIFORM_INT);
         SetShaderValue(shader, use_color_loc, &use_color, SHADER_UNIFORM_INT);
         SetShaderValue(shader, ink_loc, &ink, SHADER_UNIFORM_INT);
         SetShaderValue(shader, use_mask_loc, &use_mask, SHADER_UNIFORM_INT);
         SetShaderValue(shader, blend_loc, &blend, SHADER_UNIFORM_FLOAT);
+
+        float source_region[4] = { region.x, region.y, region.width, region.height };
+        SetShaderValue(shader, source_region_loc, source_region, SHADER_UNIFORM_VEC4);
     }
 
     inline InvbCopyPixelsShader &operator=(const InvbCopyPixelsShader &) = delete;
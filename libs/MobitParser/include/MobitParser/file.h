@@ -0,0 +1,13 @@
+#pragma once
+
+#include <string_view>
+#include <vector>
+
+namespace mp {
+/// @brief Splits the text at its top-level line breaks, outside of brackets
+/// and strings. Every top-level line is a section, empty ones included; a
+/// section spans several lines when a bracket or a string does, so the indexes
+/// only match the line numbers when none does. A trailing line break doesn't
+/// start a section. Unbalanced closing brackets are ignored.
+std::vector<std::string_view> split_sections(std::string_view);
+}; // namespace mp
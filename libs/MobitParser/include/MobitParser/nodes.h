@@ -3,6 +3,7 @@
 #include <cstdint>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 
@@ -32,92 +33,179 @@ enum class unary_operation : uint8_t {
 /// TODO: implement this
 inline int operator_precedence(token_type) { return 0; }
 
-class Node {
-public:
-  virtual ~Node() = default;
+enum class node_kind : uint8_t {
+  void_val,
+  integer,
+  floating,
+  string,
+  symbol,
+  identifier,
+  unary,      // op and a single child
+  list,       // children
+  props,      // children with keys
+  call,       // name and the arguments as children
+  integers,   // a list of integers only, packed
+  floats      // a list of floats only, packed
 };
 
-class Void : public Node {};
-
-class Int : public Node {
-public:
-  const int number;
+using node_id = uint32_t;
+using string_id = uint32_t;
+
+struct node {
+  node_kind kind;
+  unary_operation op;
+  // string, symbol and identifier: the text; call: the name
+  string_id text;
+  // a range of the tree's children, or of its packed numbers
+  uint32_t first, count;
+
+  union {
+    int integer;
+    float floating;
+  };
+};
 
-  Int(int);
+struct child {
+  // the lowercase property name, for the children of props
+  string_id key;
+  node_id value;
 };
 
-class Float : public Node {
-public:
-  const float number;
+/// @brief A contiguous run of a node's children.
+struct children {
+  const child *first, *last;
 
-  Float(float);
+  const child *begin() const { return first; }
+  const child *end() const { return last; }
+  size_t size() const { return static_cast<size_t>(last - first); }
+  const child &operator[](size_t i) const { return first[i]; }
 };
 
-class String : public Node {
-public:
-  const std::string str;
+/// @brief A contiguous run of the numbers of a packed list.
+template <typename Number> struct packed {
+  const Number *first, *last;
 
-  String(std::string);
-  String(std::string &&);
+  const Number *begin() const { return first; }
+  const Number *end() const { return last; }
+  size_t size() const { return static_cast<size_t>(last - first); }
+  const Number &operator[](size_t i) const { return first[i]; }
 };
 
-class Symbol : public Node {
+/// @brief An abstract syntax tree, stored flat.
+///
+/// The nodes live in one vector and refer to each other by index; the
+/// children of every node are a contiguous range of another. Strings are
+/// interned in blocks that never move, so parsing takes a handful of
+/// allocations however big the expression is.
+///
+/// Flat trees keep the lists that only hold numbers of one type as packed
+/// arrays, without a node for every number.
+class tree {
+private:
+  std::vector<node> nodes_;
+  std::vector<child> children_;
+  std::vector<int32_t> integers_;
+  std::vector<float> floats_;
+
+  std::vector<std::unique_ptr<char[]>> blocks_;
+  char *top_;
+  size_t left_;
+
+  std::vector<std::string_view> strings_;
+  std::unordered_map<std::string_view, string_id> interned_;
+
+  node_id root_;
+
 public:
-  const std::string str;
+  static constexpr size_t BLOCK_SIZE = 64 * 1024;
+  static constexpr node_id NONE = UINT32_MAX;
 
-  Symbol(std::string);
-  Symbol(std::string &&);
-};
+  bool empty() const { return root_ == NONE; }
+  node_id root() const { return root_; }
+  size_t size() const { return nodes_.size(); }
 
-class Iden : public Node {
-public:
-  const std::string identifier;
+  const node &operator[](node_id id) const { return nodes_[id]; }
+  node &operator[](node_id id) { return nodes_[id]; }
 
-  Iden() = delete;
-  Iden(std::string &&);
-};
+  std::string_view str(string_id id) const { return strings_[id]; }
 
-class BinOp : public Node {
-public:
-  const binary_operation op;
-  const std::unique_ptr<Node> left, right;
+  children children_of(const node &n) const {
+    const child *first = children_.data() + n.first;
+    return {first, first + n.count};
+  }
 
-  BinOp(binary_operation op_, std::unique_ptr<Node> &&left_,
-        std::unique_ptr<Node> &&right_);
-};
+  packed<int32_t> integers_of(const node &n) const {
+    const int32_t *first = integers_.data() + n.first;
+    return {first, first + n.count};
+  }
 
-class UnOp : public Node {
-public:
-  const unary_operation op;
-  const std::unique_ptr<Node> operand;
+  packed<float> floats_of(const node &n) const {
+    const float *first = floats_.data() + n.first;
+    return {first, first + n.count};
+  }
 
-  UnOp(unary_operation op_, std::unique_ptr<Node> &&operand_);
-};
+  /// @brief Calls the visitor's member for the kind of the node, and returns
+  /// what it returns.
+  template <typename Visitor> decltype(auto) visit(node_id, Visitor &&) const;
 
-class List : public Node {
-public:
-  const std::vector<std::unique_ptr<Node>> elements;
+  /// @brief Interns a copy of the text.
+  string_id intern(std::string_view);
 
-  List();
-  List(std::vector<std::unique_ptr<Node>> &&);
-};
+  node_id add(const node &);
 
-class Props : public Node {
-public:
-  const std::unordered_map<std::string, std::unique_ptr<Node>> map;
+  /// @brief Appends the entries as the children of a node, and returns the
+  /// first index.
+  uint32_t add_children(const child *first, size_t count);
 
-  Props();
-  Props(std::unordered_map<std::string, std::unique_ptr<Node>> &&);
-};
+  /// @brief Adds a packed list of the numbers.
+  node_id add_integers(const int32_t *first, size_t count);
+  node_id add_floats(const float *first, size_t count);
 
-class GCall : public Node {
-public:
-  const std::string name;
-  const std::vector<std::unique_ptr<Node>> args;
+  void set_root(node_id id) { root_ = id; }
+
+  void reserve(size_t nodes);
 
-  GCall(std::string &&, std::vector<std::unique_ptr<Node>> &&);
+  tree &operator=(tree &&) = default;
+  tree(tree &&) = default;
+  tree &operator=(const tree &) = delete;
+  tree(const tree &) = delete;
+
+  tree();
 };
 
+template <typename Visitor>
+decltype(auto) tree::visit(node_id id, Visitor &&visitor) const {
+  const node &n = nodes_[id];
+
+  switch (n.kind) {
+  case node_kind::integer:
+    return visitor.on_integer(n.integer);
+  case node_kind::floating:
+    return visitor.on_floating(n.floating);
+  case node_kind::string:
+    return visitor.on_string(str(n.text));
+  case node_kind::symbol:
+    return visitor.on_symbol(str(n.text));
+  case node_kind::identifier:
+    return visitor.on_identifier(str(n.text));
+  case node_kind::unary:
+    return visitor.on_unary(n.op, children_[n.first].value);
+  case node_kind::list:
+    return visitor.on_list(children_of(n));
+  case node_kind::props:
+    return visitor.on_props(children_of(n));
+  case node_kind::call:
+    return visitor.on_call(str(n.text), children_of(n));
+  case node_kind::integers:
+    return visitor.on_integers(integers_of(n));
+  case node_kind::floats:
+    return visitor.on_floats(floats_of(n));
+  case node_kind::void_val:
+  default:
+    return visitor.on_void();
+  }
+}
+
 inline std::ostream &operator<<(std::ostream &stream, unary_operation op) {
   switch (op) {
   case unary_operation::logical_negation:
@@ -165,15 +253,58 @@ inline std::ostream &operator<<(std::ostream &stream, binary_operation op) {
   return stream;
 }
 
-std::ostream &operator<<(std::ostream &, const Node *);
+std::ostream &operator<<(std::ostream &, const tree &);
+
+/// @brief Receives the values of an expression in order, as they're parsed.
+///
+/// Strings are only valid for the duration of the call. Values that can't be
+/// pre-evaluated, like unary operations on anything but numbers, come as void.
+class handler {
+public:
+  virtual void on_void() = 0;
+  virtual void on_integer(int) = 0;
+  virtual void on_floating(float) = 0;
+  virtual void on_string(std::string_view) = 0;
+  virtual void on_symbol(std::string_view) = 0;
+
+  virtual void begin_list() = 0;
+  virtual void end_list() = 0;
+
+  /// @brief A whole list of numbers of one type. By default, it's passed on
+  /// as a list of single values.
+  virtual void on_integers(const int32_t *numbers, size_t count);
+  virtual void on_floats(const float *numbers, size_t count);
+
+  /// @brief Every value of a property list is preceded by its lowercase key.
+  virtual void begin_props() = 0;
+  virtual void on_key(std::string_view) = 0;
+  virtual void end_props() = 0;
+
+  /// @brief The arguments come as values between the two.
+  virtual void begin_call(std::string_view name) = 0;
+  virtual void end_call() = 0;
+
+  virtual ~handler() = default;
+};
+
+/// @brief Parses the first expression of the string in a single pass, straight
+/// off the lexer, without building a tree. Everything is pre-evaluated like
+/// with a flat tree.
+void parse(std::string_view str, handler &);
+
+/// @brief Replays a flat tree to the handler, as if its text was parsed with
+/// it.
+void parse(const tree &, handler &);
 
 /// @brief Constructs an abstract syntax tree from the expression string.
 /// @param str The expression string.
 /// @param flat_tree pre-evaluates some expression such as unary operations to
 /// numbers and global calls.
-std::unique_ptr<Node> parse(const std::string &str, bool flat_tree = true);
+tree parse(std::string_view str, bool flat_tree = true);
 
 /// @brief Constructs an abstact syntax tree from a node vector.
-std::unique_ptr<Node> parse(const std::vector<token> &tokens,
-                            bool flat_tree = true);
+tree parse(const std::vector<token> &tokens, bool flat_tree = true);
+
+/// @brief Constructs an abstact syntax tree from token views.
+tree parse(const std::vector<token_view> &tokens, bool flat_tree = true);
 }; // namespace mp
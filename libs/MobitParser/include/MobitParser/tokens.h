@@ -4,6 +4,7 @@
 #include <fstream>
 #include <iostream>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace mp {
@@ -76,8 +77,46 @@ struct token {
   token(token_type, const std::string &&);
 };
 
+/// @brief A token that refers back to the text it was read from, which has
+/// to outlive it.
+struct token_view {
+  token_type type;
+  uint32_t length;
+  const char *data;
+
+  std::string_view value() const { return {data, length}; }
+};
+
 std::ostream &operator<<(std::ostream &, const token &);
 
+/// @brief Reads tokens off a contiguous buffer without copying them.
+class lexer {
+private:
+  const char *cursor_, *end_;
+
+public:
+  /// @brief Reads the next token, skipping whitespace and line breaks.
+  /// @return false at the end of the text.
+  bool next(token_view &);
+
+  /// @brief Reads the tokens up to the next line break, replacing the
+  /// contents of the vector.
+  /// @return false at the end of the text.
+  bool next_line(std::vector<token_view> &);
+
+  /// @brief Reads the rest of a linear list that only holds integers, after
+  /// its opening bracket and past its closing one, straight into the vector.
+  /// @return false, without moving, when there's anything else in the list.
+  bool integers(std::vector<int32_t> &);
+
+  /// @brief The same as integers(), for a list that only holds floats.
+  bool floats(std::vector<float> &);
+
+  explicit lexer(std::string_view source);
+};
+
+std::vector<token_view> tokenize_view(std::string_view);
+
 std::vector<token> tokenize(std::ifstream &);
 std::vector<token> tokenize_line(std::ifstream &);
 bool tokenize_line(std::ifstream &, std::vector<token> &);
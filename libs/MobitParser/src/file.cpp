@@ -0,0 +1,63 @@
+#include <cstring>
+
+#include <MobitParser/file.h>
+
+namespace mp {
+std::vector<std::string_view> split_sections(std::string_view text) {
+  std::vector<std::string_view> sections;
+
+  const char *cursor = text.data();
+  const char *const end = cursor + text.size();
+  const char *start = cursor;
+
+  int depth = 0;
+
+  while (cursor != end) {
+    switch (*cursor) {
+    case '[':
+    case '(':
+      depth++;
+      break;
+
+    case ']':
+    case ')':
+      // a stray closing bracket is left for the parser to report, without
+      // throwing off the rest of the file
+      if (depth > 0)
+        depth--;
+      break;
+
+    // brackets and line breaks in strings don't count
+    case '"': {
+      const auto *closing = static_cast<const char *>(
+          std::memchr(cursor + 1, '"', static_cast<size_t>(end - cursor - 1)));
+      cursor = closing != nullptr ? closing : end - 1;
+    } break;
+
+    case '\r':
+    case '\n':
+      if (depth > 0)
+        break;
+
+      sections.emplace_back(start, static_cast<size_t>(cursor - start));
+
+      // one section per CRLF
+      if (*cursor == '\r' && cursor + 1 != end && cursor[1] == '\n')
+        cursor++;
+
+      start = cursor + 1;
+      break;
+
+    default:
+      break;
+    }
+
+    cursor++;
+  }
+
+  if (start != end)
+    sections.emplace_back(start, static_cast<size_t>(end - start));
+
+  return sections;
+}
+}; // namespace mp
@@ -1,90 +1,179 @@
 #include <algorithm>
 #include <cctype>
+#include <charconv>
+#include <cstring>
 #include <iostream>
 #include <memory>
-#include <numeric>
 #include <string>
+#include <string_view>
+#include <type_traits>
 #include <unordered_map>
 #include <vector>
 
-#ifdef __linux__
-#include <string.h>
-#endif
-
 #include <MobitParser/exceptions.h>
 #include <MobitParser/nodes.h>
 #include <MobitParser/tokens.h>
 
 namespace mp {
-Int::Int(int number) : number(number) {}
-Float::Float(float number) : number(number) {}
-String::String(std::string &&str_) : str(std::move(str_)) {}
-String::String(std::string str_) : str(str_) {}
-Symbol::Symbol(std::string &&str_) : str(std::move(str_)) {}
-Symbol::Symbol(std::string str_) : str(str_) {}
-Iden::Iden(std::string &&iden) : identifier(std::move(iden)) {}
-BinOp::BinOp(binary_operation op_, std::unique_ptr<Node> &&left_,
-             std::unique_ptr<Node> &&right_)
-    : op(op_), left(std::move(left_)), right(std::move(right_)) {}
-UnOp::UnOp(unary_operation op_, std::unique_ptr<Node> &&operand_)
-    : op(op_), operand(std::move(operand_)) {}
-List::List() {}
-List::List(std::vector<std::unique_ptr<Node>> &&elements_)
-    : elements(std::move(elements_)) {}
-Props::Props() {}
-Props::Props(std::unordered_map<std::string, std::unique_ptr<Node>> &&map_)
-    : map(std::move(map_)) {}
-GCall::GCall(std::string &&name_, std::vector<std::unique_ptr<Node>> &&args_)
-    : name(std::move(name_)), args(std::move(args_)) {}
-
-std::ostream &operator<<(std::ostream &stream, const Node *node) {
-  if (const auto *integer = dynamic_cast<const Int *>(node)) {
-    stream << integer->number;
-  } else if (const auto *floating = dynamic_cast<const Float *>(node)) {
-    stream << floating->number;
-  } else if (const auto *string = dynamic_cast<const String *>(node)) {
-    stream << '"' << string->str << '"';
-  } else if (const auto *symbol = dynamic_cast<const Symbol *>(node)) {
-    stream << '#' << symbol->str;
-  } else if (const auto *iden = dynamic_cast<const Iden *>(node)) {
-    stream << iden->identifier;
-  } else if (const auto *bin_op = dynamic_cast<const BinOp *>(node)) {
-    stream << bin_op->left.get() << ' ' << bin_op->op << ' '
-           << bin_op->right.get();
-  } else if (const auto *un_op = dynamic_cast<const UnOp *>(node)) {
-    stream << un_op->op << un_op->operand.get();
-  } else if (const auto *list = dynamic_cast<const List *>(node)) {
+string_id tree::intern(std::string_view text) {
+  const auto found = interned_.find(text);
+  if (found != interned_.end())
+    return found->second;
+
+  char *copy;
+
+  if (text.size() > BLOCK_SIZE / 4) {
+    // big strings get a block of their own, so the current one isn't wasted
+    blocks_.push_back(std::make_unique<char[]>(text.size()));
+    copy = blocks_.back().get();
+  } else {
+    if (text.size() > left_) {
+      blocks_.push_back(std::make_unique<char[]>(BLOCK_SIZE));
+      top_ = blocks_.back().get();
+      left_ = BLOCK_SIZE;
+    }
+
+    copy = top_;
+    top_ += text.size();
+    left_ -= text.size();
+  }
+
+  if (!text.empty())
+    std::memcpy(copy, text.data(), text.size());
+
+  const auto id = static_cast<string_id>(strings_.size());
+  const std::string_view stored(copy, text.size());
+
+  strings_.push_back(stored);
+  interned_.emplace(stored, id);
+
+  return id;
+}
+
+node_id tree::add(const node &n) {
+  nodes_.push_back(n);
+  return static_cast<node_id>(nodes_.size() - 1);
+}
+
+uint32_t tree::add_children(const child *first, size_t count) {
+  const auto index = static_cast<uint32_t>(children_.size());
+  children_.insert(children_.end(), first, first + count);
+  return index;
+}
+
+node_id tree::add_integers(const int32_t *first, size_t count) {
+  node n{};
+  n.kind = node_kind::integers;
+  n.first = static_cast<uint32_t>(integers_.size());
+  n.count = static_cast<uint32_t>(count);
+
+  integers_.insert(integers_.end(), first, first + count);
+  return add(n);
+}
+
+node_id tree::add_floats(const float *first, size_t count) {
+  node n{};
+  n.kind = node_kind::floats;
+  n.first = static_cast<uint32_t>(floats_.size());
+  n.count = static_cast<uint32_t>(count);
+
+  floats_.insert(floats_.end(), first, first + count);
+  return add(n);
+}
+
+void tree::reserve(size_t nodes) {
+  nodes_.reserve(nodes);
+  children_.reserve(nodes);
+}
+
+tree::tree() : top_(nullptr), left_(0), root_(NONE) {
+  // the key of list entries
+  intern("");
+}
+
+namespace {
+struct printer {
+  std::ostream &stream;
+  const tree &ast;
+
+  void print(node_id id) { ast.visit(id, *this); }
+
+  void on_void() { stream << "void"; }
+  void on_integer(int number) { stream << number; }
+  void on_floating(float number) { stream << number; }
+  void on_string(std::string_view str) { stream << '"' << str << '"'; }
+  void on_symbol(std::string_view str) { stream << '#' << str; }
+  void on_identifier(std::string_view str) { stream << str; }
+
+  void on_unary(unary_operation op, node_id operand) {
+    stream << op;
+    if (op == unary_operation::logical_negation)
+      stream << ' ';
+    print(operand);
+  }
+
+  void on_list(children entries) {
     stream << '[';
 
-    for (int i = 0; i < list->elements.size(); i++) {
-      stream << list->elements[i].get();
+    for (size_t i = 0; i < entries.size(); i++) {
+      if (i != 0)
+        stream << ", ";
+      print(entries[i].value);
+    }
+
+    stream << ']';
+  }
+
+  template <typename Number> void on_numbers(packed<Number> numbers) {
+    stream << '[';
 
-      if (i != list->elements.size() - 1)
+    for (size_t i = 0; i < numbers.size(); i++) {
+      if (i != 0)
         stream << ", ";
+      stream << numbers[i];
     }
 
     stream << ']';
-  } else if (const auto *props = dynamic_cast<const Props *>(node)) {
+  }
+
+  void on_integers(packed<int32_t> numbers) { on_numbers(numbers); }
+  void on_floats(packed<float> numbers) { on_numbers(numbers); }
+
+  void on_props(children entries) {
+    if (entries.size() == 0) {
+      stream << "[:]";
+      return;
+    }
+
     stream << '[';
 
-    for (auto i = props->map.begin(); i != props->map.end(); i++) {
-      stream << '#' << i->first << ": " << i->second.get();
-      stream << ",";
+    for (size_t i = 0; i < entries.size(); i++) {
+      if (i != 0)
+        stream << ", ";
+      stream << '#' << ast.str(entries[i].key) << ": ";
+      print(entries[i].value);
     }
 
     stream << ']';
-  } else if (const auto *gcall = dynamic_cast<const GCall *>(node)) {
-    stream << gcall->name << '(';
+  }
 
-    for (int i = 0; i < gcall->args.size(); i++) {
-      stream << gcall->args[i].get();
+  void on_call(std::string_view name, children args) {
+    stream << name << '(';
 
-      if (i != gcall->args.size() - 1)
+    for (size_t i = 0; i < args.size(); i++) {
+      if (i != 0)
         stream << ", ";
+      print(args[i].value);
     }
 
     stream << ')';
   }
+};
+} // namespace
+
+std::ostream &operator<<(std::ostream &stream, const tree &ast) {
+  if (!ast.empty())
+    printer{stream, ast}.print(ast.root());
 
   return stream;
 }
@@ -159,7 +248,7 @@ constexpr int operator_precedence(operators op) {
   return 0;
 }
 
-bool is_iden_const(const std::string &name) {
+bool is_iden_const(std::string_view name) {
   if (name == "RETURN") return true;
   if (name == "ENTER") return true;
   if (name == "SPACE") return true;
@@ -170,7 +259,7 @@ bool is_iden_const(const std::string &name) {
   return false;
 }
 
-const char *eval_const_iden(const std::string &name) {
+const char *eval_const_iden(std::string_view name) {
   if (name == "RETURN") return "\n";
   if (name == "ENTER") return "\n";
   if (name == "SPACE") return " ";
@@ -180,116 +269,211 @@ const char *eval_const_iden(const std::string &name) {
   return "";
 }
 
-std::unique_ptr<Node> parse_helper(std::vector<token>::const_iterator &cursor,
-                                   std::vector<token>::const_iterator end,
-                                   int precedence, bool flat_tree) {
-  std::unique_ptr<Node> expr = nullptr;
+inline std::string_view text(const token &token) { return token.value; }
+inline std::string_view text(const token_view &token) { return token.value(); }
 
-  switch (cursor->type) {
-    // Unary operators
+template <typename Number> Number to_number(std::string_view text) {
+  Number number{};
+  const auto result =
+      std::from_chars(text.data(), text.data() + text.size(), number);
 
-  case token_type::add: {
-    auto op = unary_operation::mathema_affirmation;
+  if (result.ec != std::errc())
+    throw parse_failure("invalid number '" + std::string(text) + "'");
 
-    if (++cursor == end)
-      throw parse_failure("expected an expression");
+  return number;
+}
 
-    int req_precedence = operator_precedence(operators::math_affirmation);
 
-    auto operand_expr =
-        parse_helper(cursor, end, req_precedence + 1, flat_tree);
+struct parse_state {
+  tree &ast;
+  bool flat_tree;
+  // the entries of the collections and calls being parsed; each one takes
+  // its own off the top once it ends
+  std::vector<child> entries;
+  std::string scratch;
+  std::vector<int32_t> integers;
+  std::vector<float> floats;
+};
 
-    if (flat_tree) {
+node make_node(node_kind kind) {
+  node n{};
+  n.kind = kind;
+  return n;
+}
 
-      if (auto *integer = dynamic_cast<Int *>(operand_expr.get())) {
-        expr = std::make_unique<Int>(integer->number);
-      } else if (auto *floating = dynamic_cast<Float *>(operand_expr.get())) {
-        expr = std::make_unique<Float>(floating->number);
-      }
+node_id add_text(tree &ast, node_kind kind, std::string_view text) {
+  node n = make_node(kind);
+  n.text = ast.intern(text);
+  return ast.add(n);
+}
 
-    } else {
-      expr = std::make_unique<UnOp>(op, std::move(operand_expr));
+/// Moves the entries above the base to the node's children.
+void take_entries(parse_state &state, size_t base, node &n) {
+  n.count = static_cast<uint32_t>(state.entries.size() - base);
+  n.first = state.ast.add_children(state.entries.data() + base, n.count);
+  state.entries.resize(base);
+}
+
+/// Reads the numbers of a list that only holds numbers of one type, from the
+/// token after its opening bracket, and leaves the cursor on its closing one.
+/// @return false, leaving the cursor alone, when it holds anything else.
+template <typename Number, typename Iterator>
+bool take_numbers(Iterator &cursor, Iterator end,
+                  std::vector<Number> &numbers) {
+  const token_type type = std::is_same_v<Number, float> ? token_type::floating
+                                                        : token_type::integer;
+  numbers.clear();
+
+  for (auto peek = cursor; peek != end;) {
+    const bool negative = peek->type == token_type::subtract;
+
+    if (negative && ++peek == end)
+      return false;
+    if (peek->type != type)
+      return false;
+
+    const Number number = to_number<Number>(text(*peek));
+    numbers.push_back(negative ? -number : number);
+
+    if (++peek == end)
+      return false;
+
+    if (peek->type == token_type::close_bracket) {
+      cursor = peek;
+      return true;
     }
 
-  } break;
+    if (peek->type != token_type::comma)
+      return false;
 
+    ++peek;
+  }
+
+  return false;
+}
+
+/// Expressions that couldn't be parsed become void in collections.
+node_id or_void(tree &ast, node_id id) {
+  return id != tree::NONE ? id : ast.add(make_node(node_kind::void_val));
+}
+
+template <typename Token>
+node_id parse_helper(parse_state &state,
+                     typename std::vector<Token>::const_iterator &cursor,
+                     typename std::vector<Token>::const_iterator end,
+                     int precedence) {
+  tree &ast = state.ast;
+  node_id expr = tree::NONE;
+
+  switch (cursor->type) {
+    // Unary operators
+
+  case token_type::add:
   case token_type::subtract: {
-    auto op = unary_operation::mathema_negation;
+    const bool negation = cursor->type == token_type::subtract;
 
     if (++cursor == end)
       throw parse_failure("expected an expression");
 
-    int req_precedence = operator_precedence(operators::math_negation);
+    int req_precedence = operator_precedence(
+        negation ? operators::math_negation : operators::math_affirmation);
 
-    auto operand_expr =
-        parse_helper(cursor, end, req_precedence + 1, flat_tree);
+    auto operand = parse_helper<Token>(state, cursor, end, req_precedence + 1);
 
-    // pre-evaluate the unary operation for negative numbers
-    if (flat_tree) {
+    // pre-evaluate the unary operation for signed numbers
+    if (state.flat_tree) {
+      if (operand != tree::NONE) {
+        node &number = ast[operand];
 
-      if (auto *integer = dynamic_cast<Int *>(operand_expr.get())) {
-        expr = std::make_unique<Int>(-1 * integer->number);
-      } else if (auto *floating = dynamic_cast<Float *>(operand_expr.get())) {
-        expr = std::make_unique<Float>(-1 * floating->number);
+        if (number.kind == node_kind::integer) {
+          if (negation)
+            number.integer = -number.integer;
+          expr = operand;
+        } else if (number.kind == node_kind::floating) {
+          if (negation)
+            number.floating = -number.floating;
+          expr = operand;
+        }
       }
-
     } else {
-      expr = std::make_unique<UnOp>(op, std::move(operand_expr));
+      node n = make_node(node_kind::unary);
+      n.op = negation ? unary_operation::mathema_negation
+                      : unary_operation::mathema_affirmation;
+
+      const child operand_entry{0, or_void(ast, operand)};
+      n.first = ast.add_children(&operand_entry, 1);
+      n.count = 1;
+
+      expr = ast.add(n);
     }
 
   } break;
 
   case token_type::negate: {
-    auto op = unary_operation::logical_negation;
-
     if (++cursor == end)
       throw parse_failure("expected an expression");
 
     int req_precedence = operator_precedence(operators::logic_negation);
 
-    auto operand_expr =
-        parse_helper(cursor, end, req_precedence + 1, flat_tree);
+    auto operand = parse_helper<Token>(state, cursor, end, req_precedence + 1);
 
-    expr = std::make_unique<UnOp>(op, std::move(operand_expr));
-  };
+    node n = make_node(node_kind::unary);
+    n.op = unary_operation::logical_negation;
+
+    const child operand_entry{0, or_void(ast, operand)};
+    n.first = ast.add_children(&operand_entry, 1);
+    n.count = 1;
+
+    expr = ast.add(n);
+  } break;
+
+  case token_type::void_val:
+    expr = ast.add(make_node(node_kind::void_val));
+    break;
 
   case token_type::integer: {
-    int integer = std::stoi(cursor->value);
+    node n = make_node(node_kind::integer);
+    n.integer = to_number<int>(text(*cursor));
 
-    expr = std::make_unique<Int>(integer);
+    expr = ast.add(n);
   } break;
 
   case token_type::floating: {
-    float floating = std::stof(cursor->value);
+    node n = make_node(node_kind::floating);
+    n.floating = to_number<float>(text(*cursor));
 
-    expr = std::make_unique<Float>(floating);
+    expr = ast.add(n);
   } break;
 
-  case token_type::string: {
-    expr = std::make_unique<String>(cursor->value);
-  } break;
+  case token_type::string:
+    expr = add_text(ast, node_kind::string, text(*cursor));
+    break;
 
-  case token_type::symbol: {
-    expr = std::make_unique<Symbol>(cursor->value);
-  } break;
+  case token_type::symbol:
+    expr = add_text(ast, node_kind::symbol, text(*cursor));
+    break;
 
   case token_type::identifier: {
-
-    std::string iden = cursor->value;
+    auto peek = cursor + 1;
 
     // pre-evaluate global calls
-    if (flat_tree) {
+    if (state.flat_tree && peek != end &&
+        peek->type == token_type::open_paren) {
+      node n = make_node(node_kind::call);
+      n.text = ast.intern(text(*cursor));
 
-      auto peek = cursor + 1;
-      if (peek != end && peek->type == token_type::open_paren) {
-        std::vector<std::unique_ptr<Node>> args;
+      const size_t base = state.entries.size();
 
-        while (peek != end) {
-          peek++;
+      if (++peek == end)
+        throw parse_failure("global call expression ended prematurely "
+                            "(expected a closing parentheses)");
 
-          auto arg_expr = parse_helper(peek, end, precedence, flat_tree);
+      // no arguments
+      if (peek->type != token_type::close_paren) {
+        while (true) {
+          auto arg_expr = parse_helper<Token>(state, peek, end, precedence);
 
-          args.push_back(std::move(arg_expr));
+          state.entries.push_back(child{0, or_void(ast, arg_expr)});
 
           if (++peek == end)
             throw parse_failure("global call expression ended prematurely "
@@ -300,14 +484,19 @@ std::unique_ptr<Node> parse_helper(std::vector<token>::const_iterator &cursor,
           if (peek->type != token_type::comma)
             throw parse_failure(
                 "global call expression ended prematurely (expected a comma)");
+
+          if (++peek == end)
+            throw parse_failure("global call expression ended prematurely "
+                                "(expected an expression)");
         }
+      }
 
-        cursor = peek;
+      cursor = peek;
 
-        expr = std::make_unique<GCall>(std::move(iden), std::move(args));
-      } else {
-        expr = std::make_unique<Iden>(std::move(iden));
-      }
+      take_entries(state, base, n);
+      expr = ast.add(n);
+    } else {
+      expr = add_text(ast, node_kind::identifier, text(*cursor));
     }
   } break;
 
@@ -323,7 +512,7 @@ std::unique_ptr<Node> parse_helper(std::vector<token>::const_iterator &cursor,
     if (peek->type == token_type::close_bracket) {
       cursor++;
 
-      expr = std::make_unique<List>();
+      expr = ast.add(make_node(node_kind::list));
     }
     // empty property list
     else if (peek->type == token_type::colon) {
@@ -336,21 +525,38 @@ std::unique_ptr<Node> parse_helper(std::vector<token>::const_iterator &cursor,
 
       cursor += 2;
 
-      expr = std::make_unique<Props>();
+      expr = ast.add(make_node(node_kind::props));
+    }
+    // most of a level file is lists of small numbers
+    else if (state.flat_tree &&
+             take_numbers<int32_t>(peek, end, state.integers)) {
+      cursor = peek;
+      expr = ast.add_integers(state.integers.data(), state.integers.size());
+    } else if (state.flat_tree &&
+               take_numbers<float>(peek, end, state.floats)) {
+      cursor = peek;
+      expr = ast.add_floats(state.floats.data(), state.floats.size());
     } else {
-      std::vector<std::unique_ptr<Node>> list;
-      std::unordered_map<std::string, std::unique_ptr<Node>> map;
+      // a list of symbols isn't a property list
+      const bool is_props = peek->type == token_type::symbol &&
+                            peek + 1 != end &&
+                            (peek + 1)->type == token_type::colon;
 
-      bool is_props = peek->type == token_type::symbol;
-
-      bool needs_comma = false;
+      const size_t base = state.entries.size();
 
       while (peek != end) {
         if (is_props) {
-          std::string key = peek->value;
+          if (peek->type != token_type::symbol)
+            throw parse_failure(
+                "invalid property list expression (expected a symbol)");
+
+          auto &key = state.scratch;
+          key.assign(text(*peek));
 
           std::transform(key.begin(), key.end(), key.begin(), ::tolower);
 
+          const string_id key_id = ast.intern(key);
+
           if (++peek == end)
             throw parse_failure("property list expression ended prematurely "
                                 "(expected a colon)");
@@ -363,9 +569,9 @@ std::unique_ptr<Node> parse_helper(std::vector<token>::const_iterator &cursor,
             throw parse_failure("property list expression ended prematurely "
                                 "(expected an expression)");
 
-          auto value_expr = parse_helper(peek, end, precedence, flat_tree);
+          auto value_expr = parse_helper<Token>(state, peek, end, precedence);
 
-          map.insert_or_assign(std::move(key), std::move(value_expr));
+          state.entries.push_back(child{key_id, or_void(ast, value_expr)});
 
           if (++peek == end)
             throw parse_failure(
@@ -379,9 +585,9 @@ std::unique_ptr<Node> parse_helper(std::vector<token>::const_iterator &cursor,
                 "invalid property list expression (expected a comma)");
         } else {
 
-          auto element_expr = parse_helper(peek, end, precedence, flat_tree);
+          auto element_expr = parse_helper<Token>(state, peek, end, precedence);
 
-          list.push_back(std::move(element_expr));
+          state.entries.push_back(child{0, or_void(ast, element_expr)});
 
           if (++peek == end)
             throw parse_failure(
@@ -398,81 +604,504 @@ std::unique_ptr<Node> parse_helper(std::vector<token>::const_iterator &cursor,
         peek++;
       }
 
-      if (is_props) {
-        expr = std::make_unique<Props>(std::move(map));
-      } else {
-        expr = std::make_unique<List>(std::move(list));
-      }
+      if (peek == end)
+        throw parse_failure("collection expression ended prematurely");
+
+      node n = make_node(is_props ? node_kind::props : node_kind::list);
+      take_entries(state, base, n);
+      expr = ast.add(n);
 
       cursor = peek;
     }
 
   } break;
+
+  default:
+    break;
   }
 
-  if (expr != nullptr && flat_tree) {
-    String *str = dynamic_cast<String*>(expr.get());
-    Iden *iden = dynamic_cast<Iden*>(expr.get());
+  if (expr != tree::NONE && state.flat_tree) {
+    node &n = ast[expr];
 
-    if (str != nullptr || iden != nullptr) {
-      std::string ss(str != nullptr ? str->str : eval_const_iden(iden->identifier));
+    if (n.kind == node_kind::string || n.kind == node_kind::identifier) {
+      auto &ss = state.scratch;
+      ss.assign(n.kind == node_kind::string ? ast.str(n.text)
+                                            : eval_const_iden(ast.str(n.text)));
 
-      while ((cursor+1) != end) {
+      while ((cursor + 1) != end) {
         auto peek = cursor + 1;
 
-        if (peek->type != token_type::concat && peek->type != token_type::space_concat) break;
+        if (peek->type != token_type::concat &&
+            peek->type != token_type::space_concat)
+          break;
 
         auto rhs = peek + 1;
-        if (rhs == end) throw parse_failure("expected an expression after '&' or '&&'");
+        if (rhs == end)
+          throw parse_failure("expected an expression after '&' or '&&'");
 
-        if (rhs->type == token_type::identifier && is_iden_const(rhs->value)) {
-          const char *const_val = eval_const_iden(rhs->value);
+        if (rhs->type == token_type::identifier && is_iden_const(text(*rhs))) {
+          const char *const_val = eval_const_iden(text(*rhs));
 
-          if (peek->type != token_type::space_concat) ss.append(" ");
+          if (peek->type == token_type::space_concat)
+            ss.append(" ");
           ss.append(const_val);
 
           cursor = rhs;
         } else if (rhs->type == token_type::string) {
-          if (peek->type != token_type::space_concat) ss.append(" ");
-          ss.append(rhs->value);
+          if (peek->type == token_type::space_concat)
+            ss.append(" ");
+          ss.append(text(*rhs));
           cursor = rhs;
-        }
-        else break;
+        } else
+          break;
       }
 
-      expr = std::make_unique<String>(ss);
+      n.kind = node_kind::string;
+      n.text = ast.intern(ss);
     }
   }
 
-
   return expr;
 }
 
-std::unique_ptr<Node> parse(const std::string &str, bool flat_tree) {
-  if (str.empty())
-    return nullptr;
-
-  const auto tokens = tokenize(str);
+template <typename Token>
+tree parse_tokens(const std::vector<Token> &tokens, bool flat_tree) {
+  tree ast;
 
   if (tokens.empty())
-    return nullptr;
+    return ast;
+
+  // most tokens of a level file are punctuation
+  ast.reserve(tokens.size() / 2 + 1);
+
+  parse_state state{ast, flat_tree, {}, {}, {}, {}};
 
   auto cursor = tokens.begin();
-  auto end = tokens.end();
+  ast.set_root(parse_helper<Token>(state, cursor, tokens.end(), 0));
+
+  return ast;
+}
 
-  auto expr = parse_helper(cursor, tokens.end(), 0, flat_tree);
+tree parse(std::string_view str, bool flat_tree) {
+  if (str.empty())
+    return tree();
 
-  return expr;
+  return parse_tokens(tokenize_view(str), flat_tree);
 }
-std::unique_ptr<Node> parse(const std::vector<token> &tokens, bool flat_tree) {
-  if (tokens.empty())
-    return nullptr;
 
-  auto cursor = tokens.begin();
-  auto end = tokens.end();
+tree parse(const std::vector<token> &tokens, bool flat_tree) {
+  return parse_tokens(tokens, flat_tree);
+}
 
-  auto expr = parse_helper(cursor, tokens.end(), 0, flat_tree);
+tree parse(const std::vector<token_view> &tokens, bool flat_tree) {
+  return parse_tokens(tokens, flat_tree);
+}
 
-  return expr;
+namespace {
+/// Tokens straight off the lexer, with the lookahead the grammar needs.
+class token_reader {
+private:
+  lexer lexer_;
+  token_view ahead_[2];
+  int count_;
+
+public:
+  /// @return null past the end.
+  const token_view *peek(int n = 0) {
+    while (count_ <= n) {
+      if (!lexer_.next(ahead_[count_]))
+        return nullptr;
+      count_++;
+    }
+
+    return &ahead_[n];
+  }
+
+  /// @throws parse_failure past the end.
+  token_view take(const char *expected) {
+    if (peek() == nullptr)
+      throw parse_failure(expected);
+
+    const token_view token = ahead_[0];
+    ahead_[0] = ahead_[1];
+    count_--;
+
+    return token;
+  }
+
+  bool next_is(token_type type) {
+    const auto *token = peek();
+    return token != nullptr && token->type == type;
+  }
+
+  /// @brief See lexer::integers; only tried with nothing looked ahead.
+  bool integers(std::vector<int32_t> &numbers) {
+    return count_ == 0 && lexer_.integers(numbers);
+  }
+
+  bool floats(std::vector<float> &numbers) {
+    return count_ == 0 && lexer_.floats(numbers);
+  }
+
+  explicit token_reader(std::string_view str) : lexer_(str), count_(0) {}
+};
+
+/// Parses operands that are thrown away.
+class skip_handler : public handler {
+public:
+  void on_void() override {}
+  void on_integer(int) override {}
+  void on_floating(float) override {}
+  void on_string(std::string_view) override {}
+  void on_symbol(std::string_view) override {}
+  void begin_list() override {}
+  void end_list() override {}
+  void begin_props() override {}
+  void on_key(std::string_view) override {}
+  void end_props() override {}
+  void begin_call(std::string_view) override {}
+  void end_call() override {}
+};
+
+struct stream_state {
+  token_reader in;
+  skip_handler skip;
+  std::string scratch;
+  std::vector<int32_t> integers;
+  std::vector<float> floats;
+};
+
+void stream_value(stream_state &state, handler &out);
+
+void stream_collection(stream_state &state, handler &out) {
+  auto &in = state.in;
+
+  // most of a level file is lists of small numbers
+  if (in.integers(state.integers)) {
+    out.on_integers(state.integers.data(), state.integers.size());
+    return;
+  }
+
+  if (in.floats(state.floats)) {
+    out.on_floats(state.floats.data(), state.floats.size());
+    return;
+  }
+  const auto *peek = in.peek();
+
+  if (peek == nullptr)
+    throw parse_failure("collection expression ended prematurely");
+
+  // empty linear list
+  if (peek->type == token_type::close_bracket) {
+    in.take("");
+
+    out.begin_list();
+    out.end_list();
+    return;
+  }
+
+  // empty property list
+  if (peek->type == token_type::colon) {
+    in.take("");
+
+    if (in.take("empty property list expression ended prematurely").type !=
+        token_type::close_bracket)
+      throw parse_failure(
+          "invalid empty property list expression (expected ']')");
+
+    out.begin_props();
+    out.end_props();
+    return;
+  }
+
+  // a list of symbols isn't a property list. Only a symbol is looked past:
+  // the second token of a nested list would be its first number, which keeps
+  // the nested list off the packed path
+  const bool is_props = peek->type == token_type::symbol &&
+                        in.peek(1) != nullptr &&
+                        in.peek(1)->type == token_type::colon;
+
+  if (is_props)
+    out.begin_props();
+  else
+    out.begin_list();
+
+  while (true) {
+    if (is_props) {
+      const auto key = in.take("property list expression ended prematurely "
+                               "(expected a symbol)");
+
+      if (key.type != token_type::symbol)
+        throw parse_failure(
+            "invalid property list expression (expected a symbol)");
+
+      state.scratch.assign(key.value());
+      std::transform(state.scratch.begin(), state.scratch.end(),
+                     state.scratch.begin(), ::tolower);
+
+      out.on_key(state.scratch);
+
+      if (in.take("property list expression ended prematurely "
+                  "(expected a colon)")
+              .type != token_type::colon)
+        throw parse_failure(
+            "invalid property list expression (expected a colon)");
+
+      if (in.peek() == nullptr)
+        throw parse_failure("property list expression ended prematurely "
+                            "(expected an expression)");
+
+      stream_value(state, out);
+
+      const auto next =
+          in.take("property list expression ended prematurely "
+                  "(expected a comma or a closing square bracket)");
+
+      if (next.type == token_type::close_bracket)
+        break;
+      if (next.type != token_type::comma)
+        throw parse_failure(
+            "invalid property list expression (expected a comma)");
+    } else {
+      if (in.peek() == nullptr)
+        throw parse_failure("collection expression ended prematurely");
+
+      stream_value(state, out);
+
+      const auto next = in.take(
+          "linear list expression ended prematurely (expected a comma)");
+
+      if (next.type == token_type::close_bracket)
+        break;
+      if (next.type != token_type::comma)
+        throw parse_failure(
+            "invalid linear list expression (expected a comma)");
+    }
+  }
+
+  if (is_props)
+    out.end_props();
+  else
+    out.end_list();
+}
+
+void stream_call(stream_state &state, handler &out, std::string_view name) {
+  auto &in = state.in;
+
+  // the opening parentheses
+  in.take("");
+
+  out.begin_call(name);
+
+  if (in.peek() == nullptr)
+    throw parse_failure("global call expression ended prematurely "
+                        "(expected a closing parentheses)");
+
+  // no arguments
+  if (in.next_is(token_type::close_paren)) {
+    in.take("");
+    out.end_call();
+    return;
+  }
+
+  while (true) {
+    stream_value(state, out);
+
+    const auto next =
+        in.take("global call expression ended prematurely "
+                "(expected a comma or a closing parentheses)");
+
+    if (next.type == token_type::close_paren)
+      break;
+    if (next.type != token_type::comma)
+      throw parse_failure(
+          "global call expression ended prematurely (expected a comma)");
+
+    if (in.peek() == nullptr)
+      throw parse_failure("global call expression ended prematurely "
+                          "(expected an expression)");
+  }
+
+  out.end_call();
+}
+
+void stream_value(stream_state &state, handler &out) {
+  auto &in = state.in;
+  const auto token = in.take("expected an expression");
+
+  switch (token.type) {
+  // pre-evaluate signed numbers; anything else can't be
+  case token_type::add:
+  case token_type::subtract: {
+    bool negative = token.type == token_type::subtract;
+
+    while (in.next_is(token_type::add) || in.next_is(token_type::subtract)) {
+      if (in.take("").type == token_type::subtract)
+        negative = !negative;
+    }
+
+    if (in.next_is(token_type::integer)) {
+      const int number = to_number<int>(in.take("").value());
+      out.on_integer(negative ? -number : number);
+    } else if (in.next_is(token_type::floating)) {
+      const float number = to_number<float>(in.take("").value());
+      out.on_floating(negative ? -number : number);
+    } else {
+      if (in.peek() == nullptr)
+        throw parse_failure("expected an expression");
+
+      stream_value(state, state.skip);
+      out.on_void();
+    }
+  } break;
+
+  case token_type::negate:
+    if (in.peek() == nullptr)
+      throw parse_failure("expected an expression");
+
+    stream_value(state, state.skip);
+    out.on_void();
+    break;
+
+  case token_type::integer:
+    out.on_integer(to_number<int>(token.value()));
+    break;
+
+  case token_type::floating:
+    out.on_floating(to_number<float>(token.value()));
+    break;
+
+  case token_type::symbol:
+    out.on_symbol(token.value());
+    break;
+
+  case token_type::identifier:
+    // pre-evaluate global calls
+    if (in.next_is(token_type::open_paren)) {
+      stream_call(state, out, token.value());
+      break;
+    }
+
+    [[fallthrough]];
+
+  case token_type::string: {
+    auto &ss = state.scratch;
+    ss.assign(token.type == token_type::string ? token.value()
+                                               : eval_const_iden(token.value()));
+
+    while (in.next_is(token_type::concat) ||
+           in.next_is(token_type::space_concat)) {
+      const auto *rhs = in.peek(1);
+
+      if (rhs == nullptr)
+        throw parse_failure("expected an expression after '&' or '&&'");
+
+      const bool is_const =
+          rhs->type == token_type::identifier && is_iden_const(rhs->value());
+
+      if (!is_const && rhs->type != token_type::string)
+        break;
+
+      // '&&' puts a space in between
+      if (in.take("").type == token_type::space_concat)
+        ss.append(" ");
+
+      const auto value = in.take("").value();
+      ss.append(is_const ? eval_const_iden(value) : value);
+    }
+
+    out.on_string(ss);
+  } break;
+
+  case token_type::open_bracket:
+    stream_collection(state, out);
+    break;
+
+  default:
+    out.on_void();
+    break;
+  }
+}
+} // namespace
+
+void parse(std::string_view str, handler &out) {
+  stream_state state{token_reader(str), {}, {}, {}, {}};
+
+  if (state.in.peek() == nullptr)
+    return;
+
+  stream_value(state, out);
+}
+
+void handler::on_integers(const int32_t *numbers, size_t count) {
+  begin_list();
+  for (size_t i = 0; i < count; i++)
+    on_integer(numbers[i]);
+  end_list();
+}
+
+void handler::on_floats(const float *numbers, size_t count) {
+  begin_list();
+  for (size_t i = 0; i < count; i++)
+    on_floating(numbers[i]);
+  end_list();
+}
+
+namespace {
+/// @brief Walks a tree, calling the handler the way the streaming parser would.
+struct replayer {
+  const tree &ast;
+  handler &out;
+
+  void replay(node_id id) { ast.visit(id, *this); }
+
+  void on_void() { out.on_void(); }
+  void on_integer(int number) { out.on_integer(number); }
+  void on_floating(float number) { out.on_floating(number); }
+  void on_string(std::string_view str) { out.on_string(str); }
+  void on_symbol(std::string_view str) { out.on_symbol(str); }
+
+  // a flat tree only keeps what couldn't be pre-evaluated
+  void on_identifier(std::string_view) { out.on_void(); }
+  void on_unary(unary_operation, node_id) { out.on_void(); }
+
+  void on_list(children entries) {
+    out.begin_list();
+    for (const auto &entry : entries)
+      replay(entry.value);
+    out.end_list();
+  }
+
+  void on_integers(packed<int32_t> numbers) {
+    out.on_integers(numbers.first, numbers.size());
+  }
+
+  void on_floats(packed<float> numbers) {
+    out.on_floats(numbers.first, numbers.size());
+  }
+
+  void on_props(children entries) {
+    out.begin_props();
+    for (const auto &entry : entries) {
+      out.on_key(ast.str(entry.key));
+      replay(entry.value);
+    }
+    out.end_props();
+  }
+
+  void on_call(std::string_view name, children args) {
+    out.begin_call(name);
+    for (const auto &arg : args)
+      replay(arg.value);
+    out.end_call();
+  }
+};
+} // namespace
+
+void parse(const tree &ast, handler &out) {
+  if (ast.empty())
+    return;
+
+  replayer{ast, out}.replay(ast.root());
 }
 }; // namespace mp
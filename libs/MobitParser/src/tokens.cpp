@@ -1,4 +1,8 @@
+#include <array>
+#include <charconv>
+#include <cstring>
 #include <fstream>
+#include <iterator>
 #include <string>
 #include <vector>
 
@@ -98,1005 +102,402 @@ std::ostream &operator<<(std::ostream &stream, const token &token) {
 token::token(token_type type, const std::string &&value)
     : type(type), value(value) {}
 
-std::vector<token> tokenize(std::ifstream &file) {
-  std::vector<token> tokens;
-
-  char c;
-  auto pos = file.tellg();
-
-  while (file.get(c)) {
-    switch (c) {
-    case ' ':
-    case '\t': {
-    } break;
-
-    case '[':
-      tokens.push_back(token(token_type::open_bracket, "["));
-      break;
-    case ']':
-      tokens.push_back(token(token_type::close_bracket, "]"));
-      break;
-
-    case '(':
-      tokens.push_back(token(token_type::open_paren, "("));
-      break;
-    case ')':
-      tokens.push_back(token(token_type::close_paren, ")"));
-      break;
-
-    case ',':
-      tokens.push_back(token(token_type::comma, ","));
-      break;
-    case ':':
-      tokens.push_back(token(token_type::colon, ":"));
-      break;
-
-    case '#': {
-      std::string symbol;
-
-      while (file.peek() != EOF && isalnum(file.peek())) {
-        symbol.push_back(file.get());
-      }
-
-      tokens.push_back(token(token_type::symbol, std::move(symbol)));
-    } break;
-
-    case '"': {
-      std::string _str;
-
-      char peeked;
-      while (file.get(peeked) && peeked != '"') {
-        _str.push_back(peeked);
-      }
-
-      tokens.push_back(token(token_type::string, std::move(_str)));
-    } break;
-
-    case '>': {
-      if (char peeked = file.peek()) {
-        if (peeked == '=') {
-          tokens.push_back(token(token_type::greater_or_eq, ">="));
-          file.get();
-        } else {
-          tokens.push_back(token(token_type::greater, ">"));
-        }
-      } else {
-          tokens.push_back(token(token_type::greater, ">"));
-      }
-    } break;
-
-    case '<': {
-      if (char peeked = file.peek()) {
-        if (peeked == '=') {
-          tokens.push_back(token(token_type::smaller_or_eq, "<="));
-          file.get();
-        } else if (peeked == '>') {
-          tokens.push_back(token(token_type::inequal, "<>"));
-          file.get();
-        } else {
-          tokens.push_back(token(token_type::greater, "<"));
-        }
-      } else {
-          tokens.push_back(token(token_type::greater, "<"));
-      }
-    } break;
-
-    case '=': {
-      tokens.push_back(token(token_type::equal, "="));
-
-    } break;
-
-    case '&': {
-      auto saved_pos = file.tellg();
-      char peeked;
-      if (file.get(peeked)) {
-        if (peeked == '&') {
-
-          tokens.push_back(token(token_type::space_concat, "&&"));
-        } else {
-          file.seekg(saved_pos);
-          tokens.push_back(token(token_type::concat, "&"));
-        }
-      } else {
-        file.seekg(saved_pos);
-        tokens.push_back(token(token_type::concat, "&"));
-      }
-    } break;
-
-    case '-':
-      tokens.push_back(token(token_type::subtract, "-"));
-      break;
-    case '+':
-      tokens.push_back(token(token_type::add, "+"));
-      break;
-    case '*':
-      tokens.push_back(token(token_type::multiply, "*"));
-      break;
-    case '/':
-      tokens.push_back(token(token_type::divide, "/"));
-      break;
-
-    case '0':
-    case '1':
-    case '2':
-    case '3':
-    case '4':
-    case '5':
-    case '6':
-    case '7':
-    case '8':
-    case '9': {
-      std::string number;
-
-      number.push_back(c);
-
-      bool floating = false;
-
-      while ((isdigit(file.peek()) || file.peek() == '.')) {
-        char peeked = file.get();
-        
-        if (peeked == '.') {
-          if (floating)
-            throw double_decimal_point(
-                "floating number cannot have more than one decimal point");
-
-          floating = true;
-          number.push_back(peeked);
-        } else {
-          number.push_back(peeked);
-        }
-      }
-
-      if (floating) {
-        tokens.push_back(token(token_type::floating, std::move(number)));
-      } else {
-        tokens.push_back(token(token_type::integer, std::move(number)));
-      }
-    } break;
-
-    case 'n': {
-      char peeked;
-
-      if ((file.get(peeked) && peeked == 'o' && file.get(peeked) &&
-           peeked == 't')) {
+namespace {
+enum class char_kind : uint8_t {
+  blank,     // spaces and tabs
+  line_break,
+  single,    // a whole token by itself
+  other
+};
 
-        tokens.push_back(token(token_type::negate, "not"));
-        break;
-      } else {
-        file.seekg(pos);
-      }
+struct char_info {
+  char_kind kind;
+  token_type single;
+  bool alnum;
+};
 
-      break;
-    }
+constexpr std::array<char_info, 256> make_char_table() {
+  std::array<char_info, 256> table{};
 
-    case 'a': {
-      char peeked;
+  for (auto &info : table)
+    info = char_info{char_kind::other, token_type::identifier, false};
 
-      if ((file.get(peeked) && peeked == 'n' && file.get(peeked) &&
-           peeked == 'd')) {
+  for (int c = '0'; c <= '9'; c++)
+    table[c].alnum = true;
+  for (int c = 'a'; c <= 'z'; c++)
+    table[c].alnum = true;
+  for (int c = 'A'; c <= 'Z'; c++)
+    table[c].alnum = true;
 
-        tokens.push_back(token(token_type::and_, "and"));
-        break;
-      } else {
-        file.seekg(pos);
-      }
+  table[' '].kind = char_kind::blank;
+  table['\t'].kind = char_kind::blank;
+  table['\r'].kind = char_kind::line_break;
+  table['\n'].kind = char_kind::line_break;
 
-      break;
-    }
+  const std::pair<char, token_type> singles[] = {
+      {'[', token_type::open_bracket}, {']', token_type::close_bracket},
+      {'(', token_type::open_paren},   {')', token_type::close_paren},
+      {',', token_type::comma},        {':', token_type::colon},
+      {'=', token_type::equal},        {'-', token_type::subtract},
+      {'+', token_type::add},          {'*', token_type::multiply},
+      {'/', token_type::divide}};
 
-    case 'o': {
-      char peeked;
+  for (const auto &[c, type] : singles)
+    table[static_cast<unsigned char>(c)] = char_info{char_kind::single, type, false};
 
-      if ((file.get(peeked) && peeked == 'r')) {
-        tokens.push_back(token(token_type::or_, "or"));
-        break;
-      } else {
-        file.seekg(pos);
-      }
+  return table;
+}
 
-      break;
-    }
+constexpr auto char_table = make_char_table();
 
-    case 'm': {
-      char peeked;
+inline const char_info &info(char c) {
+  return char_table[static_cast<unsigned char>(c)];
+}
 
-      if ((file.get(peeked) && peeked == 'o' && file.get(peeked) &&
-           peeked == 'd')) {
+inline bool is_alnum(char c) { return info(c).alnum; }
 
-        tokens.push_back(token(token_type::mod, "mod"));
-        break;
-      } else {
-        file.seekg(pos);
-      }
+inline bool is_space(char c) { return info(c).kind <= char_kind::line_break; }
 
-      break;
-    }
+inline bool is_digit(char c) { return c >= '0' && c <= '9'; }
 
-    case 'v': {
-      char peeked;
+inline const char *skip_alnum(const char *cursor, const char *end) {
+  while (cursor != end && is_alnum(*cursor))
+    cursor++;
+  return cursor;
+}
 
-      if ((file.get(peeked) && peeked == 'o' && file.get(peeked) &&
-           peeked == 'i' && file.get(peeked) && peeked == 'd')) {
+inline token_view make_view(token_type type, const char *begin,
+                            const char *end) {
+  return token_view{type, static_cast<uint32_t>(end - begin), begin};
+}
 
-        tokens.push_back(token(token_type::void_val, "void"));
-        break;
-      } else {
-        file.seekg(pos);
-      }
+/// Reads the token starting at the cursor, which isn't whitespace, and
+/// returns the position right after it.
+const char *scan(const char *cursor, const char *end, token_view &token) {
+  const char *begin = cursor;
 
-      break;
-    }
+  const auto &c = info(*cursor);
 
-    // identifier
-    default: {
-      std::string iden;
-      iden.push_back(c);
+  // most of a level file is brackets and commas
+  if (c.kind == char_kind::single) {
+    token = make_view(c.single, begin, cursor + 1);
+    return cursor + 1;
+  }
 
-      auto saved_pos = file.tellg();
-      char peeked;
+  switch (*cursor) {
+  case '#': {
+    const char *name_end = skip_alnum(cursor + 1, end);
+    token = make_view(token_type::symbol, cursor + 1, name_end);
+    return name_end;
+  }
 
-      while (file.get(peeked) && isalnum(peeked)) {
-        iden.push_back(peeked);
-        saved_pos = file.tellg();
-      }
+  case '"': {
+    // an unterminated string runs to the end
+    const char *close = static_cast<const char *>(
+        std::memchr(cursor + 1, '"', static_cast<size_t>(end - cursor - 1)));
 
-      tokens.push_back(token(token_type::identifier, std::move(iden)));
-      file.seekg(saved_pos);
-    } break;
+    if (close == nullptr) {
+      token = make_view(token_type::string, cursor + 1, end);
+      return end;
     }
 
-    pos = file.tellg();
+    token = make_view(token_type::string, cursor + 1, close);
+    return close + 1;
   }
-  return tokens;
-}
-
-std::vector<token> tokenize_line(std::ifstream &file) {
-  std::vector<token> tokens;
-
-  char c;
-  auto pos = file.tellg();
 
-  while (file.get(c)) {
-    if (c == '\r') 
-      return tokens;
-    if (c == '\n')
-      return tokens;
-
-    switch (c) {
-    case ' ':
-    case '\r':
-    case '\n':
-    case '\t': {
-    } break;
-
-    case '[':
-      tokens.push_back(token(token_type::open_bracket, "["));
-      break;
-    case ']':
-      tokens.push_back(token(token_type::close_bracket, "]"));
-      break;
-
-    case '(':
-      tokens.push_back(token(token_type::open_paren, "("));
-      break;
-    case ')':
-      tokens.push_back(token(token_type::close_paren, ")"));
-      break;
-
-    case ',':
-      tokens.push_back(token(token_type::comma, ","));
-      break;
-    case ':':
-      tokens.push_back(token(token_type::colon, ":"));
-      break;
-
-    case '#': {
-      std::string symbol;
-
-      auto saved_pos = file.tellg();
-
-      while (file.peek() != EOF && isalnum(file.peek())) {
-        symbol.push_back(file.get());
-      }
-
-      tokens.push_back(token(token_type::symbol, std::move(symbol)));
-    } break;
-
-    case '"': {
-      std::string _str;
-
-      char peeked;
-      while (file.get(peeked) && peeked != '"') {
-        _str.push_back(peeked);
-      }
-
-      tokens.push_back(token(token_type::string, std::move(_str)));
-    } break;
-
-    case '>': {
-      if (char peeked = file.peek()) {
-        if (peeked == '=') {
-          tokens.push_back(token(token_type::greater_or_eq, ">="));
-          file.get();
-        } else {
-          tokens.push_back(token(token_type::greater, ">"));
-        }
-      } else {
-          tokens.push_back(token(token_type::greater, ">"));
-      }
-    } break;
-
-    case '<': {
-      if (char peeked = file.peek()) {
-        if (peeked == '=') {
-          tokens.push_back(token(token_type::smaller_or_eq, "<="));
-          file.get();
-        } else if (peeked == '>') {
-          tokens.push_back(token(token_type::inequal, "<>"));
-          file.get();
-        } else {
-          tokens.push_back(token(token_type::greater, "<"));
-        }
-      } else {
-          tokens.push_back(token(token_type::greater, "<"));
-      }
-    } break;
-
-    case '=': {
-      tokens.push_back(token(token_type::equal, "="));
-
-    } break;
-
-    case '&': {
-      auto saved_pos = file.tellg();
-      char peeked;
-      if (file.get(peeked)) {
-        if (peeked == '&') {
-
-          tokens.push_back(token(token_type::space_concat, "&&"));
-        } else {
-          file.seekg(saved_pos);
-          tokens.push_back(token(token_type::concat, "&"));
-        }
-      } else {
-        file.seekg(saved_pos);
-        tokens.push_back(token(token_type::concat, "&"));
-      }
-    } break;
-
-    case '-':
-      tokens.push_back(token(token_type::subtract, "-"));
-      break;
-    case '+':
-      tokens.push_back(token(token_type::add, "+"));
-      break;
-    case '*':
-      tokens.push_back(token(token_type::multiply, "*"));
-      break;
-    case '/':
-      tokens.push_back(token(token_type::divide, "/"));
-      break;
-
-    case '0':
-    case '1':
-    case '2':
-    case '3':
-    case '4':
-    case '5':
-    case '6':
-    case '7':
-    case '8':
-    case '9': {
-      std::string number;
-
-      number.push_back(c);
-
-      bool floating = false;
-
-      while ((isdigit(file.peek()) || file.peek() == '.')) {
-        char peeked = file.get();
-
-        if (peeked == '.') {
-          if (floating)
-            throw double_decimal_point(
-                "floating number cannot have more than one decimal point");
-
-          floating = true;
-          number.push_back(peeked);
-        } else {
-          number.push_back(peeked);
-        }
-      }
-
-      if (floating) {
-        tokens.push_back(token(token_type::floating, std::move(number)));
-      } else {
-        tokens.push_back(token(token_type::integer, std::move(number)));
-      }
-    } break;
-
-    case 'n': {
-      char peeked;
-
-      if ((file.get(peeked) && peeked == 'o' && file.get(peeked) &&
-           peeked == 't')) {
-
-        tokens.push_back(token(token_type::negate, "not"));
-        break;
-      } else {
-        file.seekg(pos);
-      }
-
-      break;
+  case '>':
+    if (cursor + 1 != end && cursor[1] == '=') {
+      token = make_view(token_type::greater_or_eq, begin, cursor + 2);
+      return cursor + 2;
     }
 
-    case 'a': {
-      char peeked;
-
-      if ((file.get(peeked) && peeked == 'n' && file.get(peeked) &&
-           peeked == 'd')) {
+    token = make_view(token_type::greater, begin, cursor + 1);
+    return cursor + 1;
 
-        tokens.push_back(token(token_type::and_, "and"));
-        break;
-      } else {
-        file.seekg(pos);
-      }
-
-      break;
+  case '<':
+    if (cursor + 1 != end && cursor[1] == '=') {
+      token = make_view(token_type::smaller_or_eq, begin, cursor + 2);
+      return cursor + 2;
     }
-
-    case 'o': {
-      char peeked;
-
-      if ((file.get(peeked) && peeked == 'r')) {
-        tokens.push_back(token(token_type::or_, "or"));
-        break;
-      } else {
-        file.seekg(pos);
-      }
-
-      break;
+    if (cursor + 1 != end && cursor[1] == '>') {
+      token = make_view(token_type::inequal, begin, cursor + 2);
+      return cursor + 2;
     }
 
-    case 'm': {
-      char peeked;
-
-      if ((file.get(peeked) && peeked == 'o' && file.get(peeked) &&
-           peeked == 'd')) {
+    token = make_view(token_type::smaller, begin, cursor + 1);
+    return cursor + 1;
 
-        tokens.push_back(token(token_type::mod, "mod"));
-        break;
-      } else {
-        file.seekg(pos);
-      }
-
-      break;
+  case '&':
+    if (cursor + 1 != end && cursor[1] == '&') {
+      token = make_view(token_type::space_concat, begin, cursor + 2);
+      return cursor + 2;
     }
 
-    case 'v': {
-      char peeked;
-
-      if ((file.get(peeked) && peeked == 'o' && file.get(peeked) &&
-           peeked == 'i' && file.get(peeked) && peeked == 'd')) {
-
-        tokens.push_back(token(token_type::void_val, "void"));
+    token = make_view(token_type::concat, begin, cursor + 1);
+    return cursor + 1;
+
+  case '0':
+  case '1':
+  case '2':
+  case '3':
+  case '4':
+  case '5':
+  case '6':
+  case '7':
+  case '8':
+  case '9': {
+    bool floating = false;
+
+    for (cursor++; cursor != end; cursor++) {
+      if (*cursor == '.') {
+        if (floating)
+          throw double_decimal_point(
+              "floating number cannot have more than one decimal point");
+
+        floating = true;
+      } else if (!is_digit(*cursor)) {
         break;
-      } else {
-        file.seekg(pos);
       }
-
-      break;
     }
 
-    // identifier
-    default: {
-      std::string iden;
-      iden.push_back(c);
-
-      while (file.peek() != EOF && isalnum(file.peek())) {
-        iden.push_back(file.get());
-      }
-
-      tokens.push_back(token(token_type::identifier, std::move(iden)));
-    } break;
-    }
+    token = make_view(floating ? token_type::floating : token_type::integer,
+                      begin, cursor);
+    return cursor;
+  }
 
-    pos = file.tellg();
+  // identifiers and keywords
+  default: {
+    cursor = skip_alnum(cursor + 1, end);
+
+    const std::string_view word(begin, static_cast<size_t>(cursor - begin));
+    token_type type = token_type::identifier;
+
+    if (word == "not")
+      type = token_type::negate;
+    else if (word == "and")
+      type = token_type::and_;
+    else if (word == "or")
+      type = token_type::or_;
+    else if (word == "mod")
+      type = token_type::mod;
+    else if (word == "void")
+      type = token_type::void_val;
+
+    token = make_view(type, begin, cursor);
+    return cursor;
+  }
   }
-  return tokens;
 }
 
-bool tokenize_line(std::ifstream &file, std::vector<token> &tokens) {
-  tokens.clear();
-  bool result = true;
-
-  char c;
-  auto pos = file.tellg();
-
-  while (file.get(c)) {
-    if (c == '\r') 
-      return !tokens.empty();
-    if (c == '\n')
-      return !tokens.empty();
-
-    switch (c) {
-    case ' ':
-    case '\t': {
-    } break;
-
-    case '[':
-      tokens.push_back(token(token_type::open_bracket, "["));
-      break;
-    case ']':
-      tokens.push_back(token(token_type::close_bracket, "]"));
-      break;
-
-    case '(':
-      tokens.push_back(token(token_type::open_paren, "("));
-      break;
-    case ')':
-      tokens.push_back(token(token_type::close_paren, ")"));
-      break;
-
-    case ',':
-      tokens.push_back(token(token_type::comma, ","));
-      break;
-    case ':':
-      tokens.push_back(token(token_type::colon, ":"));
-      break;
-
-    case '#': {
-      std::string symbol;
-
-      auto saved_pos = file.tellg();
-
-      while (file.peek() != EOF && isalnum(file.peek())) {
-        symbol.push_back(file.get());
-      }
-
-      tokens.push_back(token(token_type::symbol, std::move(symbol)));
-    } break;
-
-    case '"': {
-      std::string _str;
-
-      char peeked;
-      while (file.get(peeked) && peeked != '"') {
-        _str.push_back(peeked);
-      }
-
-      tokens.push_back(token(token_type::string, std::move(_str)));
-    } break;
-
-    case '>': {
-      if (char peeked = file.peek()) {
-        if (peeked == '=') {
-          tokens.push_back(token(token_type::greater_or_eq, ">="));
-          file.get();
-        } else {
-          tokens.push_back(token(token_type::greater, ">"));
-        }
-      } else {
-          tokens.push_back(token(token_type::greater, ">"));
-      }
-    } break;
-
-    case '<': {
-      if (char peeked = file.peek()) {
-        if (peeked == '=') {
-          tokens.push_back(token(token_type::smaller_or_eq, "<="));
-          file.get();
-        } else if (peeked == '>') {
-          tokens.push_back(token(token_type::inequal, "<>"));
-          file.get();
-        } else {
-          tokens.push_back(token(token_type::greater, "<"));
-        }
-      } else {
-          tokens.push_back(token(token_type::greater, "<"));
-      }
-    } break;
-
-    case '=': {
-      tokens.push_back(token(token_type::equal, "="));
-
-    } break;
-
-    case '&': {
-      if (file.peek() == '&') {
-        file.get();
-        tokens.push_back(token(token_type::space_concat, "&&"));
-      } else {
-        tokens.push_back(token(token_type::concat, "&"));
-      }
-    } break;
-
-    case '-':
-      tokens.push_back(token(token_type::subtract, "-"));
-      break;
-    case '+':
-      tokens.push_back(token(token_type::add, "+"));
-      break;
-    case '*':
-      tokens.push_back(token(token_type::multiply, "*"));
-      break;
-    case '/':
-      tokens.push_back(token(token_type::divide, "/"));
-      break;
-
-    case '0':
-    case '1':
-    case '2':
-    case '3':
-    case '4':
-    case '5':
-    case '6':
-    case '7':
-    case '8':
-    case '9': {
-      std::string number;
-
-      number.push_back(c);
-
-      bool floating = false;
-
-      while ((isdigit(file.peek()) || file.peek() == '.')) {
-        char peeked = file.get();
-        if (peeked == '.') {
-          if (floating)
-            throw double_decimal_point(
-                "floating number cannot have more than one decimal point");
-
-          floating = true;
-          number.push_back(peeked);
-        } else {
-          number.push_back(peeked);
-        }
-      }
-
-      if (floating) {
-        tokens.push_back(token(token_type::floating, std::move(number)));
-      } else {
-        tokens.push_back(token(token_type::integer, std::move(number)));
-      }
-    } break;
-
-    case 'n': {
-      char peeked;
+inline const char *skip_spaces(const char *cursor, const char *end) {
+  while (cursor != end && is_space(*cursor))
+    cursor++;
+  return cursor;
+}
 
-      if ((file.get(peeked) && peeked == 'o' && file.get(peeked) &&
-           peeked == 't')) {
+/// Reads an unsigned number at the cursor, which is a digit, the way the
+/// parser would read its token.
+/// @return null if it isn't a number of the type, or doesn't fit in it.
+const char *scan_number(const char *cursor, const char *end, int32_t &number) {
+  const char *digits = cursor;
+  uint32_t value = 0;
 
-        tokens.push_back(token(token_type::negate, "not"));
-        break;
-      } else {
-        file.seekg(pos);
-      }
-
-      break;
-    }
+  while (cursor != end && is_digit(*cursor)) {
+    value = value * 10 + static_cast<uint32_t>(*cursor - '0');
+    cursor++;
+  }
 
-    case 'a': {
-      char peeked;
+  // longer ones may not fit; the parser reports those
+  if (cursor - digits > 9 || (cursor != end && (*cursor == '.' || is_alnum(*cursor))))
+    return nullptr;
 
-      if ((file.get(peeked) && peeked == 'n' && file.get(peeked) &&
-           peeked == 'd')) {
+  number = static_cast<int32_t>(value);
+  return cursor;
+}
 
-        tokens.push_back(token(token_type::and_, "and"));
-        break;
-      } else {
-        file.seekg(pos);
-      }
+const char *scan_number(const char *cursor, const char *end, float &number) {
+  const char *digits = cursor;
+  int points = 0;
 
+  for (; cursor != end; cursor++) {
+    if (*cursor == '.')
+      points++;
+    else if (!is_digit(*cursor))
       break;
-    }
+  }
 
-    case 'o': {
-      char peeked;
+  if (points != 1 || (cursor != end && is_alnum(*cursor)))
+    return nullptr;
 
-      if ((file.get(peeked) && peeked == 'r')) {
-        tokens.push_back(token(token_type::or_, "or"));
-        break;
-      } else {
-        file.seekg(pos);
-      }
+  if (std::from_chars(digits, cursor, number).ec != std::errc())
+    return nullptr;
 
-      break;
-    }
+  return cursor;
+}
 
-    case 'm': {
-      char peeked;
+/// Reads the rest of a list of numbers of one type, signed the way the
+/// parser folds them.
+/// @return the position past the closing bracket, or null if the list holds
+/// anything else.
+template <typename Number>
+const char *scan_numbers(const char *cursor, const char *end,
+                         std::vector<Number> &numbers) {
+  numbers.clear();
 
-      if ((file.get(peeked) && peeked == 'o' && file.get(peeked) &&
-           peeked == 'd')) {
+  while (true) {
+    cursor = skip_spaces(cursor, end);
 
-        tokens.push_back(token(token_type::mod, "mod"));
-        break;
-      } else {
-        file.seekg(pos);
-      }
+    bool negative = false;
 
-      break;
+    if (cursor != end && *cursor == '-') {
+      negative = true;
+      cursor = skip_spaces(cursor + 1, end);
     }
 
-    case 'v': {
-      char peeked;
+    if (cursor == end || !is_digit(*cursor))
+      return nullptr;
 
-      if ((file.get(peeked) && peeked == 'o' && file.get(peeked) &&
-           peeked == 'i' && file.get(peeked) && peeked == 'd')) {
+    Number number;
+    if ((cursor = scan_number(cursor, end, number)) == nullptr)
+      return nullptr;
 
-        tokens.push_back(token(token_type::void_val, "void"));
-        break;
-      } else {
-        file.seekg(pos);
-      }
+    numbers.push_back(negative ? -number : number);
 
-      break;
-    }
+    cursor = skip_spaces(cursor, end);
 
-    // identifier
-    default: {
-      std::string iden;
-      iden.push_back(c);
-
-      while (file.peek() != EOF && isalnum(file.peek())) {
-        iden.push_back(file.get());
-      }
-
-      tokens.push_back(token(token_type::identifier, std::move(iden)));
-    } break;
-    }
+    if (cursor == end)
+      return nullptr;
+    if (*cursor == ']')
+      return cursor + 1;
+    if (*cursor != ',')
+      return nullptr;
 
-    pos = file.tellg();
+    cursor++;
   }
-  return !tokens.empty();
 }
 
-std::vector<token> tokenize(const std::string &str) {
-  if (str.size() == 0)
-    return {};
+inline token to_token(const token_view &view) {
+  return token(view.type, std::string(view.value()));
+}
 
+std::vector<token> to_tokens(const std::vector<token_view> &views) {
   std::vector<token> tokens;
+  tokens.reserve(views.size());
 
-  auto cursor = str.begin();
-
-  do {
-
-    switch (*cursor) {
-    case ' ':
-    case '\r':
-    case '\n':
-    case '\t': {
-    } break;
-
-    case '[':
-      tokens.push_back(token(token_type::open_bracket, "["));
-      break;
-    case ']':
-      tokens.push_back(token(token_type::close_bracket, "]"));
-      break;
-
-    case '(':
-      tokens.push_back(token(token_type::open_paren, "("));
-      break;
-    case ')':
-      tokens.push_back(token(token_type::close_paren, ")"));
-      break;
-
-    case ',':
-      tokens.push_back(token(token_type::comma, ","));
-      break;
-    case ':':
-      tokens.push_back(token(token_type::colon, ":"));
-      break;
-
-    case '#': {
-      std::string symbol;
-
-      auto peek = cursor + 1;
+  for (const auto &view : views)
+    tokens.push_back(to_token(view));
 
-      while (peek != str.end() && isalnum(*peek)) {
-        symbol.push_back(*peek);
-        peek++;
-      }
-
-      tokens.push_back(token(token_type::symbol, std::move(symbol)));
-      cursor = peek - 1;
-    } break;
-
-    case '"': {
-      std::string _str;
-
-      auto peek = cursor + 1;
-
-      while (peek != str.end() && *peek != '"') {
-        _str.push_back(*peek);
-        ++peek;
-      }
+  return tokens;
+}
+} // namespace
 
-      tokens.push_back(token(token_type::string, std::move(_str)));
-      cursor = peek;
-    } break;
+bool lexer::next(token_view &token) {
+  while (cursor_ != end_ && is_space(*cursor_))
+    cursor_++;
 
-    case '>': {
-      auto peek = cursor + 1;
+  if (cursor_ == end_)
+    return false;
 
-      if (peek != str.end() && *peek == '=') {
-        cursor++;
+  cursor_ = scan(cursor_, end_, token);
+  return true;
+}
 
-        tokens.push_back(token(token_type::greater_or_eq, ">="));
-      } else {
-        tokens.push_back(token(token_type::greater, ">"));
-      }
-    } break;
-
-    case '<': {
-      auto peek = cursor + 1;
-
-      if (peek != str.end()) {
-        if (*peek == '=') {
-          cursor++;
-          tokens.push_back(token(token_type::smaller_or_eq, "<="));
-        } else if (*peek == '>') {
-          cursor++;
-          tokens.push_back(token(token_type::inequal, "<>"));
-        }
-
-      } else {
-        tokens.push_back(token(token_type::smaller, "<"));
-      }
-    } break;
+bool lexer::next_line(std::vector<token_view> &tokens) {
+  tokens.clear();
 
-    case '=': {
-      tokens.push_back(token(token_type::equal, "="));
+  if (cursor_ == end_)
+    return false;
 
-    } break;
+  while (cursor_ != end_) {
+    const char c = *cursor_;
 
-    case '&': {
-      auto peek = cursor + 1;
+    if (c == ' ' || c == '\t') {
+      cursor_++;
+      continue;
+    }
 
-      if (peek != str.end() && *peek == '&') {
-        cursor++;
+    if (c == '\r' || c == '\n') {
+      cursor_++;
 
-        tokens.push_back(token(token_type::space_concat, "&&"));
-      } else {
-        tokens.push_back(token(token_type::concat, "&"));
-      }
-    } break;
+      if (c == '\r' && cursor_ != end_ && *cursor_ == '\n')
+        cursor_++;
 
-    case '-':
-      tokens.push_back(token(token_type::subtract, "-"));
       break;
-    case '+':
-      tokens.push_back(token(token_type::add, "+"));
-      break;
-    case '*':
-      tokens.push_back(token(token_type::multiply, "*"));
-      break;
-    case '/':
-      tokens.push_back(token(token_type::divide, "/"));
-      break;
-
-    case '0':
-    case '1':
-    case '2':
-    case '3':
-    case '4':
-    case '5':
-    case '6':
-    case '7':
-    case '8':
-    case '9': {
-      std::string number;
-
-      number.push_back(*cursor);
-
-      auto peek = cursor + 1;
-      bool floating = false;
-
-      while (peek != str.end() && (isdigit(*peek) || *peek == '.')) {
-        if (*peek == '.') {
-          if (floating)
-            throw double_decimal_point(
-                "floating number cannot have more than one decimal point");
-
-          floating = true;
-          number.push_back(*peek);
-        } else {
-          number.push_back(*peek);
-        }
-
-        peek++;
-      }
-
-      cursor = peek - 1;
-
-      if (floating) {
-        tokens.push_back(token(token_type::floating, std::move(number)));
-      } else {
-        tokens.push_back(token(token_type::integer, std::move(number)));
-      }
-    } break;
-
-    case 'n': {
-      auto peek = cursor;
+    }
 
-      if (!(++peek == str.end() || *peek != 'o' || ++peek == str.end() ||
-            *peek != 't')) {
+    token_view token;
+    cursor_ = scan(cursor_, end_, token);
+    tokens.push_back(token);
+  }
 
-        tokens.push_back(token(token_type::negate, "not"));
-        cursor = peek;
-        break;
-      }
-    }
+  return true;
+}
 
-    case 'a': {
-      auto peek = cursor;
+bool lexer::integers(std::vector<int32_t> &numbers) {
+  const char *after = scan_numbers(cursor_, end_, numbers);
+  if (after == nullptr)
+    return false;
 
-      if (!(++peek == str.end() || *peek != 'n' || ++peek == str.end() ||
-            *peek != 'd')) {
+  cursor_ = after;
+  return true;
+}
 
-        tokens.push_back(token(token_type::and_, "and"));
-        cursor = peek;
-        break;
-      }
-    }
+bool lexer::floats(std::vector<float> &numbers) {
+  const char *after = scan_numbers(cursor_, end_, numbers);
+  if (after == nullptr)
+    return false;
 
-    case 'o': {
-      auto peek = cursor;
+  cursor_ = after;
+  return true;
+}
 
-      if (!(++peek == str.end() || *peek != 'r')) {
-        tokens.push_back(token(token_type::or_, "or"));
-        cursor = peek;
-        break;
-      }
-    }
+lexer::lexer(std::string_view source)
+    : cursor_(source.data()), end_(source.data() + source.size()) {}
 
-    case 'm': {
-      auto peek = cursor;
+std::vector<token_view> tokenize_view(std::string_view source) {
+  std::vector<token_view> tokens;
+  // a token every two characters or so, in level files
+  tokens.reserve(source.size() / 2 + 1);
 
-      if (!(++peek == str.end() || *peek != 'o' || ++peek == str.end() ||
-            *peek != 'd')) {
+  lexer lex(source);
+  token_view token;
 
-        tokens.push_back(token(token_type::mod, "mod"));
-        cursor = peek;
-        break;
-      }
-    }
+  while (lex.next(token))
+    tokens.push_back(token);
 
-    case 'v': {
-      auto peek = cursor;
+  return tokens;
+}
 
-      if (!(++peek == str.end() || *peek != 'o' || ++peek == str.end() ||
-            *peek != 'i' || ++peek == str.end() || *peek != 'd')) {
+std::vector<token> tokenize(std::ifstream &file) {
+  const std::string text{std::istreambuf_iterator<char>(file),
+                         std::istreambuf_iterator<char>()};
 
-        tokens.push_back(token(token_type::void_val, "void"));
-        cursor = peek;
-        break;
-      }
-    }
+  return to_tokens(tokenize_view(text));
+}
 
-    // identifier
-    default: {
-      std::string iden;
-      iden.push_back(*cursor);
+std::vector<token> tokenize_line(std::ifstream &file) {
+  std::vector<token> tokens;
+  tokenize_line(file, tokens);
+  return tokens;
+}
 
-      auto peek = cursor + 1;
+bool tokenize_line(std::ifstream &file, std::vector<token> &tokens) {
+  tokens.clear();
 
-      while (peek != str.end() && isalnum(*peek)) {
-        iden.push_back(*peek);
-        ++peek;
-      }
+  std::string line;
+  if (!std::getline(file, line))
+    return false;
 
-      tokens.push_back(token(token_type::identifier, std::move(iden)));
-      cursor = peek - 1;
-    } break;
-    }
+  lexer lex(line);
+  token_view token;
 
-    cursor++;
+  while (lex.next(token))
+    tokens.push_back(to_token(token));
 
-  } while (cursor != str.end());
+  return !tokens.empty();
+}
 
-  return tokens;
-};
+std::vector<token> tokenize(const std::string &str) {
+  return to_tokens(tokenize_view(str));
+}
 }; // namespace mp
@@ -1,13 +1,19 @@
 #include <iostream>
 #include <memory>
 #include <string>
+#include <stdexcept>
+#include <filesystem>
 
 #include <Orbit/Lua/runtime.h>
+#include <Orbit/Lua/castindex.h>
+#include <Orbit/Lua/castpack.h>
 #include <Orbit/shaders.h>
 #include <Orbit/paths.h>
 #include <Orbit/config.h>
+#include <Orbit/profiler.h>
 
 #include <spdlog/spdlog.h>
+#include <spdlog/async.h>
 #include <spdlog/sinks/basic_file_sink.h>
 
 #include <raylib.h>
@@ -20,24 +26,104 @@ using std::make_shared;
 using std::unique_ptr;
 using std::make_unique;
 
-int main(int, char**) {
+// Drains the log queue once main returns, after everything that logs is gone.
+struct LogQueue {
+    ~LogQueue() { spdlog::shutdown(); }
+};
+
+struct Options {
+    // run without presenting anything, as fast as possible
+    bool headless = false;
+    // when false, no graphics context is created at all
+    bool gpu = true;
+    // stop after this many frames; negative means until _movie.halt()
+    long frames = -1;
+    std::filesystem::path output;
+    // pack data/Cast into data/Cast.pack and exit
+    bool pack = false;
+    // keep the images PNG-encoded in the pack
+    bool compress = false;
+};
+
+const char *USAGE = 
+    "usage: Orbit [--headless] [--no-gpu] [--frames <count>] [--output <directory>]\n"
+    "       Orbit --pack-cast [--compress]";
+
+Options parse_options(int argc, char **argv) {
+    Options options;
+
+    for (int i = 1; i < argc; i++) {
+        const std::string arg(argv[i]);
+
+        if (arg == "--headless") {
+            options.headless = true;
+        }
+        else if (arg == "--no-gpu") {
+            options.headless = true;
+            options.gpu = false;
+        }
+        else if (arg == "--frames" && i + 1 < argc) {
+            options.frames = std::stol(argv[++i]);
+        }
+        else if (arg == "--output" && i + 1 < argc) {
+            options.output = argv[++i];
+        }
+        else if (arg == "--pack-cast") {
+            options.pack = true;
+        }
+        else if (arg == "--compress") {
+            options.compress = true;
+        }
+        else {
+            throw std::invalid_argument("unknown argument '" + arg + "'");
+        }
+    }
+
+    return options;
+}
+
+int main(int argc, char **argv) {
+    Options options;
+
+    try {
+        options = parse_options(argc, argv);
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << '\n' << USAGE << std::endl;
+        return 1;
+    }
+
     shared_ptr<Orbit::Paths> paths = make_shared<Orbit::Paths>();
 	
     shared_ptr<Orbit::Config> config = make_shared<Orbit::Config>(paths->config());
     shared_ptr<spdlog::logger> logger = nullptr;
+    LogQueue log_queue;
 	
     // Initializing logging
     try {
 
         #ifdef _WIN32
-        logger = spdlog::basic_logger_mt("main logger", (paths->logs() / "logs.txt").string());
+        const char *name = "main logger";
         #else
-        logger = spdlog::basic_logger_mt("main", (paths->logs() / "logs.txt"));
+        const char *name = "main";
         #endif
 
-        #ifdef DEBUG
-        logger->set_level(spdlog::level::level_enum::debug);
-        #endif
+        // Written by a background thread, so logging doesn't wait for the disk
+        spdlog::init_thread_pool(static_cast<size_t>(config->log_queue_size), 1);
+
+        logger = make_shared<spdlog::async_logger>(
+            name,
+            make_shared<spdlog::sinks::basic_file_sink_mt>((paths->logs() / "logs.txt").string()),
+            spdlog::thread_pool(),
+            config->log_overflow == Orbit::Config::LogOverflow::Drop
+                ? spdlog::async_overflow_policy::overrun_oldest
+                : spdlog::async_overflow_policy::block
+        );
+
+        spdlog::register_logger(logger);
+
+        // Messages below the level are dropped before they're formatted
+        logger->set_level(config->log_level);
+        logger->flush_on(spdlog::level::err);
 
     } catch (const spdlog::spdlog_ex &ex) {
         std::cout << "initializing logger has failed" << std::endl;
@@ -48,20 +134,61 @@ int main(int, char**) {
 
 	logger->info("------------------------------------ starting program");
 
-	logger->info(std::string("Orbit v") + APP_VERSION);
+	logger->info("Orbit v{}", APP_VERSION);
+
+    if (options.pack) {
+        const auto castpath = paths->data() / "Cast";
+        const auto packpath = paths->data() / "Cast.pack";
+
+        logger->info("packing {} into {}", castpath.string(), packpath.string());
+
+        try {
+            Orbit::Lua::CastIndex index(castpath, paths->data() / "Cast.index");
+            index.update();
+
+            Orbit::Lua::CastPack::build(index, packpath, options.compress);
+
+            index.save();
+
+            logger->info("packed {} cast members", index.entries().size());
+        } catch (const std::exception &e) {
+            std::cerr << e.what() << std::endl;
+            logger->error("packing the cast has failed: {}", e.what());
+            return 1;
+        }
+
+        logger->info("------------------------------------ program terminated");
 
+        return 0;
+    }
 	
-	logger->info("initializing window");
+    if (options.gpu) {
+        logger->info("initializing window");
+
+        if (options.headless) {
+            SetConfigFlags(FLAG_WINDOW_HIDDEN);
+        } else {
+            SetTargetFPS(config->fps);
+        }
 
-    SetTargetFPS(config->fps);
-	InitWindow(config->width, config->height, "Orbit Runtime");
+        InitWindow(config->width, config->height, "Orbit Runtime");
+    } else {
+        logger->info("running without a graphics context");
+    }
 
-    shared_ptr<Orbit::Shaders> shaders = make_shared<Orbit::Shaders>();
+    shared_ptr<Orbit::Shaders> shaders = options.gpu ? make_shared<Orbit::Shaders>() : nullptr;
 
 	logger->info("initializing runtime");
 
+    if (config->profile) {
+        logger->info("profiling enabled");
+        Orbit::profiler.enable();
+    }
+
 	auto rt = Orbit::Lua::LuaRuntime(config->width, config->height, paths, logger, shaders, config);
 
+    if (!options.output.empty()) rt.set_output(options.output);
+
 	logger->info("loading cast members");
 
     logger->debug("registered cast libraries:");
@@ -69,10 +196,49 @@ int main(int, char**) {
         logger->debug("CastLib: {0}", l->name());
     }
 
+    if (options.headless) {
+        if (options.frames < 0) logger->warn("no frame limit was given; running until a script calls _movie.halt()");
+
+        long frame = 0;
+
+        try {
+            logger->info("loading scripts");
+
+            rt.load_scripts();
+
+            logger->info("running initial script");
+
+            rt.init();
+
+            logger->info("begin headless loop");
+
+            for (; !rt.halted() && (options.frames < 0 || frame < options.frames); frame++) {
+                rt.process_frame();
+            }
+        } catch (const std::exception &e) {
+            std::cerr << e.what() << std::endl;
+            logger->error("headless run has failed: {}", e.what());
+
+            if (options.gpu) CloseWindow();
+            return 1;
+        }
+
+        logger->info("processed {} frames", frame);
+
+        if (Orbit::profiler.enabled()) Orbit::profiler.write_trace(paths->logs() / "trace.json");
+        if (rt.sampler().attached()) rt.sampler().write(paths->logs() / "lua.folded");
+
+        if (options.gpu) CloseWindow();
+
+        logger->info("------------------------------------ program terminated");
+
+        return 0;
+    }
+
 	logger->info("loading scripts");
 
 	rt.load_scripts();
-    
+
     BeginDrawing();
     ClearBackground(GRAY);
     EndDrawing();
@@ -83,9 +249,11 @@ int main(int, char**) {
 
     logger->info("begin window loop");
 
-	while (!WindowShouldClose()) {
+	while (!WindowShouldClose() && !rt.halted()) {
         rt.process_frame();
 
+        if (IsKeyPressed(KEY_F3)) Orbit::profiler.overlay = !Orbit::profiler.overlay;
+
 		BeginDrawing();
 		{
             // rt.draw_frame();
@@ -94,10 +262,14 @@ int main(int, char**) {
             shaders->flipper.prepare(rt.viewport.texture);
             DrawTexture(rt.viewport.texture, 0, 0, WHITE);
             EndShaderMode();
+
+            Orbit::profiler.draw_overlay();
         }
 		EndDrawing();
 	}
 
+    if (Orbit::profiler.enabled()) Orbit::profiler.write_trace(paths->logs() / "trace.json");
+    if (rt.sampler().attached()) rt.sampler().write(paths->logs() / "lua.folded");
 
 	CloseWindow();
 	
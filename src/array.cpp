@@ -0,0 +1,774 @@
+#include <new>
+#include <cmath>
+#include <limits>
+#include <bitset>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <algorithm>
+#include <type_traits>
+
+#include <Orbit/Lua/runtime.h>
+#include <Orbit/Lua/array.h>
+#include <Orbit/Lua/fields.h>
+
+#include <xsimd/xsimd.hpp>
+
+extern "C" {
+    #include <lua.h>
+    #include <lauxlib.h>
+    #include <lualib.h>
+}
+
+#define META "array"
+
+static constexpr auto FIELDS = Orbit::Lua::fields(
+	"type", "size", "dimensions", "shape", "get", "set", "slice", "clone",
+	"fill", "copy", "map", "count", "sum", "totable"
+);
+
+namespace Orbit::Lua {
+
+namespace {
+
+// Truncated, and clamped to the range of the type
+template <typename T>
+inline T convert(double value) {
+	if constexpr (std::is_floating_point_v<T>) {
+		return static_cast<T>(value);
+	} else {
+		if (std::isnan(value)) return 0;
+
+		value = std::clamp(
+			value,
+			static_cast<double>(std::numeric_limits<T>::min()),
+			static_cast<double>(std::numeric_limits<T>::max())
+		);
+
+		return static_cast<T>(value);
+	}
+}
+
+// Integers wrap around like they do in the batches
+template <typename T>
+inline T apply(Array::Op op, T a, T b) {
+	using wide = std::conditional_t<std::is_floating_point_v<T>, T, int64_t>;
+
+	switch (op) {
+		case Array::Op::Add: return static_cast<T>(static_cast<wide>(a) + b);
+		case Array::Op::Subtract: return static_cast<T>(static_cast<wide>(a) - b);
+		case Array::Op::Multiply: return static_cast<T>(static_cast<wide>(a) * b);
+		case Array::Op::Divide: return static_cast<T>(static_cast<wide>(a) / b);
+		case Array::Op::Min: return std::min(a, b);
+		case Array::Op::Max: return std::max(a, b);
+	}
+
+	return a;
+}
+
+template <typename T>
+inline xsimd::batch<T> apply(Array::Op op, const xsimd::batch<T> &a, const xsimd::batch<T> &b) {
+	switch (op) {
+		case Array::Op::Add: return a + b;
+		case Array::Op::Subtract: return a - b;
+		case Array::Op::Multiply: return a * b;
+		case Array::Op::Divide: return a / b;
+		case Array::Op::Min: return xsimd::min(a, b);
+		case Array::Op::Max: return xsimd::max(a, b);
+	}
+
+	return a;
+}
+
+template <typename F>
+decltype(auto) dispatch(Array::Type type, F &&fn) {
+	switch (type) {
+		case Array::Type::Int8: return fn(int8_t{});
+		case Array::Type::Int16: return fn(int16_t{});
+		case Array::Type::Int32: return fn(int32_t{});
+		case Array::Type::Float32:
+		default: return fn(float{});
+	}
+}
+
+};
+
+size_t Array::type_size(Type type) {
+	return dispatch(type, [](auto tag) { return sizeof(tag); });
+}
+
+const char *Array::type_name(Type type) {
+	switch (type) {
+		case Type::Int8: return "int8";
+		case Type::Int16: return "int16";
+		case Type::Int32: return "int32";
+		case Type::Float32: return "float32";
+	}
+
+	return "";
+}
+
+bool Array::find_type(std::string_view name, Type &type) {
+	for (const auto candidate : { Type::Int8, Type::Int16, Type::Int32, Type::Float32 }) {
+		if (name == type_name(candidate)) {
+			type = candidate;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+size_t Array::size() const {
+	size_t size = 1;
+	for (int d = 0; d < _dimensions; d++) size *= _shape[d];
+	return size;
+}
+
+bool Array::contiguous() const {
+	size_t stride = 1;
+
+	for (int d = _dimensions - 1; d >= 0; d--) {
+		if (_shape[d] > 1 && _strides[d] != stride) return false;
+		stride *= _shape[d];
+	}
+
+	return true;
+}
+
+bool Array::same_shape(const Array &other) const {
+	if (_dimensions != other._dimensions) return false;
+
+	for (int d = 0; d < _dimensions; d++) {
+		if (_shape[d] != other._shape[d]) return false;
+	}
+
+	return true;
+}
+
+size_t Array::_runs() const {
+	size_t runs = 1;
+	for (int d = 0; d < _dimensions - 1; d++) runs *= _shape[d];
+	return runs;
+}
+
+size_t Array::_run(size_t run) const {
+	size_t offset = 0;
+
+	for (int d = _dimensions - 2; d >= 0; d--) {
+		offset += (run % _shape[d]) * _strides[d];
+		run /= _shape[d];
+	}
+
+	return offset;
+}
+
+// Calls fn(elements, length, step) for every run of the last dimension, or
+// once for the whole array if it's contiguous.
+template <typename T, typename F>
+void Array::_each_run(F &&fn) const {
+	if (size() == 0) return;
+
+	if (contiguous()) {
+		fn(_data<T>(), size(), size_t(1));
+		return;
+	}
+
+	const size_t runs = _runs();
+	const size_t length = _shape[_dimensions - 1];
+	const size_t step = _strides[_dimensions - 1];
+
+	for (size_t r = 0; r < runs; r++) fn(_data<T>() + _run(r), length, step);
+}
+
+template <typename T>
+void Array::_fill(double value) {
+	using batch = xsimd::batch<T>;
+
+	const T element = convert<T>(value);
+	const batch elements(element);
+
+	_each_run<T>([&](T *data, size_t length, size_t step) {
+		size_t i = 0;
+
+		if (step == 1) {
+			for (; i + batch::size <= length; i += batch::size) elements.store_unaligned(data + i);
+		}
+
+		for (; i < length; i++) data[i * step] = element;
+	});
+}
+
+template <typename T>
+void Array::_map(Op op, double value) {
+	using batch = xsimd::batch<T>;
+
+	const T operand = convert<T>(value);
+	const batch operands(operand);
+
+	// Integer batches are only divided lane by lane
+	const bool batched = std::is_floating_point_v<T> || op != Op::Divide;
+
+	_each_run<T>([&](T *data, size_t length, size_t step) {
+		size_t i = 0;
+
+		if (batched && step == 1) {
+			for (; i + batch::size <= length; i += batch::size) {
+				apply(op, batch::load_unaligned(data + i), operands).store_unaligned(data + i);
+			}
+		}
+
+		for (; i < length; i++) data[i * step] = apply(op, data[i * step], operand);
+	});
+}
+
+template <typename T>
+size_t Array::_count(double value) const {
+	using batch = xsimd::batch<T>;
+
+	const T element = convert<T>(value);
+
+	// No element can be equal to a number the type can't hold. Floats are
+	// compared rounded, the way fill() stores them
+	if constexpr (!std::is_floating_point_v<T>) {
+		if (static_cast<double>(element) != value) return 0;
+	}
+
+	const batch elements(element);
+	size_t count = 0;
+
+	_each_run<T>([&](const T *data, size_t length, size_t step) {
+		size_t i = 0;
+
+		if (step == 1) {
+			for (; i + batch::size <= length; i += batch::size) {
+				count += std::bitset<64>((batch::load_unaligned(data + i) == elements).mask()).count();
+			}
+		}
+
+		for (; i < length; i++) count += data[i * step] == element;
+	});
+
+	return count;
+}
+
+template <typename T>
+double Array::_sum() const {
+	// Integers are summed exactly
+	using total_type = std::conditional_t<std::is_floating_point_v<T>, double, int64_t>;
+	total_type total = 0;
+
+	_each_run<T>([&](const T *data, size_t length, size_t step) {
+		for (size_t i = 0; i < length; i++) total += data[i * step];
+	});
+
+	return static_cast<double>(total);
+}
+
+template <typename T, typename U>
+void Array::_copy(const Array &from) {
+	if (std::is_same_v<T, U> && contiguous() && from.contiguous()) {
+		std::memmove(_data<T>(), from._data<U>(), size() * sizeof(T));
+		return;
+	}
+
+	// A view of the same buffer may overlap
+	if (from._storage == _storage) {
+		_copy<T, U>(from.clone());
+		return;
+	}
+
+	const size_t runs = _runs();
+	const size_t length = _shape[_dimensions - 1];
+	const size_t to_step = _strides[_dimensions - 1];
+	const size_t from_step = from._strides[_dimensions - 1];
+
+	for (size_t r = 0; r < runs; r++) {
+		T *to = _data<T>() + _run(r);
+		const U *elements = from._data<U>() + from._run(r);
+
+		for (size_t i = 0; i < length; i++) to[i * to_step] = convert<T>(static_cast<double>(elements[i * from_step]));
+	}
+}
+
+double Array::get(const size_t *indexes) const {
+	size_t offset = 0;
+	for (int d = 0; d < _dimensions; d++) offset += indexes[d] * _strides[d];
+
+	return dispatch(_type, [&](auto tag) {
+		return static_cast<double>(_data<decltype(tag)>()[offset]);
+	});
+}
+
+void Array::set(const size_t *indexes, double value) {
+	size_t offset = 0;
+	for (int d = 0; d < _dimensions; d++) offset += indexes[d] * _strides[d];
+
+	dispatch(_type, [&](auto tag) {
+		using T = decltype(tag);
+		_data<T>()[offset] = convert<T>(value);
+	});
+}
+
+Array Array::at(size_t index) const {
+	Array array(*this);
+
+	array._offset += index * _strides[0];
+	array._dimensions--;
+
+	for (int d = 0; d < array._dimensions; d++) {
+		array._shape[d] = _shape[d + 1];
+		array._strides[d] = _strides[d + 1];
+	}
+
+	return array;
+}
+
+Array Array::slice(size_t first, size_t last, size_t step) const {
+	Array array(*this);
+
+	array._offset += first * _strides[0];
+	array._shape[0] = last > first ? (last - first + step - 1) / step : 0;
+	array._strides[0] = _strides[0] * step;
+
+	return array;
+}
+
+Array Array::clone() const {
+	Array array(_type, _shape.data(), _dimensions);
+	array.copy(*this);
+	return array;
+}
+
+void Array::fill(double value) {
+	dispatch(_type, [&](auto tag) { _fill<decltype(tag)>(value); });
+}
+
+void Array::copy(const Array &from) {
+	if (!same_shape(from)) throw std::invalid_argument("arrays have different shapes");
+
+	dispatch(_type, [&](auto to) {
+		dispatch(from._type, [&](auto elements) {
+			_copy<decltype(to), decltype(elements)>(from);
+		});
+	});
+}
+
+void Array::map(Op op, double value) {
+	dispatch(_type, [&](auto tag) { _map<decltype(tag)>(op, value); });
+}
+
+size_t Array::count(double value) const {
+	return dispatch(_type, [&](auto tag) { return _count<decltype(tag)>(value); });
+}
+
+double Array::sum() const {
+	return dispatch(_type, [&](auto tag) { return _sum<decltype(tag)>(); });
+}
+
+Array::Array(Type type, const size_t *shape, int dimensions) :
+	_storage(nullptr),
+	_type(type),
+	_dimensions(dimensions),
+	_offset(0),
+	_shape({}),
+	_strides({}) {
+	if (dimensions < 1 || dimensions > MAX_DIMENSIONS) throw std::invalid_argument("arrays have 1 to 4 dimensions");
+
+	size_t size = 1;
+
+	for (int d = dimensions - 1; d >= 0; d--) {
+		_shape[d] = shape[d];
+		_strides[d] = size;
+
+		if (shape[d] > MAX_SIZE || (size *= shape[d]) > MAX_SIZE) throw std::invalid_argument("array is too large");
+	}
+
+	// Zeroed
+	_storage = std::shared_ptr<char[]>(new char[std::max<size_t>(size, 1) * type_size(type)]());
+}
+
+void push_array(lua_State *L, const Array &array);
+
+};
+
+using Orbit::Lua::Array;
+
+inline Array *check_array(lua_State *L, int index) {
+	return static_cast<Array *>(luaL_checkudata(L, index, META));
+}
+
+// Takes a 1-based index of the dimension, and returns it 0-based.
+size_t check_array_index(lua_State *L, int arg, const Array &array, int dimension) {
+	const lua_Integer index = luaL_checkinteger(L, arg);
+	const auto size = static_cast<lua_Integer>(array.shape(dimension));
+
+	if (index < 1 || index > size) {
+		luaL_error(L, "array index %d is out of range (1 to %d)", static_cast<int>(index), static_cast<int>(size));
+	}
+
+	return static_cast<size_t>(index - 1);
+}
+
+void push_element(lua_State *L, const Array &array, const size_t *indexes) {
+	const double value = array.get(indexes);
+
+	if (array.type() == Array::Type::Float32) lua_pushnumber(L, value);
+	else lua_pushinteger(L, static_cast<lua_Integer>(value));
+}
+
+// Fills the array from the nested tables at the index, one per dimension.
+void read_table(lua_State *L, int index, Array &array, size_t *indexes, int dimension) {
+	const size_t length = lua_rawlen(L, index);
+
+	if (length != array.shape(dimension)) luaL_error(L, "array rows must all have the same length");
+
+	const bool last = dimension == array.dimensions() - 1;
+
+	for (size_t i = 0; i < length; i++) {
+		indexes[dimension] = i;
+
+		lua_rawgeti(L, index, static_cast<lua_Integer>(i + 1));
+
+		if (last) {
+			if (lua_type(L, -1) != LUA_TNUMBER) luaL_error(L, "array elements must be numbers");
+			array.set(indexes, lua_tonumber(L, -1));
+		} else {
+			if (!lua_istable(L, -1)) luaL_error(L, "array rows must all have the same length");
+			read_table(L, lua_gettop(L), array, indexes, dimension + 1);
+		}
+
+		lua_pop(L, 1);
+	}
+}
+
+void push_table(lua_State *L, const Array &array, size_t *indexes, int dimension) {
+	const size_t length = array.shape(dimension);
+	const bool last = dimension == array.dimensions() - 1;
+
+	luaL_checkstack(L, 2, "array is too deep");
+	lua_createtable(L, static_cast<int>(length), 0);
+
+	for (size_t i = 0; i < length; i++) {
+		indexes[dimension] = i;
+
+		if (last) push_element(L, array, indexes);
+		else push_table(L, array, indexes, dimension + 1);
+
+		lua_rawseti(L, -2, static_cast<lua_Integer>(i + 1));
+	}
+}
+
+// array(type, size, ...) or array(type, table)
+int array_new(lua_State *L) {
+	size_t name_length = 0;
+	const char *name = luaL_checklstring(L, 1, &name_length);
+
+	Array::Type type;
+
+	if (!Array::find_type(std::string_view(name, name_length), type)) {
+		return luaL_error(L, "unknown array type '%s' (int8, int16, int32 or float32)", name);
+	}
+
+	size_t shape[Array::MAX_DIMENSIONS];
+	int dimensions = 0;
+
+	const bool from_table = lua_istable(L, 2);
+
+	// The shape of nested tables is the lengths of their first rows
+	if (from_table) {
+		lua_pushvalue(L, 2);
+
+		while (lua_istable(L, -1)) {
+			if (dimensions == Array::MAX_DIMENSIONS) return luaL_error(L, "arrays have at most %d dimensions", Array::MAX_DIMENSIONS);
+
+			shape[dimensions++] = lua_rawlen(L, -1);
+			if (shape[dimensions - 1] == 0) break;
+
+			lua_rawgeti(L, -1, 1);
+		}
+
+		lua_settop(L, 2);
+	} else {
+		dimensions = lua_gettop(L) - 1;
+
+		if (dimensions < 1 || dimensions > Array::MAX_DIMENSIONS) {
+			return luaL_error(L, "arrays have 1 to %d dimensions", Array::MAX_DIMENSIONS);
+		}
+
+		for (int d = 0; d < dimensions; d++) {
+			const lua_Integer size = luaL_checkinteger(L, d + 2);
+			if (size < 0) return luaL_argerror(L, d + 2, "negative size");
+
+			shape[d] = static_cast<size_t>(size);
+		}
+	}
+
+	size_t size = 1;
+
+	for (int d = 0; d < dimensions; d++) {
+		if (shape[d] > Array::MAX_SIZE || (size *= shape[d]) > Array::MAX_SIZE) return luaL_error(L, "array is too large");
+	}
+
+	// Owned by the userdata before anything can raise an error
+	auto *array = new (lua_newuserdata(L, sizeof(Array))) Array(type, shape, dimensions);
+	luaL_setmetatable(L, META);
+
+	if (from_table) {
+		size_t indexes[Array::MAX_DIMENSIONS] = {};
+		read_table(L, 2, *array, indexes, 0);
+	}
+
+	return 1;
+}
+
+int array_gc(lua_State *L) {
+	check_array(L, 1)->~Array();
+	return 0;
+}
+
+int array_len(lua_State *L) {
+	lua_pushinteger(L, static_cast<lua_Integer>(check_array(L, 1)->shape(0)));
+	return 1;
+}
+
+int array_tostring(lua_State *L) {
+	const Array *array = check_array(L, 1);
+
+	std::stringstream ss;
+	ss << "array(" << Array::type_name(array->type());
+
+	for (int d = 0; d < array->dimensions(); d++) ss << (d == 0 ? ", " : "x") << array->shape(d);
+
+	ss << ')';
+
+	lua_pushstring(L, ss.str().c_str());
+	return 1;
+}
+
+// array:shape() returns the size of every dimension
+int array_shape(lua_State *L) {
+	const Array *array = check_array(L, 1);
+
+	luaL_checkstack(L, array->dimensions(), nullptr);
+
+	for (int d = 0; d < array->dimensions(); d++) lua_pushinteger(L, static_cast<lua_Integer>(array->shape(d)));
+
+	return array->dimensions();
+}
+
+// array:get(i, j, ...), with fewer indexes than dimensions for a view
+int array_get(lua_State *L) {
+	const Array *array = check_array(L, 1);
+	const int count = lua_gettop(L) - 1;
+
+	if (count < 1 || count > array->dimensions()) return luaL_error(L, "array:get() takes 1 to %d indexes", array->dimensions());
+
+	size_t indexes[Array::MAX_DIMENSIONS];
+	for (int d = 0; d < count; d++) indexes[d] = check_array_index(L, d + 2, *array, d);
+
+	if (count == array->dimensions()) {
+		push_element(L, *array, indexes);
+		return 1;
+	}
+
+	Array view = array->at(indexes[0]);
+	for (int d = 1; d < count; d++) view = view.at(indexes[d]);
+
+	Orbit::Lua::push_array(L, view);
+	return 1;
+}
+
+// array:set(i, j, ..., value)
+int array_set(lua_State *L) {
+	Array *array = check_array(L, 1);
+	const int dimensions = array->dimensions();
+
+	if (lua_gettop(L) != dimensions + 2) return luaL_error(L, "array:set() takes %d indexes and a value", dimensions);
+
+	size_t indexes[Array::MAX_DIMENSIONS];
+	for (int d = 0; d < dimensions; d++) indexes[d] = check_array_index(L, d + 2, *array, d);
+
+	array->set(indexes, luaL_checknumber(L, dimensions + 2));
+	return 0;
+}
+
+// array:slice(first, last, step), along the first dimension
+int array_slice(lua_State *L) {
+	const Array *array = check_array(L, 1);
+	const auto size = static_cast<lua_Integer>(array->shape(0));
+
+	const lua_Integer first = luaL_optinteger(L, 2, 1);
+	const lua_Integer last = luaL_optinteger(L, 3, size);
+	const lua_Integer step = luaL_optinteger(L, 4, 1);
+
+	if (first < 1 || last > size || first > last + 1) return luaL_error(L, "invalid array slice %d to %d", static_cast<int>(first), static_cast<int>(last));
+	if (step < 1) return luaL_argerror(L, 4, "step must be positive");
+
+	Orbit::Lua::push_array(L, array->slice(static_cast<size_t>(first - 1), static_cast<size_t>(last), static_cast<size_t>(step)));
+	return 1;
+}
+
+int array_clone(lua_State *L) {
+	Orbit::Lua::push_array(L, check_array(L, 1)->clone());
+	return 1;
+}
+
+int array_fill(lua_State *L) {
+	check_array(L, 1)->fill(luaL_checknumber(L, 2));
+
+	lua_settop(L, 1);
+	return 1;
+}
+
+int array_copy(lua_State *L) {
+	Array *array = check_array(L, 1);
+	const Array *from = check_array(L, 2);
+
+	if (!array->same_shape(*from)) return luaL_error(L, "can't copy arrays of different shapes");
+
+	array->copy(*from);
+
+	lua_settop(L, 1);
+	return 1;
+}
+
+// array:map(op, value) with the op one of + - * / min max
+int array_map(lua_State *L) {
+	Array *array = check_array(L, 1);
+	const std::string_view name = luaL_checkstring(L, 2);
+	const double value = luaL_checknumber(L, 3);
+
+	Array::Op op;
+
+	if (name == "+") op = Array::Op::Add;
+	else if (name == "-") op = Array::Op::Subtract;
+	else if (name == "*") op = Array::Op::Multiply;
+	else if (name == "/") op = Array::Op::Divide;
+	else if (name == "min") op = Array::Op::Min;
+	else if (name == "max") op = Array::Op::Max;
+	else return luaL_argerror(L, 2, "unknown operation (+, -, *, /, min or max)");
+
+	// Integers can't be divided by what truncates to zero
+	if (op == Array::Op::Divide && array->type() != Array::Type::Float32 && std::trunc(value) == 0) {
+		return luaL_error(L, "division of an integer array by zero");
+	}
+
+	array->map(op, value);
+
+	lua_settop(L, 1);
+	return 1;
+}
+
+int array_count(lua_State *L) {
+	lua_pushinteger(L, static_cast<lua_Integer>(check_array(L, 1)->count(luaL_checknumber(L, 2))));
+	return 1;
+}
+
+int array_sum(lua_State *L) {
+	const Array *array = check_array(L, 1);
+	const double sum = array->sum();
+
+	if (array->type() == Array::Type::Float32) lua_pushnumber(L, sum);
+	else lua_pushinteger(L, static_cast<lua_Integer>(sum));
+
+	return 1;
+}
+
+int array_totable(lua_State *L) {
+	size_t indexes[Array::MAX_DIMENSIONS] = {};
+	push_table(L, *check_array(L, 1), indexes, 0);
+	return 1;
+}
+
+int array_index(lua_State *L) {
+	const Array *array = check_array(L, 1);
+
+	if (lua_type(L, 2) == LUA_TNUMBER) {
+		const size_t index = check_array_index(L, 2, *array, 0);
+
+		if (array->dimensions() == 1) push_element(L, *array, &index);
+		else Orbit::Lua::push_array(L, array->at(index));
+
+		return 1;
+	}
+
+	switch (FIELDS.find(L, 2)) {
+		case FIELDS["type"]: lua_pushstring(L, Array::type_name(array->type())); break;
+		case FIELDS["size"]: lua_pushinteger(L, static_cast<lua_Integer>(array->size())); break;
+		case FIELDS["dimensions"]: lua_pushinteger(L, array->dimensions()); break;
+		case FIELDS["shape"]: lua_pushcfunction(L, array_shape); break;
+		case FIELDS["get"]: lua_pushcfunction(L, array_get); break;
+		case FIELDS["set"]: lua_pushcfunction(L, array_set); break;
+		case FIELDS["slice"]: lua_pushcfunction(L, array_slice); break;
+		case FIELDS["clone"]: lua_pushcfunction(L, array_clone); break;
+		case FIELDS["fill"]: lua_pushcfunction(L, array_fill); break;
+		case FIELDS["copy"]: lua_pushcfunction(L, array_copy); break;
+		case FIELDS["map"]: lua_pushcfunction(L, array_map); break;
+		case FIELDS["count"]: lua_pushcfunction(L, array_count); break;
+		case FIELDS["sum"]: lua_pushcfunction(L, array_sum); break;
+		case FIELDS["totable"]: lua_pushcfunction(L, array_totable); break;
+		default: lua_pushnil(L);
+	}
+
+	return 1;
+}
+
+// array[i] = value; rows of a multi-dimensional array take a number to fill
+// them with, or an array of their shape to copy
+int array_newindex(lua_State *L) {
+	Array *array = check_array(L, 1);
+	const size_t index = check_array_index(L, 2, *array, 0);
+
+	if (array->dimensions() == 1) {
+		array->set(&index, luaL_checknumber(L, 3));
+		return 0;
+	}
+
+	Array row = array->at(index);
+
+	if (lua_type(L, 3) == LUA_TNUMBER) {
+		row.fill(lua_tonumber(L, 3));
+		return 0;
+	}
+
+	const Array *from = check_array(L, 3);
+
+	if (!row.same_shape(*from)) return luaL_error(L, "can't copy arrays of different shapes");
+
+	row.copy(*from);
+	return 0;
+}
+
+namespace Orbit::Lua {
+
+void push_array(lua_State *L, const Array &array) {
+	new (lua_newuserdata(L, sizeof(Array))) Array(array);
+	luaL_setmetatable(L, META);
+}
+
+void LuaRuntime::_register_array() {
+	luaL_newmetatable(L, META);
+
+	lua_pushcfunction(L, array_index);
+	lua_setfield(L, -2, "__index");
+
+	lua_pushcfunction(L, array_newindex);
+	lua_setfield(L, -2, "__newindex");
+
+	lua_pushcfunction(L, array_len);
+	lua_setfield(L, -2, "__len");
+
+	lua_pushcfunction(L, array_tostring);
+	lua_setfield(L, -2, "__tostring");
+
+	lua_pushcfunction(L, array_gc);
+	lua_setfield(L, -2, "__gc");
+
+	lua_pop(L, 1);
+
+	lua_pushcfunction(L, array_new);
+	lua_setglobal(L, "array");
+}
+
+};
@@ -0,0 +1,232 @@
+#include <Orbit/RlExt/atlas.h>
+#include <Orbit/profiler.h>
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <vector>
+
+#include <raylib.h>
+#include <rlgl.h>
+
+namespace Orbit::RlExt {
+
+// Pixels between regions (see _place)
+constexpr int GUTTER = 1;
+
+bool Atlas::Skyline::insert(int w, int h, int &x, int &y) {
+	if (w > width || h > height) return false;
+
+	size_t best = segments.size();
+	int best_top = INT_MAX, best_width = INT_MAX, best_y = 0;
+
+	for (size_t i = 0; i < segments.size(); i++) {
+		if (segments[i].x + w > width) break;
+
+		// The rectangle rests on the highest segment under it
+		int top = 0;
+		for (size_t j = i, remaining = w; remaining > 0; j++) {
+			top = std::max(top, segments[j].y);
+			remaining -= std::min<size_t>(remaining, segments[j].width);
+		}
+
+		if (top + h > height) continue;
+
+		if (top + h < best_top || (top + h == best_top && segments[i].width < best_width)) {
+			best = i;
+			best_top = top + h;
+			best_width = segments[i].width;
+			best_y = top;
+		}
+	}
+
+	if (best == segments.size()) return false;
+
+	x = segments[best].x;
+	y = best_y;
+
+	const Segment added{ x, y + h, w };
+	segments.insert(segments.begin() + best, added);
+
+	// Cut the segments the new one covers
+	for (size_t i = best + 1; i < segments.size();) {
+		auto &segment = segments[i];
+		const int covered = added.x + added.width - segment.x;
+
+		if (covered <= 0) break;
+
+		if (segment.width <= covered) {
+			segments.erase(segments.begin() + i);
+			continue;
+		}
+
+		segment.x += covered;
+		segment.width -= covered;
+		break;
+	}
+
+	for (size_t i = 0; i + 1 < segments.size();) {
+		if (segments[i].y == segments[i + 1].y) {
+			segments[i].width += segments[i + 1].width;
+			segments.erase(segments.begin() + i + 1);
+		} else {
+			i++;
+		}
+	}
+
+	return true;
+}
+
+void Atlas::Skyline::clear() {
+	segments.clear();
+	segments.push_back(Segment{ 0, 0, width });
+}
+
+bool Atlas::_place(const Image &image, Region &region) {
+	const int w = image.width + GUTTER;
+	const int h = image.height + GUTTER;
+
+	region.width = w;
+	region.height = h;
+
+	size_t page = 0;
+
+	for (; page < _pages.size(); page++) {
+		if (_pages[page].skyline.insert(w, h, region.x, region.y)) break;
+	}
+
+	if (page == _pages.size()) {
+		if (_pages.size() == MAX_PAGES) return false;
+
+		Page created{
+			Texture2D{
+				rlLoadTexture(nullptr, PAGE_SIZE, PAGE_SIZE, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8, 1),
+				PAGE_SIZE,
+				PAGE_SIZE,
+				1,
+				PIXELFORMAT_UNCOMPRESSED_R8G8B8A8
+			},
+			Skyline{ PAGE_SIZE, PAGE_SIZE, {} }
+		};
+
+		created.skyline.clear();
+
+		if (!created.skyline.insert(w, h, region.x, region.y)) return false;
+
+		_pages.push_back(created);
+	}
+
+	region.page = page;
+
+	// Regions are stored bottom-up, like every other canvas texture.
+	// The gutter repeats the first row and column, so that sampling right at the
+	// far edge wraps around the way it does on a texture of its own.
+	const size_t stride = static_cast<size_t>(image.width) * 4;
+	const size_t padded = static_cast<size_t>(w) * 4;
+	const auto *rows = static_cast<const unsigned char *>(image.data);
+
+	std::vector<unsigned char> flipped(padded * h);
+
+	for (int y = 0; y < h; y++) {
+		const auto *row = rows + ((image.height - 1 - y % image.height) * stride);
+		auto *out = flipped.data() + y * padded;
+
+		std::memcpy(out, row, stride);
+		for (int x = image.width; x < w; x++) std::memcpy(out + x * 4, row + (x % image.width) * 4, 4);
+	}
+
+	UpdateTextureRec(
+		_pages[page].texture,
+		Rectangle{ static_cast<float>(region.x), static_cast<float>(region.y), static_cast<float>(w), static_cast<float>(h) },
+		flipped.data()
+	);
+	Orbit::profiler.upload(flipped.size());
+
+	return true;
+}
+
+TextureView Atlas::view(Canvas &canvas) {
+	const Image &image = canvas.image;
+
+	// Borrowed pixels that are still current are the immutable ones from the cast cache
+	bool packable = canvas.shared && !canvas.cpu_stale &&
+		image.format == PIXELFORMAT_UNCOMPRESSED_R8G8B8A8 &&
+		image.width > 0 && image.height > 0 &&
+		image.width <= MAX_SIZE && image.height <= MAX_SIZE;
+
+	if (!packable) return TextureView{ canvas.texture(), Rectangle{ 0, 0, 1, 1 } };
+
+	const Image *key = canvas.shared.get();
+	auto found = _regions.find(key);
+
+	// The address may have been reused by pixels allocated since
+	if (found == _regions.end() || found->second.owner.lock() != canvas.shared) {
+		Region region{ canvas.shared, 0, 0, 0, 0, 0 };
+
+		if (!_place(image, region)) {
+			// Repacking re-uploads every region, so it's only worth it once a page's worth is free
+			if (_freed >= static_cast<size_t>(PAGE_SIZE) * PAGE_SIZE) _repack();
+			else clear();
+
+			if (!_place(image, region)) {
+				clear();
+
+				if (!_place(image, region)) return TextureView{ canvas.texture(), Rectangle{ 0, 0, 1, 1 } };
+			}
+		}
+
+		found = _regions.insert_or_assign(key, region).first;
+	}
+
+	const auto &region = found->second;
+	const float size = static_cast<float>(PAGE_SIZE);
+
+	return TextureView{
+		Texture2D{ _pages[region.page].texture.id, image.width, image.height, 1, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8 },
+		Rectangle{ region.x / size, region.y / size, image.width / size, image.height / size }
+	};
+}
+
+void Atlas::_repack() {
+	if (on_clear) on_clear();
+
+	for (auto &page : _pages) page.skyline.clear();
+
+	auto regions = std::move(_regions);
+	_regions.clear();
+	_freed = 0;
+
+	for (auto &[key, region] : regions) {
+		const auto owner = region.owner.lock();
+
+		if (owner != nullptr && _place(*owner, region)) _regions.insert({ key, region });
+	}
+}
+
+void Atlas::release(const Image *pixels) {
+	auto found = _regions.find(pixels);
+	if (found == _regions.end()) return;
+
+	// The space is only reclaimed by a repack, so draws still queued can sample it until then
+	_freed += static_cast<size_t>(found->second.width) * found->second.height;
+	_regions.erase(found);
+}
+
+void Atlas::clear() {
+	if (on_clear) on_clear();
+
+	for (auto &page : _pages) page.skyline.clear();
+	_regions.clear();
+	_freed = 0;
+}
+
+Atlas::Atlas() : _pages({}), _regions({}), _freed(0), on_clear(nullptr) {}
+
+Atlas::~Atlas() {
+	// GPU resources die with the context
+	if (!IsWindowReady()) return;
+
+	for (auto &page : _pages) UnloadTexture(page.texture);
+}
+
+};
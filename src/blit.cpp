@@ -0,0 +1,403 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include <xsimd/xsimd.hpp>
+
+#include <Orbit/RlExt/image.h>
+#include <Orbit/Lua/rect.h>
+#include <Orbit/Lua/quad.h>
+
+#include <raylib.h>
+
+// A software implementation of the copy shaders (see src/shaders.cpp).
+//
+// Pixels are handled as packed 32-bit RGBA, so white is 0xFFFFFFFF
+// regardless of byte order, and a batch of them is composited at once.
+
+namespace Orbit::RlExt {
+
+using pixels = xsimd::batch<uint32_t>;
+using channel = xsimd::batch<float>;
+using pixel_mask = xsimd::batch_bool<uint32_t>;
+
+constexpr uint32_t WHITE_PIXEL = 0xFFFFFFFF;
+constexpr int LANES = static_cast<int>(pixels::size);
+
+static_assert(pixels::size == channel::size, "pixel and channel batches must have the same width");
+
+inline channel unpack(const pixels &p, int shift) {
+	return xsimd::batch_cast<float>(xsimd::bitwise_cast<int32_t>((p >> shift) & pixels(0xFFu)));
+}
+
+inline pixels pack(const channel &c, int shift) {
+	auto clamped = xsimd::clip(c, channel(0.0f), channel(255.0f));
+	return xsimd::bitwise_cast<uint32_t>(xsimd::batch_cast<int32_t>(xsimd::nearbyint(clamped))) << shift;
+}
+
+// GLSL's mix(), applied to all four channels.
+inline pixels lerp(const pixels &a, const pixels &b, const channel &t) {
+	pixels result(0u);
+
+	for (int shift = 0; shift < 32; shift += 8) {
+		auto ca = unpack(a, shift);
+		result |= pack(xsimd::fma(unpack(b, shift) - ca, t, ca), shift);
+	}
+
+	return result;
+}
+
+// Borrows the pixels of an image as packed RGBA.
+//
+// Images in other formats, or images that are also the destination
+// of the blit, are copied first.
+struct Pixels {
+
+	Image copy;
+	const uint32_t *data;
+	int width, height;
+
+	inline uint32_t at(int x, int y) const { return data[static_cast<size_t>(y) * width + x]; }
+	inline const uint32_t *row(int y) const { return data + static_cast<size_t>(y) * width; }
+
+	Pixels(const Image *image, const Image *dst) : copy(Image{}), width(image->width), height(image->height) {
+		if (image->format != PIXELFORMAT_UNCOMPRESSED_R8G8B8A8 || image->data == dst->data) {
+			copy = ImageCopy(*image);
+			ImageFormat(&copy, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+		}
+
+		data = static_cast<const uint32_t *>(copy.data ? copy.data : image->data);
+	}
+
+	Pixels(const Pixels &) = delete;
+
+	~Pixels() { if (copy.data) UnloadImage(copy); }
+};
+
+struct Compositor {
+
+	CopyImageInk ink;
+	bool mix;
+	float blend;
+	bool tint;
+	uint32_t color;
+
+	// Composites LANES pixels into dst.
+	// A pixel is left untouched where mask isn't white or covered is zero.
+	inline void batch(uint32_t *dst, const uint32_t *src, const uint32_t *mask, const uint32_t *covered) const {
+		const pixels white(WHITE_PIXEL);
+
+		auto d = pixels::load_unaligned(dst);
+		auto c = pixels::load_unaligned(src);
+
+		pixel_mask keep(false);
+
+		if (covered) keep = keep | (pixels::load_unaligned(covered) == pixels(0u));
+		if (mask) keep = keep | (pixels::load_unaligned(mask) != white);
+		if (tint) c = xsimd::select(c != white, pixels(color), c);
+
+		pixels out;
+
+		switch (ink) {
+			case CopyImageInk::Darkest:
+				out = xsimd::bitwise_cast<uint32_t>(
+					xsimd::min(xsimd::bitwise_cast<uint8_t>(c), xsimd::bitwise_cast<uint8_t>(d))
+				);
+				break;
+
+			case CopyImageInk::TransparentBackground:
+				keep = keep | (c == white);
+				[[fallthrough]];
+
+			case CopyImageInk::None:
+				out = mix ? lerp(d, c, channel(blend)) : c;
+				break;
+
+			default: return;
+		}
+
+		// Same as raylib's default blend mode (BLEND_ALPHA)
+		auto alpha = out >> 24;
+		if (xsimd::any(alpha != pixels(0xFFu))) {
+			out = lerp(d, out, xsimd::batch_cast<float>(xsimd::bitwise_cast<int32_t>(alpha)) / channel(255.0f));
+		}
+
+		xsimd::select(keep, d, out).store_unaligned(dst);
+	}
+
+	void row(uint32_t *dst, const uint32_t *src, const uint32_t *mask, const uint32_t *covered, int count) const {
+		int i = 0;
+
+		for (; i + LANES <= count; i += LANES) {
+			batch(dst + i, src + i, mask ? mask + i : nullptr, covered ? covered + i : nullptr);
+		}
+
+		if (i == count) return;
+
+		// The tail goes through the same kernel, padded with pixels that are left untouched.
+		uint32_t d[LANES], s[LANES], m[LANES], c[LANES];
+		const int rest = count - i;
+
+		std::fill(d, d + LANES, 0u);
+		std::fill(s, s + LANES, WHITE_PIXEL);
+		std::fill(m, m + LANES, 0u);
+		std::fill(c, c + LANES, 0u);
+
+		std::copy(dst + i, dst + count, d);
+		std::copy(src + i, src + count, s);
+		if (mask) std::copy(mask + i, mask + count, m);
+		if (covered) std::copy(covered + i, covered + count, c);
+
+		if (!covered) std::fill(c, c + rest, WHITE_PIXEL);
+
+		batch(d, s, mask ? m : nullptr, c);
+
+		std::copy(d, d + rest, dst + i);
+	}
+
+	Compositor(const CopyImageParams &params) :
+		ink(params.ink),
+		mix(params.blend < 0.987f),
+		blend(params.blend),
+		tint(params.color.has_value()),
+		color(0) {
+		if (tint) {
+			auto col = *params.color;
+			color = col.r | (col.g << 8) | (col.b << 16) | (static_cast<uint32_t>(col.a) << 24);
+		}
+	}
+};
+
+// Maps a texel coordinate (in source pixels) to a pixel index, or -1 outside of the texture.
+inline int texel(float coord, int size) {
+	if (!(coord >= 0.0f && coord <= static_cast<float>(size))) return -1;
+	return std::min(static_cast<int>(coord), size - 1);
+}
+
+// Textures repeat, so the mask wraps around when it's smaller than the source.
+inline int wrap(int i, int size) {
+	i %= size;
+	return i < 0 ? i + size : i;
+}
+
+inline bool prepare_destination(Image *dst) {
+	if (dst->data == nullptr || dst->width <= 0 || dst->height <= 0) return false;
+
+	if (dst->format != PIXELFORMAT_UNCOMPRESSED_R8G8B8A8) {
+		ImageFormat(dst, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+	}
+
+	return true;
+}
+
+void CopyImage_CPU(
+	const Image *src,
+	Image *dst,
+	const Orbit::Lua::Rect *from,
+	const Orbit::Lua::Rect *to,
+	const CopyImageParams &params
+) {
+	if (to->width() == 0 || to->height() == 0 || !prepare_destination(dst)) return;
+
+	const Pixels source(src, dst);
+
+	std::optional<Pixels> mask;
+	if (params.mask) mask.emplace(&params.mask->pixels(), dst);
+
+	const Compositor compositor(params);
+
+	// Pixels whose centers fall inside the destination rectangle
+	const int x0 = std::max(0, static_cast<int>(std::ceil(std::min(to->left(), to->right()) - 0.5f)));
+	const int x1 = std::min(dst->width, static_cast<int>(std::ceil(std::max(to->left(), to->right()) - 0.5f)));
+	const int y0 = std::max(0, static_cast<int>(std::ceil(std::min(to->top(), to->bottom()) - 0.5f)));
+	const int y1 = std::min(dst->height, static_cast<int>(std::ceil(std::max(to->top(), to->bottom()) - 0.5f)));
+
+	if (x0 >= x1 || y0 >= y1) return;
+
+	const int count = x1 - x0;
+
+	// Like DrawTexturePro(), a negative source size flips the image in place.
+	const float srcLeft = from->width() < 0 ? from->left() - from->width() : from->left();
+	const float srcTop = from->height() < 0 ? from->top() - from->height() : from->top();
+
+	std::vector<int> columns(count);
+	bool contiguous = true;
+
+	for (int i = 0; i < count; i++) {
+		float u = (x0 + i + 0.5f - to->left()) / to->width();
+		columns[i] = texel(srcLeft + u * from->width(), source.width);
+
+		contiguous = contiguous && columns[i] >= 0 && columns[i] == columns[0] + i;
+	}
+
+	std::vector<uint32_t> srcRow(count), maskRow(mask ? count : 0);
+
+	for (int y = y0; y < y1; y++) {
+		float v = (y + 0.5f - to->top()) / to->height();
+		int row = texel(srcTop + v * from->height(), source.height);
+
+		auto *out = static_cast<uint32_t *>(dst->data) + static_cast<size_t>(y) * dst->width + x0;
+		const uint32_t *in = srcRow.data();
+
+		if (row < 0) {
+			std::fill(srcRow.begin(), srcRow.end(), WHITE_PIXEL);
+		} else if (contiguous) {
+			in = source.row(row) + columns[0];
+		} else {
+			for (int i = 0; i < count; i++) {
+				srcRow[i] = columns[i] < 0 ? WHITE_PIXEL : source.at(columns[i], row);
+			}
+		}
+
+		if (mask) {
+			for (int i = 0; i < count; i++) {
+				maskRow[i] = (row < 0 || columns[i] < 0)
+					? WHITE_PIXEL
+					: mask->at(wrap(columns[i], mask->width), wrap(row, mask->height));
+			}
+		}
+
+		compositor.row(out, in, mask ? maskRow.data() : nullptr, nullptr, count);
+	}
+}
+
+// Vectorized port of the shaders' invbilinear(): maps a point inside
+// the quad to its (u, v) coordinates, or to something outside of [0, 1].
+struct InverseBilinear {
+
+	Vector2 a, e, f, g;
+	float k2, ef;
+
+	inline void operator()(const channel &px, float py, channel &u, channel &v) const {
+		auto hx = px - channel(a.x);
+		auto hy = channel(py - a.y);
+
+		auto k1 = channel(ef) + (hx * g.y - hy * g.x);
+		auto k0 = hx * e.y - hy * e.x;
+
+		// if edges are parallel, this is a linear equation
+		if (std::fabs(k2) < 0.001f) {
+			u = (hx * k1 + k0 * f.x) / (k1 * e.x - k0 * g.x);
+			v = -k0 / k1;
+			return;
+		}
+
+		// otherwise, it's a quadratic
+		auto w = k1 * k1 - k0 * (4.0f * k2);
+		auto none = w < channel(0.0f);
+		w = xsimd::sqrt(xsimd::max(w, channel(0.0f)));
+
+		const float ik2 = 0.5f / k2;
+
+		v = (-k1 - w) * ik2;
+		u = (hx - v * f.x) / (v * g.x + e.x);
+
+		auto outside = (u < channel(0.0f)) | (u > channel(1.0f)) | (v < channel(0.0f)) | (v > channel(1.0f));
+		auto v2 = (w - k1) * ik2;
+		auto u2 = (hx - v2 * f.x) / (v2 * g.x + e.x);
+
+		u = xsimd::select(none, channel(-1.0f), xsimd::select(outside, u2, u));
+		v = xsimd::select(none, channel(-1.0f), xsimd::select(outside, v2, v));
+	}
+
+	InverseBilinear(const Orbit::Lua::Quad &q) :
+		a(q.topleft),
+		e(Vector2{q.topright.x - q.topleft.x, q.topright.y - q.topleft.y}),
+		f(Vector2{q.bottomleft.x - q.topleft.x, q.bottomleft.y - q.topleft.y}),
+		g(Vector2{
+			q.topleft.x - q.topright.x + q.bottomright.x - q.bottomleft.x,
+			q.topleft.y - q.topright.y + q.bottomright.y - q.bottomleft.y
+		}) {
+		k2 = g.x * f.y - g.y * f.x;
+		ef = e.x * f.y - e.y * f.x;
+	}
+};
+
+void CopyImage_CPU(
+	const Image *src,
+	Image *dst,
+	const Orbit::Lua::Rect *from,
+	const Orbit::Lua::Quad *to,
+	const CopyImageParams &params
+) {
+	if (!prepare_destination(dst)) return;
+
+	const Pixels source(src, dst);
+
+	std::optional<Pixels> mask;
+	if (params.mask) mask.emplace(&params.mask->pixels(), dst);
+
+	const Compositor compositor(params);
+	const InverseBilinear invbilinear(*to);
+
+	float minX = to->vertices[0].x, maxX = minX;
+	float minY = to->vertices[0].y, maxY = minY;
+
+	for (int v = 1; v < 4; v++) {
+		minX = std::min(minX, to->vertices[v].x);
+		maxX = std::max(maxX, to->vertices[v].x);
+		minY = std::min(minY, to->vertices[v].y);
+		maxY = std::max(maxY, to->vertices[v].y);
+	}
+
+	const int x0 = std::max(0, static_cast<int>(std::floor(minX)));
+	const int x1 = std::min(dst->width, static_cast<int>(std::ceil(maxX)));
+	const int y0 = std::max(0, static_cast<int>(std::floor(minY)));
+	const int y1 = std::min(dst->height, static_cast<int>(std::ceil(maxY)));
+
+	if (x0 >= x1 || y0 >= y1) return;
+
+	const int count = x1 - x0;
+	const int padded = (count + LANES - 1) / LANES * LANES;
+
+	std::vector<float> us(padded), vs(padded);
+	std::vector<uint32_t> srcRow(count), maskRow(mask ? count : 0), covered(count);
+
+	const channel offsets = [] {
+		alignas(channel::arch_type::alignment()) float lanes[LANES];
+		for (int i = 0; i < LANES; i++) lanes[i] = i + 0.5f;
+		return channel::load_aligned(lanes);
+	}();
+
+	for (int y = y0; y < y1; y++) {
+		for (int i = 0; i < padded; i += LANES) {
+			channel u, v;
+			invbilinear(offsets + static_cast<float>(x0 + i), y + 0.5f, u, v);
+
+			u.store_unaligned(us.data() + i);
+			v.store_unaligned(vs.data() + i);
+		}
+
+		for (int i = 0; i < count; i++) {
+			const float u = us[i], v = vs[i];
+
+			if (!(u >= 0.0f && u <= 1.0f && v >= 0.0f && v <= 1.0f)) {
+				covered[i] = 0;
+				srcRow[i] = WHITE_PIXEL;
+				if (mask) maskRow[i] = WHITE_PIXEL;
+				continue;
+			}
+
+			covered[i] = WHITE_PIXEL;
+
+			int column = texel(from->left() + u * from->width(), source.width);
+			int row = texel(from->top() + v * from->height(), source.height);
+
+			if (column < 0 || row < 0) {
+				srcRow[i] = WHITE_PIXEL;
+				if (mask) maskRow[i] = WHITE_PIXEL;
+				continue;
+			}
+
+			srcRow[i] = source.at(column, row);
+			if (mask) maskRow[i] = mask->at(wrap(column, mask->width), wrap(row, mask->height));
+		}
+
+		auto *out = static_cast<uint32_t *>(dst->data) + static_cast<size_t>(y) * dst->width + x0;
+		compositor.row(out, srcRow.data(), mask ? maskRow.data() : nullptr, covered.data(), count);
+	}
+}
+
+};
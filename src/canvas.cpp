@@ -0,0 +1,252 @@
+#include <Orbit/RlExt/canvas.h>
+#include <Orbit/RlExt/drawqueue.h>
+#include <Orbit/profiler.h>
+
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include <raylib.h>
+#include <rlgl.h>
+
+// GL_COLOR_BUFFER_BIT
+#define COLOR_BUFFER_BIT 0x00004000
+
+namespace Orbit::RlExt {
+
+inline void blit(const RenderTexture2D &from, const RenderTexture2D &to) {
+	rlDrawRenderBatchActive();
+
+	rlBindFramebuffer(RL_READ_FRAMEBUFFER, from.id);
+	rlBindFramebuffer(RL_DRAW_FRAMEBUFFER, to.id);
+	rlBlitFramebuffer(
+		0, 0, from.texture.width, from.texture.height,
+		0, 0, to.texture.width, to.texture.height,
+		COLOR_BUFFER_BIT
+	);
+	rlBindFramebuffer(RL_READ_FRAMEBUFFER, 0);
+	rlBindFramebuffer(RL_DRAW_FRAMEBUFFER, 0);
+}
+
+const Image &Canvas::pixels() {
+	if (cpu_stale) {
+		Image downloaded = LoadImageFromTexture(target.texture);
+		Orbit::profiler.readback(static_cast<size_t>(downloaded.width) * downloaded.height * 4);
+		ImageFlipVertical(&downloaded);
+
+		_release_pixels();
+		image = downloaded;
+		cpu_stale = false;
+	}
+
+	// The software blitter only deals with packed RGBA
+	if (image.data != nullptr && image.format != PIXELFORMAT_UNCOMPRESSED_R8G8B8A8) {
+		detach();
+		ImageFormat(&image, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+	}
+
+	return image;
+}
+
+Image &Canvas::pixels_mut() {
+	pixels();
+	detach();
+	gpu_stale = true;
+	version++;
+	return image;
+}
+
+Texture2D Canvas::texture() {
+	if (target.id == 0) {
+		target = LoadRenderTexture(image.width, image.height);
+		gpu_stale = true;
+	}
+
+	if (gpu_stale) {
+		_settle();
+
+		if (image.format != PIXELFORMAT_UNCOMPRESSED_R8G8B8A8) {
+			detach();
+			ImageFormat(&image, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+		}
+
+		const size_t stride = static_cast<size_t>(image.width) * 4;
+		const auto *rows = static_cast<const unsigned char *>(image.data);
+
+		std::vector<unsigned char> flipped(stride * image.height);
+
+		for (int y = 0; y < image.height; y++) {
+			std::memcpy(flipped.data() + (image.height - 1 - y) * stride, rows + y * stride, stride);
+		}
+
+		UpdateTexture(target.texture, flipped.data());
+		Orbit::profiler.upload(flipped.size());
+		gpu_stale = false;
+	}
+
+	return target.texture;
+}
+
+void Canvas::detach() {
+	if (!shared) return;
+
+	image = ImageCopy(*shared);
+	shared.reset();
+}
+
+void Canvas::_settle() {
+	if (pending != nullptr) pending->flush();
+}
+
+void Canvas::_release_pixels() {
+	if (shared) shared.reset();
+	else UnloadImage(image);
+
+	image.data = nullptr;
+}
+
+void Canvas::clear(Color color) {
+	if (shared) _release_pixels();
+
+	if (image.data == nullptr) {
+		image = GenImageColor(image.width, image.height, color);
+	} else {
+		ImageClearBackground(&image, color);
+	}
+
+	if (target.id != 0) {
+		_settle();
+
+		BeginTextureMode(target);
+		ClearBackground(color);
+		EndTextureMode();
+	}
+
+	cpu_stale = false;
+	gpu_stale = false;
+	version++;
+}
+
+void Canvas::begin(bool feedback) {
+	texture();
+	_settle();
+
+	if (feedback) {
+		if (scratch.id == 0) scratch = LoadRenderTexture(image.width, image.height);
+
+		blit(target, scratch);
+		BeginTextureMode(scratch);
+	} else {
+		BeginTextureMode(target);
+	}
+
+	swap = feedback;
+}
+
+void Canvas::end() {
+	EndTextureMode();
+
+	if (swap) std::swap(target, scratch);
+
+	swap = false;
+	cpu_stale = true;
+	version++;
+}
+
+Canvas Canvas::duplicate() {
+	if (!cpu_stale) return shared ? Canvas(shared) : Canvas(ImageCopy(image));
+
+	auto copy = Canvas(image.width, image.height);
+	blit(target, copy.target);
+
+	return copy;
+}
+
+void Canvas::unload() {
+	_settle();
+
+	// GPU resources die with the context
+	if (IsWindowReady()) {
+		if (target.id != 0) UnloadRenderTexture(target);
+		if (scratch.id != 0) UnloadRenderTexture(scratch);
+	}
+
+	_release_pixels();
+
+	target = RenderTexture2D{};
+	scratch = RenderTexture2D{};
+}
+
+Canvas &Canvas::operator=(Canvas &&other) noexcept {
+	if (this == &other) return *this;
+
+	unload();
+	other._settle();
+
+	image = other.image;
+	target = other.target;
+	scratch = other.scratch;
+	cpu_stale = other.cpu_stale;
+	gpu_stale = other.gpu_stale;
+	swap = other.swap;
+	shared = std::move(other.shared);
+	version++;
+
+	other.image.data = nullptr;
+	other.target = RenderTexture2D{};
+	other.scratch = RenderTexture2D{};
+
+	return *this;
+}
+
+Canvas::Canvas(Canvas &&other) noexcept :
+	image(other.image),
+	target(other.target),
+	scratch(other.scratch),
+	cpu_stale(other.cpu_stale),
+	gpu_stale(other.gpu_stale),
+	swap(other.swap),
+	version(other.version),
+	shared(std::move(other.shared)),
+	pending(nullptr) {
+	other._settle();
+
+	other.image.data = nullptr;
+	other.target = RenderTexture2D{};
+	other.scratch = RenderTexture2D{};
+}
+
+Canvas::Canvas(Image image) :
+	image(image),
+	target(RenderTexture2D{}),
+	scratch(RenderTexture2D{}),
+	cpu_stale(false),
+	gpu_stale(true),
+	swap(false),
+	version(0),
+	pending(nullptr) {}
+
+Canvas::Canvas(std::shared_ptr<const Image> pixels) :
+	image(*pixels),
+	target(RenderTexture2D{}),
+	scratch(RenderTexture2D{}),
+	cpu_stale(false),
+	gpu_stale(true),
+	swap(false),
+	version(0),
+	shared(std::move(pixels)),
+	pending(nullptr) {}
+
+Canvas::Canvas(int width, int height) :
+	image(Image{nullptr, width, height, 1, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8}),
+	target(LoadRenderTexture(width, height)),
+	scratch(RenderTexture2D{}),
+	cpu_stale(true),
+	gpu_stale(false),
+	swap(false),
+	version(0),
+	pending(nullptr) {}
+
+Canvas::~Canvas() { unload(); }
+
+};
@@ -0,0 +1,275 @@
+#include <Orbit/Lua/castindex.h>
+#include <Orbit/Lua/castlib.h>
+#include <Orbit/parallel.h>
+#include <Orbit/io.h>
+
+#include <unordered_map>
+#include <string_view>
+#include <filesystem>
+#include <stdexcept>
+#include <algorithm>
+#include <optional>
+#include <fstream>
+#include <cstring>
+#include <vector>
+#include <string>
+#include <regex>
+
+using std::string_view;
+using std::optional;
+using std::string;
+using std::vector;
+
+namespace fs = std::filesystem;
+
+namespace Orbit::Lua {
+
+// Index file layout: a header, the fixed-size records, then the file names back to back.
+// Library and member names are slices of the file name.
+
+struct IndexHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t count;
+    uint32_t strings;
+    int64_t dir_mtime;
+};
+
+struct IndexRecord {
+    int64_t mtime;
+    uint64_t size;
+    int32_t id, width, height;
+    CastIndex::Names names;
+};
+
+// "OCIX"; also rejects files written on a machine of the other endianness
+static const uint32_t INDEX_MAGIC = 0x5849434F;
+
+int64_t CastIndex::stamp(fs::file_time_type time) {
+    return static_cast<int64_t>(time.time_since_epoch().count());
+}
+
+CastIndex::Names CastIndex::Names::append(const Entry &entry, string &strings) {
+    // Names are cut out of the file name, i.e. Drought_1233436_rock.png
+    const auto name_start = entry.filename.find('_', entry.lib.size() + 1) + 1;
+
+    const Names names{
+        static_cast<uint32_t>(strings.size()),
+        static_cast<uint32_t>(entry.filename.size()),
+        static_cast<uint32_t>(entry.lib.size()),
+        static_cast<uint32_t>(name_start),
+        static_cast<uint32_t>(entry.name.size())
+    };
+
+    strings += entry.filename;
+
+    return names;
+}
+
+bool CastIndex::Names::valid(size_t strings) const {
+    return static_cast<uint64_t>(filename) + filename_length <= strings &&
+        lib_length <= filename_length &&
+        static_cast<uint64_t>(name_start) + name_length <= filename_length;
+}
+
+void CastIndex::Names::read(const char *strings, string &filename, string &lib, string &name) const {
+    filename.assign(strings + this->filename, filename_length);
+    lib = filename.substr(0, lib_length);
+    name = filename.substr(name_start, name_length);
+}
+
+bool CastIndex::_read() {
+    std::error_code error;
+    if (_file.empty() || !fs::is_regular_file(_file, error)) return false;
+
+    MappedFile mapped(_file);
+
+    const char *data = mapped.data();
+    const size_t size = mapped.size();
+
+    if (size < sizeof(IndexHeader)) return false;
+
+    IndexHeader header;
+    std::memcpy(&header, data, sizeof(IndexHeader));
+
+    if (header.magic != INDEX_MAGIC || header.version != VERSION) return false;
+    if (size != sizeof(IndexHeader) + static_cast<size_t>(header.count) * sizeof(IndexRecord) + header.strings) return false;
+
+    const char *records = data + sizeof(IndexHeader);
+    const char *strings = records + static_cast<size_t>(header.count) * sizeof(IndexRecord);
+
+    vector<Entry> entries;
+    entries.reserve(header.count);
+
+    for (uint32_t i = 0; i < header.count; i++) {
+        IndexRecord record;
+        std::memcpy(&record, records + i * sizeof(IndexRecord), sizeof(IndexRecord));
+
+        if (!record.names.valid(header.strings)) return false;
+
+        Entry entry{ {}, {}, {}, record.id, record.width, record.height, record.mtime, record.size };
+        record.names.read(strings, entry.filename, entry.lib, entry.name);
+
+        entries.push_back(std::move(entry));
+    }
+
+    _entries = std::move(entries);
+    _dir_mtime = header.dir_mtime;
+
+    return true;
+}
+
+void CastIndex::update() {
+    if (!fs::is_directory(_dir)) {
+        throw std::invalid_argument("path is not a direcotry: " + _dir.string());
+    }
+
+    // Taken before listing, so files added in the meantime are picked up next time
+    const auto dir_mtime = stamp(fs::last_write_time(_dir));
+
+    vector<Entry> previous = std::move(_entries);
+    vector<string> filenames;
+
+    if (!previous.empty() && dir_mtime == _dir_mtime) {
+        // Nothing was added, removed or renamed
+        filenames.reserve(previous.size());
+        for (const auto &entry : previous) filenames.push_back(entry.filename);
+    } else {
+        for (auto &entry : fs::directory_iterator(_dir)) {
+            const auto &path = entry.path();
+
+            if (!entry.is_regular_file()) continue;
+            if (path.extension() != ".png" && path.extension() != ".txt") continue;
+
+            filenames.push_back(path.filename().string());
+        }
+
+        std::sort(filenames.begin(), filenames.end());
+    }
+
+    std::unordered_map<string_view, const Entry *> known;
+    known.reserve(previous.size());
+
+    for (const auto &entry : previous) known.insert({ entry.filename, &entry });
+
+    vector<optional<Entry>> scanned(filenames.size());
+    vector<char> rescanned(filenames.size(), 0);
+
+    Orbit::parallel_for(filenames.size(), [&](size_t i) {
+        const auto &filename = filenames[i];
+        const auto path = _dir / filename;
+
+        std::error_code error;
+        const auto size = fs::file_size(path, error);
+        if (error) return;
+        const auto mtime = stamp(fs::last_write_time(path, error));
+        if (error) return;
+
+        auto found = known.find(filename);
+
+        if (found != known.end() && found->second->mtime == mtime && found->second->size == size) {
+            scanned[i] = *found->second;
+            return;
+        }
+
+        rescanned[i] = 1;
+
+        if (!std::regex_match(filename, CAST_MEMBER_NAME_PATTERN)) return;
+
+        CastMember member(path);
+
+        scanned[i] = Entry{
+            filename,
+            filename.substr(0, filename.find('_')),
+            member.name,
+            member.id,
+            member.width,
+            member.height,
+            mtime,
+            static_cast<uint64_t>(size)
+        };
+    });
+
+    _reused = 0;
+    _rescanned = 0;
+
+    for (size_t i = 0; i < scanned.size(); i++) {
+        if (rescanned[i]) _rescanned++;
+        if (!scanned[i]) continue;
+        if (!rescanned[i]) _reused++;
+
+        _entries.push_back(std::move(*scanned[i]));
+    }
+
+    if (_rescanned > 0 || _entries.size() != previous.size() || dir_mtime != _dir_mtime) _dirty = true;
+
+    _dir_mtime = dir_mtime;
+}
+
+void CastIndex::save() {
+    if (!_dirty || _file.empty()) return;
+
+    string strings;
+    vector<IndexRecord> records;
+    records.reserve(_entries.size());
+
+    for (const auto &entry : _entries) {
+        records.push_back(IndexRecord{
+            entry.mtime,
+            entry.size,
+            entry.id,
+            entry.width,
+            entry.height,
+            Names::append(entry, strings)
+        });
+    }
+
+    const IndexHeader header{
+        INDEX_MAGIC,
+        VERSION,
+        static_cast<uint32_t>(records.size()),
+        static_cast<uint32_t>(strings.size()),
+        _dir_mtime
+    };
+
+    // Written aside and moved in place, so a crash never leaves a truncated index behind
+    auto temporary = _file;
+    temporary += ".tmp";
+
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char *>(records.data()), records.size() * sizeof(IndexRecord));
+        file.write(strings.data(), strings.size());
+
+        if (!file) throw std::runtime_error("failed to write " + temporary.string());
+    }
+
+    fs::rename(temporary, _file);
+    _dirty = false;
+}
+
+CastIndex::CastIndex(const fs::path &dir, const fs::path &file) :
+    _dir(dir),
+    _file(file),
+    _entries({}),
+    _dir_mtime(0),
+    _dirty(false),
+    _reused(0),
+    _rescanned(0) {
+    bool valid = false;
+
+    try {
+        valid = _read();
+    } catch (const std::exception &) {}
+
+    // Anything unreadable is rebuilt from scratch
+    if (!valid) {
+        _entries.clear();
+        _dir_mtime = 0;
+        _dirty = !file.empty();
+    }
+}
+
+};
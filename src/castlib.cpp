@@ -1,4 +1,6 @@
 #include <Orbit/Lua/castlib.h>
+#include <Orbit/Lua/castindex.h>
+#include <Orbit/Lua/castpack.h>
 #include <Orbit/Lua/runtime.h>
 #include <Orbit/hash.h>
 
@@ -7,10 +9,14 @@
 #include <sstream>
 #include <fstream>
 #include <cstring>
+#include <cstdint>
+#include <stdexcept>
 #include <algorithm>
 #include <vector>
+#include <iterator>
 #include <memory>
 #include <regex>
+#include <new>
 
 #include <raylib.h>
 
@@ -44,6 +50,28 @@ namespace Orbit::Lua {
 //     _loaded = false;
 // }
 
+// Reads the dimensions from the IHDR chunk, which always comes first.
+static bool read_png_size(const std::filesystem::path &path, int &width, int &height) {
+    static const unsigned char SIGNATURE[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+    unsigned char header[24];
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file.read(reinterpret_cast<char *>(header), sizeof(header))) return false;
+
+    if (std::memcmp(header, SIGNATURE, sizeof(SIGNATURE)) != 0) return false;
+    if (std::memcmp(header + 12, "IHDR", 4) != 0) return false;
+
+    auto big_endian = [](const unsigned char *bytes) {
+        return static_cast<int>((uint32_t(bytes[0]) << 24) | (uint32_t(bytes[1]) << 16) | (uint32_t(bytes[2]) << 8) | uint32_t(bytes[3]));
+    };
+
+    width = big_endian(header + 16);
+    height = big_endian(header + 20);
+
+    return true;
+}
+
 CastMember &CastMember::operator=(CastMember &&other) noexcept {
     if (this == &other) return *this;
 
@@ -51,6 +79,10 @@ CastMember &CastMember::operator=(CastMember &&other) noexcept {
     path = move(other.path);
     
     id = other.id;
+    width = other.width;
+    height = other.height;
+    pack = other.pack;
+    packed = other.packed;
     // _loaded = other._loaded;
     
     other.id = 0;
@@ -64,12 +96,16 @@ CastMember::CastMember(CastMember &&other) noexcept {
     path = move(other.path);
     
     id = other.id;
+    width = other.width;
+    height = other.height;
+    pack = other.pack;
+    packed = other.packed;
     // _loaded = other._loaded;
     
     other.id = 0;
     // other._loaded = false;
 }
-CastMember::CastMember(const std::filesystem::path &path) : path(path) {
+CastMember::CastMember(const std::filesystem::path &path) : path(path), pack(nullptr), packed(nullptr) {
     // i.e. Drought_1233436_rock.png
 
     if (!std::regex_match(path.filename().string(), CAST_MEMBER_NAME_PATTERN)) {
@@ -97,8 +133,32 @@ CastMember::CastMember(const std::filesystem::path &path) : path(path) {
 
     id = std::stoi(id_ss.str());
     name = name_ss.str();
+
+    width = 0;
+    height = 0;
+
+    if (path.extension() == ".png") read_png_size(path, width, height);
+}
+CastMember::CastMember(int id, const string &name, const std::filesystem::path &path, int width, int height) :
+    id(id), name(name), path(path), width(width), height(height), pack(nullptr), packed(nullptr) {}
+
+Image CastMember::load_image() const {
+    if (pack != nullptr) return pack->image(*packed);
+
+    return LoadImage(path.string().c_str());
+}
+
+string CastMember::load_text() const {
+    if (pack != nullptr) return string(pack->bytes(*packed));
+
+    std::ifstream file(path);
+    if (!file) throw std::runtime_error("failed to open cast member file " + path.string());
+
+    stringstream buffer;
+    buffer << file.rdbuf();
+
+    return buffer.str();
 }
-CastMember::CastMember(int, const string &, const std::filesystem::path &, Image) {}
 
 CastMember::~CastMember() {
     // unload();
@@ -136,43 +196,74 @@ CastLib &CastLib::operator=(CastLib &&other) noexcept {
 
     return *this;
 }
-void CastLib::load_members(const std::filesystem::path &dir) {
-    if (!std::filesystem::is_directory(dir)) {
-        throw std::invalid_argument("path is not a direcotry: " + dir.string());
-    }
+void CastLib::load_members(const std::filesystem::path &dir) { load_members(dir, { this }); }
+
+void CastLib::load_members(const std::filesystem::path &dir, const vector<CastLib *> &libs) {
+    CastIndex index(dir);
+    index.update();
+
+    load_members(index, libs);
+}
+
+void CastLib::load_members(const CastIndex &index, const vector<CastLib *> &libs) {
+    unordered_map<string, CastLib *> prefixes;
+    prefixes.reserve(libs.size());
+
+    for (auto *lib : libs) prefixes.insert({ lib->_name, lib });
+
+    // Entries are sorted by file name, so the winner of duplicate names
+    // doesn't depend on the order the directory was listed in.
+    for (const auto &entry : index.entries()) {
+        const auto found = prefixes.find(entry.lib);
+        if (found == prefixes.end()) continue;
+
+        auto &lib = *found->second;
+
+        if (lib._names.find(entry.name) != lib._names.end()) continue;
 
-    _members.reserve(10000);
-    _names.reserve(10000 + 500);
+        auto member = std::make_shared<CastMember>(entry.id, entry.name, index.dir() / entry.filename, entry.width, entry.height);
 
-    const char *name = _name.c_str();
+        lib._members.push_back(member);
+        lib._names.insert({ entry.name, member });
+    }
 
-    for (auto &entry : std::filesystem::directory_iterator(dir)) {
-        const auto &path = entry.path();
+    _sort_members(libs);
+}
 
-        if (!entry.is_regular_file()) continue;
-        if (path.extension() != ".png" && path.extension() != ".txt") continue;
+void CastLib::load_members(const CastPack &pack, const vector<CastLib *> &libs) {
+    unordered_map<string, CastLib *> prefixes;
+    prefixes.reserve(libs.size());
 
-        const char *ename = path.stem().string().c_str();
+    for (auto *lib : libs) prefixes.insert({ lib->_name, lib });
 
-        if (std::strncmp(name, ename, std::strlen(name))) continue;
+    for (const auto &entry : pack.entries()) {
+        const auto found = prefixes.find(entry.lib);
+        if (found == prefixes.end()) continue;
 
-        CastMember member(path);
-        std::string memname = member.name;
+        auto &lib = *found->second;
 
-        if (_names.find(memname) != _names.end()) continue;
+        if (lib._names.find(entry.name) != lib._names.end()) continue;
 
-        auto shared = std::make_shared<CastMember>(std::move(member));
+        auto member = std::make_shared<CastMember>(entry.id, entry.name, pack.dir() / entry.filename, entry.width, entry.height);
+        member->pack = &pack;
+        member->packed = &entry;
 
-        _members.push_back(shared);
-        _names.insert({ memname, shared });
+        lib._members.push_back(member);
+        lib._names.insert({ entry.name, member });
     }
 
-    std::sort(
-        _members.begin(), 
-        _members.end(), 
-        [](const auto &first, const auto &second){
-            return first->id < second->id;
-    });
+    _sort_members(libs);
+}
+
+void CastLib::_sort_members(const vector<CastLib *> &libs) {
+    for (auto *lib : libs) {
+        std::stable_sort(
+            lib->_members.begin(), 
+            lib->_members.end(), 
+            [](const auto &first, const auto &second){
+                return first->id < second->id;
+        });
+    }
 }
 
 CastLib::CastLib(CastLib &&other) noexcept : 
@@ -188,6 +279,105 @@ CastLib::CastLib(int offset, const string &name) :
 
 CastLib::~CastLib() {}
 
+CastMemberCache::Entry *CastMemberCache::_find(const CastMember &member) {
+    auto found = _lookup.find(&member);
+    if (found == _lookup.end()) return nullptr;
+
+    _entries.splice(_entries.begin(), _entries, found->second);
+    return &*found->second;
+}
+
+CastMemberCache::Entry &CastMemberCache::_insert(const CastMember &member, shared_ptr<const Image> pixels, int ref, size_t bytes) {
+    _entries.push_front(Entry{ &member, std::move(pixels), ref, nullptr, 0, bytes });
+    _lookup.insert({ &member, _entries.begin() });
+    _size += bytes;
+
+    return _entries.front();
+}
+
+bool CastMemberCache::_written(Entry &entry) {
+    if (entry.canvas == nullptr || entry.canvas->version == entry.version) return false;
+
+    // The canvas has its own copy now
+    entry.pixels.reset();
+    return true;
+}
+
+void CastMemberCache::_evict(lua_State *L) {
+    if (_entries.empty()) return;
+
+    // The most recent entry is the one that was just used, so it stays.
+    for (auto it = std::prev(_entries.end()); _size > _budget && it != _entries.begin();) {
+        auto current = it--;
+
+        if (_written(*current)) continue;
+
+        luaL_unref(L, LUA_REGISTRYINDEX, current->ref);
+
+        _size -= current->bytes;
+        _lookup.erase(current->member);
+        _entries.erase(current);
+    }
+}
+
+void CastMemberCache::push_image(lua_State *L, const CastMember &member) {
+    if (auto *entry = _find(member)) {
+        _written(*entry);
+        lua_rawgeti(L, LUA_REGISTRYINDEX, entry->ref);
+        return;
+    }
+
+    Image image = member.load_image();
+
+    if (image.data == nullptr) {
+        lua_pushnil(L);
+        return;
+    }
+
+    // Borrowed pixels are never converted in place
+    if (image.format != PIXELFORMAT_UNCOMPRESSED_R8G8B8A8) ImageFormat(&image, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+
+    shared_ptr<const Image> pixels(new Image(image), [this](const Image *image) {
+        if (on_unload) on_unload(image);
+
+        UnloadImage(*image);
+        delete image;
+    });
+
+    const size_t bytes = static_cast<size_t>(image.width) * image.height * 4;
+
+    auto *canvas = static_cast<Orbit::RlExt::Canvas *>(lua_newuserdata(L, sizeof(Orbit::RlExt::Canvas)));
+    new (canvas) Orbit::RlExt::Canvas(pixels);
+
+    luaL_getmetatable(L, "image");
+    lua_setmetatable(L, -2);
+
+    lua_pushvalue(L, -1);
+
+    auto &entry = _insert(member, std::move(pixels), luaL_ref(L, LUA_REGISTRYINDEX), bytes);
+    entry.canvas = canvas;
+    entry.version = canvas->version;
+
+    _evict(L);
+}
+
+void CastMemberCache::push_text(lua_State *L, const CastMember &member) {
+    if (auto *entry = _find(member)) {
+        lua_rawgeti(L, LUA_REGISTRYINDEX, entry->ref);
+        return;
+    }
+
+    const auto text = member.load_text();
+
+    lua_pushlstring(L, text.data(), text.size());
+    lua_pushvalue(L, -1);
+
+    _insert(member, nullptr, luaL_ref(L, LUA_REGISTRYINDEX), text.size());
+    _evict(L);
+}
+
+CastMemberCache::CastMemberCache(size_t budget) : _budget(budget), _size(0), on_unload(nullptr) {}
+
 const std::regex CAST_MEMBER_NAME_PATTERN = std::regex(R"(^[a-zA-Z0-9 ]+_\d+_(.+)?\.(png|txt)$)");
 
 };
\ No newline at end of file
@@ -0,0 +1,276 @@
+#include <Orbit/Lua/castpack.h>
+#include <Orbit/Lua/castindex.h>
+#include <Orbit/parallel.h>
+
+#include <filesystem>
+#include <stdexcept>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <atomic>
+#include <cstring>
+#include <vector>
+#include <string>
+
+#include <raylib.h>
+
+using std::string_view;
+using std::string;
+using std::vector;
+
+namespace fs = std::filesystem;
+
+namespace Orbit::Lua {
+
+// Pack file layout: a header, the member data, then the table of contents
+// (fixed-size records followed by the file names back to back).
+// Library and member names are slices of the file name.
+// The modification times and sizes of the loose files are kept to tell when the pack is out of date.
+
+struct PackHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t count;
+    uint32_t strings;
+    uint64_t toc;
+    int64_t dir_mtime;
+};
+
+struct PackRecord {
+    uint64_t offset, size;
+    int64_t source_mtime;
+    uint64_t source_size;
+    int32_t id, width, height;
+    uint32_t kind, encoding;
+    CastIndex::Names names;
+};
+
+// "OCPK"; also rejects files written on a machine of the other endianness
+static const uint32_t PACK_MAGIC = 0x4B50434F;
+
+// Member data starts on cache line boundaries, so pixels can be read with aligned loads
+static const uint64_t PACK_ALIGNMENT = 64;
+
+// Members are loaded in batches, to bound the memory used while building
+static const size_t PACK_BATCH = 256;
+
+static string read_file(const fs::path &path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) throw std::runtime_error("failed to open " + path.string());
+
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+
+    return buffer.str();
+}
+
+string_view CastPack::bytes(const Entry &entry) const {
+    return string_view(_file.data() + entry.offset, entry.size);
+}
+
+Image CastPack::image(const Entry &entry) const {
+    const auto data = bytes(entry);
+
+    if (entry.encoding == Encoding::Png) {
+        return LoadImageFromMemory(".png", reinterpret_cast<const unsigned char *>(data.data()), static_cast<int>(data.size()));
+    }
+
+    void *pixels = RL_MALLOC(data.size());
+    std::memcpy(pixels, data.data(), data.size());
+
+    return Image{ pixels, entry.width, entry.height, 1, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8 };
+}
+
+bool CastPack::stale() const {
+    std::error_code error;
+    if (!fs::is_directory(_dir, error)) return false;
+
+    const auto dir_mtime = fs::last_write_time(_dir, error);
+    if (error || CastIndex::stamp(dir_mtime) > _dir_mtime) return true;
+
+    std::atomic<bool> changed(false);
+
+    Orbit::parallel_for(_entries.size(), [&](size_t i) {
+        if (changed) return;
+
+        const auto &entry = _entries[i];
+        const auto path = _dir / entry.filename;
+
+        std::error_code error;
+        const auto size = fs::file_size(path, error);
+        if (error || size != entry.source_size) { changed = true; return; }
+
+        const auto mtime = fs::last_write_time(path, error);
+        if (error || CastIndex::stamp(mtime) > entry.source_mtime) changed = true;
+    });
+
+    return changed;
+}
+
+void CastPack::build(const CastIndex &index, const fs::path &path, bool compress) {
+    const auto &entries = index.entries();
+
+    auto temporary = path;
+    temporary += ".tmp";
+
+    std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+    if (!file) throw std::runtime_error("failed to open " + temporary.string());
+
+    PackHeader header{ PACK_MAGIC, VERSION, 0, 0, 0, index.dir_mtime() };
+
+    // Filled in once the table of contents is known
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+    uint64_t position = sizeof(header);
+
+    vector<PackRecord> records;
+    string strings;
+
+    records.reserve(entries.size());
+
+    for (size_t start = 0; start < entries.size(); start += PACK_BATCH) {
+        const size_t count = std::min(PACK_BATCH, entries.size() - start);
+
+        vector<string> blobs(count);
+        vector<PackRecord> batch(count);
+        vector<char> loaded(count, 0);
+
+        Orbit::parallel_for(count, [&](size_t i) {
+            const auto &entry = entries[start + i];
+            const auto member = index.dir() / entry.filename;
+
+            auto &record = batch[i];
+            record.id = entry.id;
+            record.width = entry.width;
+            record.height = entry.height;
+            record.encoding = static_cast<uint32_t>(Encoding::Raw);
+
+            if (member.extension() == ".txt") {
+                record.kind = static_cast<uint32_t>(Kind::Text);
+                blobs[i] = read_file(member);
+            }
+            else if (compress) {
+                record.kind = static_cast<uint32_t>(Kind::Image);
+                record.encoding = static_cast<uint32_t>(Encoding::Png);
+                blobs[i] = read_file(member);
+            }
+            else {
+                record.kind = static_cast<uint32_t>(Kind::Image);
+
+                Image image = LoadImage(member.string().c_str());
+                if (image.data == nullptr) return;
+
+                ImageFormat(&image, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+
+                record.width = image.width;
+                record.height = image.height;
+                blobs[i].assign(static_cast<const char *>(image.data), static_cast<size_t>(image.width) * image.height * 4);
+
+                UnloadImage(image);
+            }
+
+            loaded[i] = 1;
+        });
+
+        for (size_t i = 0; i < count; i++) {
+            if (!loaded[i]) continue;
+
+            const auto &entry = entries[start + i];
+            auto &record = batch[i];
+
+            const uint64_t padding = (PACK_ALIGNMENT - position % PACK_ALIGNMENT) % PACK_ALIGNMENT;
+            const char zeros[PACK_ALIGNMENT] = {};
+
+            file.write(zeros, padding);
+            position += padding;
+
+            file.write(blobs[i].data(), blobs[i].size());
+
+            record.offset = position;
+            record.size = blobs[i].size();
+            record.source_mtime = entry.mtime;
+            record.source_size = entry.size;
+            record.names = CastIndex::Names::append(entry, strings);
+
+            position += record.size;
+            records.push_back(record);
+        }
+    }
+
+    header.count = static_cast<uint32_t>(records.size());
+    header.strings = static_cast<uint32_t>(strings.size());
+    header.toc = position;
+
+    file.write(reinterpret_cast<const char *>(records.data()), records.size() * sizeof(PackRecord));
+    file.write(strings.data(), strings.size());
+
+    file.seekp(0);
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+    file.close();
+    if (!file) throw std::runtime_error("failed to write " + temporary.string());
+
+    fs::rename(temporary, path);
+}
+
+CastPack::CastPack(const fs::path &path, const fs::path &dir) : _file(path), _dir(dir), _entries({}), _dir_mtime(0) {
+    const char *data = _file.data();
+    const size_t size = _file.size();
+
+    auto invalid = [&path](const char *reason) {
+        return std::runtime_error("invalid cast pack " + path.string() + ": " + reason);
+    };
+
+    if (size < sizeof(PackHeader)) throw invalid("too small");
+
+    PackHeader header;
+    std::memcpy(&header, data, sizeof(PackHeader));
+
+    if (header.magic != PACK_MAGIC) throw invalid("not a cast pack");
+    if (header.version != VERSION) throw invalid("unsupported version");
+
+    _dir_mtime = header.dir_mtime;
+
+    if (header.toc > size || size - header.toc != static_cast<uint64_t>(header.count) * sizeof(PackRecord) + header.strings) {
+        throw invalid("truncated");
+    }
+
+    const char *records = data + header.toc;
+    const char *strings = records + static_cast<size_t>(header.count) * sizeof(PackRecord);
+
+    _entries.reserve(header.count);
+
+    for (uint32_t i = 0; i < header.count; i++) {
+        PackRecord record;
+        std::memcpy(&record, records + i * sizeof(PackRecord), sizeof(PackRecord));
+
+        if (record.offset > header.toc || record.size > header.toc - record.offset) throw invalid("member out of bounds");
+        if (!record.names.valid(header.strings)) throw invalid("name out of bounds");
+        if (record.kind > static_cast<uint32_t>(Kind::Text) || record.encoding > static_cast<uint32_t>(Encoding::Png)) throw invalid("unknown member type");
+
+        if (record.kind == static_cast<uint32_t>(Kind::Image) && record.encoding == static_cast<uint32_t>(Encoding::Raw)) {
+            if (record.width < 0 || record.height < 0 || record.size != static_cast<uint64_t>(record.width) * record.height * 4) {
+                throw invalid("image size mismatch");
+            }
+        }
+
+        Entry entry{
+            {}, {}, {},
+            record.id,
+            record.width,
+            record.height,
+            static_cast<Kind>(record.kind),
+            static_cast<Encoding>(record.encoding),
+            record.offset,
+            record.size,
+            record.source_mtime,
+            record.source_size
+        };
+
+        record.names.read(strings, entry.filename, entry.lib, entry.name);
+
+        _entries.push_back(std::move(entry));
+    }
+}
+
+};
@@ -3,6 +3,7 @@
 #include <sstream>
 
 #include <Orbit/Lua/runtime.h>
+#include <Orbit/Lua/fields.h>
 
 #include <raylib.h>
 
@@ -14,6 +15,8 @@ extern "C" {
 
 namespace Orbit::Lua {
 
+static constexpr auto FIELDS = fields("r", "g", "b", "a", "pack");
+
 inline uint32_t pack(const Color *c) {
 	return static_cast<uint32_t>(c->a << 24) | 
 			static_cast<uint32_t>(c->b << 16) | 
@@ -33,14 +36,15 @@ int color_pack(lua_State *L) {
 void LuaRuntime::_register_color() {
 	const auto read = [](lua_State *L) {
 		Color *p = static_cast<Color *>(luaL_checkudata(L, 1, "color"));
-		const char *field = luaL_checkstring(L, 2);
 
-		if (std::strcmp(field, "r") == 0) lua_pushnumber(L, p->r);
-		else if (std::strcmp(field, "g") == 0) lua_pushnumber(L, p->g);
-		else if (std::strcmp(field, "b") == 0) lua_pushnumber(L, p->b);
-		else if (std::strcmp(field, "a") == 0) lua_pushnumber(L, p->a);
-		else if (std::strcmp(field, "pack") == 0) lua_pushcfunction(L, color_pack);
-		else lua_pushnil(L);
+		switch (FIELDS.find(L, 2)) {
+			case FIELDS["r"]: lua_pushnumber(L, p->r); break;
+			case FIELDS["g"]: lua_pushnumber(L, p->g); break;
+			case FIELDS["b"]: lua_pushnumber(L, p->b); break;
+			case FIELDS["a"]: lua_pushnumber(L, p->a); break;
+			case FIELDS["pack"]: lua_pushcfunction(L, color_pack); break;
+			default: lua_pushnil(L);
+		}
 
 		return 1;
 	};
@@ -48,14 +52,16 @@ void LuaRuntime::_register_color() {
 	const auto write = [](lua_State *L) {
 		Color *p = static_cast<Color *>(luaL_checkudata(L, 1, "color"));
 
-		const char *field = luaL_checkstring(L, 2);
+		const int field = FIELDS.find(L, 2);
 		int value = luaL_checknumber(L, 3);
 
-		if (std::strcmp(field, "r") == 0) p->r = (uint8_t)value;
-		else if (std::strcmp(field, "g") == 0) p->g = (uint8_t)value;
-		else if (std::strcmp(field, "b") == 0) p->b = (uint8_t)value;
-		else if (std::strcmp(field, "a") == 0) p->a = (uint8_t)value;
-		else luaL_error(L, "invalid field '%s' in color", field);
+		switch (field) {
+			case FIELDS["r"]: p->r = (uint8_t)value; break;
+			case FIELDS["g"]: p->g = (uint8_t)value; break;
+			case FIELDS["b"]: p->b = (uint8_t)value; break;
+			case FIELDS["a"]: p->a = (uint8_t)value; break;
+			default: luaL_error(L, "invalid field '%s' in color", lua_tostring(L, 2));
+		}
 
 		return 0;
 	};
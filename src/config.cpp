@@ -1,5 +1,7 @@
 #include <Orbit/config.h>
 
+#include <string>
+#include <algorithm>
 #include <iostream>
 #include <filesystem>
 
@@ -7,7 +9,10 @@
 
 namespace Orbit {
 
-Config::Config() : width(1400), height(800), fps(15) {}
+Config::Config() : width(1400), height(800), fps(15), cast_cache_mb(256), lua_allocator(Allocator::Pool), profile(false), sample_lua(false),
+    log_level(spdlog::level::info),
+    log_queue_size(8192),
+    log_overflow(LogOverflow::Block) {}
 
 Config::Config(const std::filesystem::path &file) : Config() {
     try {
@@ -16,6 +21,35 @@ Config::Config(const std::filesystem::path &file) : Config() {
         width = parsed["width"].value_or(width);
         height = parsed["height"].value_or(height);
         fps = parsed["fps"].value_or(fps);
+        cast_cache_mb = parsed["cast_cache_mb"].value_or(cast_cache_mb);
+
+        const std::string allocator = parsed["lua_allocator"].value_or("pool");
+
+        if (allocator == "system") lua_allocator = Allocator::System;
+        else if (allocator == "pool") lua_allocator = Allocator::Pool;
+        else std::cout << "unknown lua_allocator '" << allocator << "'; using the pool" << std::endl;
+
+        profile = parsed["profile"].value_or(profile);
+        sample_lua = parsed["sample_lua"].value_or(sample_lua);
+
+        // verbose_debugging is what older configs have
+        if (parsed["verbose_debugging"].value_or(false)) log_level = spdlog::level::debug;
+
+        if (const auto level = parsed["log_level"].value<std::string>()) {
+            const auto parsed_level = spdlog::level::from_str(*level);
+
+            // from_str gives off for the names it doesn't know
+            if (parsed_level != spdlog::level::off || *level == "off") log_level = parsed_level;
+            else std::cout << "unknown log_level '" << *level << "'; using " << spdlog::level::to_string_view(log_level).data() << std::endl;
+        }
+
+        log_queue_size = std::max(1, parsed["log_queue_size"].value_or(log_queue_size));
+
+        const std::string overflow = parsed["log_overflow"].value_or("block");
+
+        if (overflow == "drop") log_overflow = LogOverflow::Drop;
+        else if (overflow == "block") log_overflow = LogOverflow::Block;
+        else std::cout << "unknown log_overflow '" << overflow << "'; blocking" << std::endl;
     } catch (std::exception &e) {
         std::cout << "failed to load config file: " << file << std::endl;
     }
@@ -0,0 +1,134 @@
+#include <Orbit/RlExt/drawqueue.h>
+#include <Orbit/RlExt/canvas.h>
+#include <Orbit/RlExt/rl.h>
+
+#include <cstring>
+
+#include <raylib.h>
+
+namespace Orbit::RlExt {
+
+void DrawQueue::_sample(Canvas *canvas) {
+	if (canvas == nullptr || canvas->pending == this) return;
+
+	// Queued in another queue; that one has to go first
+	if (canvas->pending != nullptr) canvas->pending->flush();
+
+	canvas->pending = this;
+	_sampled.push_back(canvas);
+}
+
+void DrawQueue::clear(Color color) {
+	_commands.clear();
+	_text.clear();
+
+	Command command{};
+	command.kind = Kind::Clear;
+	command.color = color;
+
+	_commands.push_back(command);
+}
+
+void DrawQueue::text(const char *text, int x, int y, int size, Color color) {
+	Command command{};
+	command.kind = Kind::Text;
+	command.color = color;
+	command.dest = Rectangle{ static_cast<float>(x), static_cast<float>(y), 0, 0 };
+	command.size = size;
+	command.text = _text.size();
+
+	_text.append(text, std::strlen(text) + 1);
+	_commands.push_back(command);
+}
+
+void DrawQueue::line(Vector2 from, Vector2 to, float thickness, Color color) {
+	Command command{};
+	command.kind = Kind::Line;
+	command.color = color;
+	command.vertices[0] = from;
+	command.vertices[1] = to;
+	command.thickness = thickness;
+
+	_commands.push_back(command);
+}
+
+void DrawQueue::texture(Texture2D texture, Rectangle source, Rectangle dest, Color color, Canvas *canvas) {
+	_sample(canvas);
+
+	Command command{};
+	command.kind = Kind::Texture;
+	command.color = color;
+	command.texture = texture;
+	command.source = source;
+	command.dest = dest;
+
+	_commands.push_back(command);
+}
+
+void DrawQueue::quad(Texture2D texture, Rectangle source, const Vector2 vertices[4], Color color, Canvas *canvas) {
+	_sample(canvas);
+
+	Command command{};
+	command.kind = Kind::Quad;
+	command.color = color;
+	command.texture = texture;
+	command.source = source;
+	std::memcpy(command.vertices, vertices, sizeof(command.vertices));
+
+	_commands.push_back(command);
+}
+
+void DrawQueue::flush() {
+	for (auto *canvas : _sampled) canvas->pending = nullptr;
+	_sampled.clear();
+
+	if (_commands.empty()) return;
+
+	if (_target->id != 0) {
+		BeginTextureMode(*_target);
+
+		for (const auto &command : _commands) {
+			switch (command.kind) {
+				case Kind::Clear:
+					ClearBackground(command.color);
+					break;
+
+				case Kind::Text:
+					DrawText(_text.c_str() + command.text, static_cast<int>(command.dest.x), static_cast<int>(command.dest.y), command.size, command.color);
+					break;
+
+				case Kind::Line:
+					DrawLineEx(command.vertices[0], command.vertices[1], command.thickness, command.color);
+					break;
+
+				case Kind::Texture:
+					DrawTexturePro(command.texture, command.source, command.dest, Vector2{0, 0}, 0, command.color);
+					break;
+
+				case Kind::Quad: {
+					// The vertices are uniforms, so every quad is a draw call of its own
+					const auto &s = _shaders->invb;
+
+					BeginShaderMode(s.shader);
+					s.prepare(command.texture, command.source, command.vertices);
+					Orbit::RlExt::DrawTexture(&command.texture, &command.source, command.vertices, command.color);
+					EndShaderMode();
+				} break;
+			}
+		}
+
+		EndTextureMode();
+	}
+
+	_commands.clear();
+	_text.clear();
+}
+
+DrawQueue::DrawQueue(const RenderTexture2D &target, const Orbit::Shaders *shaders) :
+	_target(&target),
+	_shaders(shaders),
+	_commands({}),
+	_text(""),
+	_sampled({}) {}
+
+};
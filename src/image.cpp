@@ -1,15 +1,22 @@
+#include <algorithm>
 #include <optional>
+#include <cmath>
 #include <sstream>
 #include <cstring>
 #include <string>
+#include <new>
 
 #include <xsimd/xsimd.hpp>
 
 #include <Orbit/RlExt/image.h>
+#include <Orbit/RlExt/canvas.h>
 #include <Orbit/Lua/rect.h>
 #include <Orbit/Lua/quad.h>
+#include <Orbit/Lua/userdata.h>
+#include <Orbit/Lua/fields.h>
 #include <Orbit/Lua/runtime.h>
 #include <Orbit/RlExt/rl.h>
+#include <Orbit/profiler.h>
 
 #include <raylib.h>
 #include <rlgl.h>
@@ -22,94 +29,67 @@ extern "C" {
 
 #define META "image"
 
-// Image MakeSilhouette(const Image *src) {
-// 	if (src->format != PIXELFORMAT_UNCOMPRESSED_R8G8B8A8 && 
-//         src->format != PIXELFORMAT_UNCOMPRESSED_R8G8B8) {
-//         throw std::runtime_error("unsupported image format");
-//     }
-    
-//     Image silhouette = ImageCopy(*src);
-//     const int length = silhouette.width * silhouette.height;
-    
-//     if (src->format == PIXELFORMAT_UNCOMPRESSED_R8G8B8A8) {
-//         using batch_type = xsimd::batch<uint32_t>;
-//         constexpr size_t batch_size = batch_type::size;
-//         const uint32_t white_pixel = 0xFFFFFFFF;
-//         auto white_batch = xsimd::broadcast<uint32_t>(white_pixel);
-//         const uint32_t black_pixel = 0xFF000000;
-//         auto black_batch = xsimd::broadcast<uint32_t>(black_pixel);
-//         uint32_t *pixel_data = reinterpret_cast<uint32_t *>(silhouette.data);
-        
-//         size_t i = 0;
-//         for (; i + batch_size <= static_cast<size_t>(length); i += batch_size) {
-//             auto pixel_batch = xsimd::load_unaligned(&pixel_data[i]);
-//             auto is_white_mask = xsimd::eq(pixel_batch, white_batch);
-//             auto res_batch = xsimd::select(is_white_mask, white_batch, black_batch);
-//             xsimd::store_unaligned(&pixel_data[i], res_batch);
-//         }
-//         for (; i < static_cast<size_t>(length); ++i) {
-//             if (pixel_data[i] != white_pixel) pixel_data[i] = black_pixel;
-//         }
-//     } else {
-//         using batch_type = xsimd::batch<uint8_t>;
-//         constexpr size_t batch_size = batch_type::size;
-//         const uint8_t white_component = 255;
-//         const uint8_t black_component = 0;
-//         auto white_batch = xsimd::broadcast<uint8_t>(white_component);
-//         auto black_batch = xsimd::broadcast<uint8_t>(black_component);
-//         uint8_t *pixel_data = reinterpret_cast<uint8_t *>(silhouette.data);
-        
-//         size_t total_bytes = length * 3;
-//         size_t i = 0;
-        
-//         for (; i + batch_size <= total_bytes; i += batch_size) {
-//             auto pixel_batch = xsimd::load_unaligned(&pixel_data[i]);
-//             auto is_white_mask = xsimd::eq(pixel_batch, white_batch);
-//             auto res_batch = xsimd::select(is_white_mask, white_batch, black_batch);
-//             xsimd::store_unaligned(&pixel_data[i], res_batch);
-//         }
-        
-//         size_t remaining_pixels_start = (i / 3) * 3;
-//         for (size_t pixel_idx = remaining_pixels_start / 3; pixel_idx < static_cast<size_t>(length); ++pixel_idx) {
-//             size_t base_idx = pixel_idx * 3;
-//             uint8_t r = pixel_data[base_idx];
-//             uint8_t g = pixel_data[base_idx + 1];
-//             uint8_t b = pixel_data[base_idx + 2];
-            
-//             if (r == 255 && g == 255 && b == 255) {
-//                 // Keep white pixel as is
-//                 pixel_data[base_idx] = 255;
-//                 pixel_data[base_idx + 1] = 255;
-//                 pixel_data[base_idx + 2] = 255;
-//             } else {
-//                 // Convert to black
-//                 pixel_data[base_idx] = 0;
-//                 pixel_data[base_idx + 1] = 0;
-//                 pixel_data[base_idx + 2] = 0;
-//             }
-//         }
-//     }
-    
-//     return silhouette;
-// }
+static constexpr auto FIELDS = Orbit::Lua::fields("width", "height", "clear", "rect", "copyPixels", "silhouette");
+
+using Orbit::RlExt::Canvas;
+
+// CPU counterpart of the silhouette shader, for when there's no context.
+Image MakeSilhouette(const Image &src, bool invert) {
+	Image silhouette = ImageCopy(src);
+
+	if (silhouette.format != PIXELFORMAT_UNCOMPRESSED_R8G8B8A8) {
+		ImageFormat(&silhouette, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+	}
+
+	using batch_type = xsimd::batch<uint32_t>;
+	constexpr size_t batch_size = batch_type::size;
+
+	const uint32_t white_pixel = 0xFFFFFFFF;
+	const uint32_t black_pixel = 0xFF000000;
+
+	const uint32_t background = invert ? black_pixel : white_pixel;
+	const uint32_t foreground = invert ? white_pixel : black_pixel;
+
+	const auto white_batch = batch_type(white_pixel);
+	const auto background_batch = batch_type(background);
+	const auto foreground_batch = batch_type(foreground);
+
+	const size_t length = static_cast<size_t>(silhouette.width) * silhouette.height;
+	uint32_t *pixel_data = static_cast<uint32_t *>(silhouette.data);
+
+	size_t i = 0;
+	for (; i + batch_size <= length; i += batch_size) {
+		auto pixel_batch = batch_type::load_unaligned(&pixel_data[i]);
+		auto res_batch = xsimd::select(pixel_batch == white_batch, background_batch, foreground_batch);
+		res_batch.store_unaligned(&pixel_data[i]);
+	}
+	for (; i < length; ++i) {
+		pixel_data[i] = pixel_data[i] == white_pixel ? background : foreground;
+	}
+
+	return silhouette;
+}
 
 int image_fill(lua_State *L) {
-	Image *img  = static_cast<Image *>(luaL_checkudata(L, 1, "image"));
+	const auto mark = Orbit::profiler.open("image.clear");
+
+	Canvas *img  = static_cast<Canvas *>(luaL_checkudata(L, 1, "image"));
 	Color *c = static_cast<Color *>(luaL_testudata(L, 2, "color"));
 
-	ImageClearBackground(img, c ? *c : WHITE);
+	img->clear(c ? *c : WHITE);
 
+	Orbit::profiler.close(mark);
 	return 0;
 }
 
 int image_tostring(lua_State *L) {
-	Image *img = static_cast<Image *>(luaL_checkudata(L, 1, META));
+	Canvas *img = static_cast<Canvas *>(luaL_checkudata(L, 1, META));
 
 	std::stringstream ss;
 
 	ss << META << '('
-		<< img->width <<
-		", " << img->height << ')';
+		<< img->width() <<
+		", " << img->height() << ')';
 
 	auto str = ss.str();
 
@@ -127,48 +107,48 @@ int image_concat(lua_State *L) {
 }
 
 int image_make_silhouette(lua_State *L){ 
-	Image *img = static_cast<Image *>(luaL_checkudata(L, 1, "image"));
+	const auto mark = Orbit::profiler.open("silhouette");
+
+	Canvas *img = static_cast<Canvas *>(luaL_checkudata(L, 1, "image"));
 	bool invert = lua_toboolean(L, 2);
-	// *nimg = MakeSilhouette(img);
 
 	auto* runtime = static_cast<Orbit::Lua::LuaRuntime*>(lua_touserdata(L, lua_upvalueindex(1)));
-	auto &shadero = runtime->shaders->silhouette;
-	auto t = LoadTextureFromImage(*img);
-	auto canvas = LoadRenderTexture(img->width, img->height);
-	
-	BeginTextureMode(canvas);
-	
-	BeginShaderMode(shadero.shader);
-	shadero.prepare(t, invert, true);
-	DrawTexture(t, 0, 0, WHITE);
-	EndShaderMode();
 
-	EndTextureMode();
+	Canvas *nimg = static_cast<Canvas *>(lua_newuserdata(L, sizeof(Canvas)));
 
-	Image *nimg = static_cast<Image *>(lua_newuserdata(L, sizeof(Image)));
-	*nimg = LoadImageFromTexture(canvas.texture);
+	if (!IsWindowReady()) {
+		new (nimg) Canvas(MakeSilhouette(img->pixels(), invert));
+	} else {
+		auto &shadero = runtime->shaders->silhouette;
+		auto t = img->texture();
 
-	UnloadTexture(t);
-	UnloadRenderTexture(canvas);
+		new (nimg) Canvas(img->width(), img->height());
+		
+		nimg->begin();
+		
+		BeginShaderMode(shadero.shader);
+		shadero.prepare(t, invert, true);
+		DrawTexture(t, 0, 0, WHITE);
+		EndShaderMode();
+
+		nimg->end();
+	}
 
 	luaL_getmetatable(L, "image");
 	lua_setmetatable(L, -2);
 
+	Orbit::profiler.close(mark);
 	return 1; 
 }
 
 int image_rect (lua_State *L2){
-	Image *img = static_cast<Image *>(luaL_checkudata(L2, 1, "image"));
+	Canvas *img = static_cast<Canvas *>(luaL_checkudata(L2, 1, "image"));
 	
-	auto **rect = static_cast<Orbit::Lua::Rect **>(lua_newuserdata(L2, sizeof(Orbit::Lua::Rect *)));
-	*rect = new Orbit::Lua::Rect(
+	Orbit::Lua::push_value(L2, Orbit::Lua::Rect(
 		0, 0,
-		(float)img->width,
-		(float)img->height
-	);
-
-	luaL_getmetatable(L2, "rect");
-	lua_setmetatable(L2, -2);
+		(float)img->width(),
+		(float)img->height()
+	), "rect");
 
 	return 1;
 }
@@ -199,7 +179,7 @@ Orbit::RlExt::CopyImageParams parse_copy_params(lua_State *L, int index) {
 	
 	lua_getfield(L, index, "mask");
 	if (!lua_isnil(L, -1)) {
-		Image *i = static_cast<Image *>(luaL_checkudata(L, -1, "image"));
+		Canvas *i = static_cast<Canvas *>(luaL_checkudata(L, -1, "image"));
 		params.mask = i;
 	}
 	lua_pop(L, 1);
@@ -207,12 +187,70 @@ Orbit::RlExt::CopyImageParams parse_copy_params(lua_State *L, int index) {
 	return params;
 }
 
+// Blits that cover at most this many pixels are composited on the CPU,
+// as long as none of the images involved has to be downloaded first.
+constexpr float CPU_BLIT_MAX_AREA = 64 * 64;
+
+bool prefer_cpu(Canvas *src, Canvas *dst, const Orbit::RlExt::CopyImageParams &params, float area) {
+	// No context, no choice
+	if (!IsWindowReady()) return true;
+
+	if (area > CPU_BLIT_MAX_AREA) return false;
+
+	// Writing to a destination that's up to date on the GPU would cost a full upload later.
+	if (dst->resident() && !dst->gpu_stale) return false;
+
+	return !src->cpu_stale && !dst->cpu_stale && (params.mask == nullptr || !params.mask->cpu_stale);
+}
+
+void copy_pixels(
+	Orbit::Lua::LuaRuntime *runtime, 
+	Canvas *src, 
+	Canvas *dst, 
+	const Orbit::Lua::Rect *from, 
+	const Orbit::Lua::Rect *to, 
+	const Orbit::RlExt::CopyImageParams &params
+) {
+	if (prefer_cpu(src, dst, params, std::fabs(to->width() * to->height()))) {
+		Orbit::RlExt::CopyImage_CPU(&src->pixels(), &dst->pixels_mut(), from, to, params);
+	} else {
+		Orbit::RlExt::CopyImage_GPU(&runtime->shaders->copy_pixels, src, dst, from, to, params, &runtime->atlas);
+	}
+}
+
+void copy_pixels(
+	Orbit::Lua::LuaRuntime *runtime, 
+	Canvas *src, 
+	Canvas *dst, 
+	const Orbit::Lua::Rect *from, 
+	const Orbit::Lua::Quad *to, 
+	const Orbit::RlExt::CopyImageParams &params
+) {
+	float minX = to->vertices[0].x, maxX = minX;
+	float minY = to->vertices[0].y, maxY = minY;
+
+	for (int v = 1; v < 4; v++) {
+		minX = std::min(minX, to->vertices[v].x);
+		maxX = std::max(maxX, to->vertices[v].x);
+		minY = std::min(minY, to->vertices[v].y);
+		maxY = std::max(maxY, to->vertices[v].y);
+	}
+
+	if (prefer_cpu(src, dst, params, (maxX - minX) * (maxY - minY))) {
+		Orbit::RlExt::CopyImage_CPU(&src->pixels(), &dst->pixels_mut(), from, to, params);
+	} else {
+		Orbit::RlExt::CopyImage_GPU(&runtime->shaders->invb_copy_pixels, src, dst, from, to, params, &runtime->atlas);
+	}
+}
+
 int image_copy_pixels(lua_State *L) {
+	const auto mark = Orbit::profiler.open("copyPixels");
+
 	int count = lua_gettop(L);
 	auto* runtime = static_cast<Orbit::Lua::LuaRuntime*>(lua_touserdata(L, lua_upvalueindex(1)));
 
-	Image *dst = static_cast<Image *>(luaL_checkudata(L, 1, "image"));
-	Image *src = static_cast<Image *>(luaL_checkudata(L, 2, "image"));
+	Canvas *dst = static_cast<Canvas *>(luaL_checkudata(L, 1, "image"));
+	Canvas *src = static_cast<Canvas *>(luaL_checkudata(L, 2, "image"));
 
 	void *arg3Ptr = nullptr;
 	void *arg4Ptr = nullptr;
@@ -223,14 +261,14 @@ int image_copy_pixels(lua_State *L) {
 	) {
 		// copy(dst, src, dstRect, srcRect, {opt})
 
-		auto *dstRect = *static_cast<Orbit::Lua::Rect **>(arg3Ptr);
-		auto *srcRect = *static_cast<Orbit::Lua::Rect **>(arg4Ptr);
+		auto *dstRect = Orbit::Lua::userdata_value<Orbit::Lua::Rect>(arg3Ptr);
+		auto *srcRect = Orbit::Lua::userdata_value<Orbit::Lua::Rect>(arg4Ptr);
 
 		Orbit::RlExt::CopyImageParams params;
 		if (lua_istable(L, 5)) params = parse_copy_params(L, 5);
 
-		Orbit::RlExt::CopyImage_GPU(
-			&runtime->shaders->copy_pixels,
+		copy_pixels(
+			runtime,
 			src,
 			dst,
 			srcRect,
@@ -244,14 +282,14 @@ int image_copy_pixels(lua_State *L) {
 	) {
 		// copy(dst, src, dstQuad, srcRect, {opt})
 
-		auto *dstQuad = *static_cast<Orbit::Lua::Quad **>(arg3Ptr);
-		auto *srcRect = *static_cast<Orbit::Lua::Rect **>(arg4Ptr);
+		auto *dstQuad = Orbit::Lua::userdata_value<Orbit::Lua::Quad>(arg3Ptr);
+		auto *srcRect = Orbit::Lua::userdata_value<Orbit::Lua::Rect>(arg4Ptr);
 
 		Orbit::RlExt::CopyImageParams params;
 		if (lua_istable(L, 5)) params = parse_copy_params(L, 5);
 
-		Orbit::RlExt::CopyImage_GPU(
-			&runtime->shaders->invb_copy_pixels,
+		copy_pixels(
+			runtime,
 			src,
 			dst,
 			srcRect,
@@ -264,14 +302,14 @@ int image_copy_pixels(lua_State *L) {
 	) {
 		// copy(dst, src, dstRect, {opt})
 
-		auto *dstRect = *static_cast<Orbit::Lua::Rect **>(arg3Ptr);
-		auto srcRect = Orbit::Lua::Rect {0, 0, (float)src->width, (float)src->height};
+		auto *dstRect = Orbit::Lua::userdata_value<Orbit::Lua::Rect>(arg3Ptr);
+		auto srcRect = Orbit::Lua::Rect {0, 0, (float)src->width(), (float)src->height()};
 
 		Orbit::RlExt::CopyImageParams params;
 		if (lua_istable(L, 4)) params = parse_copy_params(L, 4);
 
-		Orbit::RlExt::CopyImage_GPU(
-			&runtime->shaders->copy_pixels,
+		copy_pixels(
+			runtime,
 			src,
 			dst,
 			&srcRect,
@@ -284,14 +322,14 @@ int image_copy_pixels(lua_State *L) {
 	) {
 		// copy(dst, src, dstRect, {opt})
 
-		auto *dstQuad = *static_cast<Orbit::Lua::Quad **>(arg3Ptr);
-		auto srcRect = Orbit::Lua::Rect {0, 0, (float)src->width, (float)src->height};
+		auto *dstQuad = Orbit::Lua::userdata_value<Orbit::Lua::Quad>(arg3Ptr);
+		auto srcRect = Orbit::Lua::Rect {0, 0, (float)src->width(), (float)src->height()};
 
 		Orbit::RlExt::CopyImageParams params;
 		if (lua_istable(L, 4)) params = parse_copy_params(L, 4);
 
-		Orbit::RlExt::CopyImage_GPU(
-			&runtime->shaders->invb_copy_pixels,
+		copy_pixels(
+			runtime,
 			src,
 			dst,
 			&srcRect,
@@ -302,13 +340,13 @@ int image_copy_pixels(lua_State *L) {
 	else {
 		// copy(dst, src, {opt})
 
-		auto targetRect = Orbit::Lua::Rect {0, 0, (float)src->width, (float)src->height};
+		auto targetRect = Orbit::Lua::Rect {0, 0, (float)src->width(), (float)src->height()};
 
 		Orbit::RlExt::CopyImageParams params;
 		if (lua_istable(L, 3)) params = parse_copy_params(L, 3);
 
-		Orbit::RlExt::CopyImage_GPU(
-			&runtime->shaders->copy_pixels,
+		copy_pixels(
+			runtime,
 			src,
 			dst,
 			&targetRect,
@@ -317,36 +355,31 @@ int image_copy_pixels(lua_State *L) {
 		);
 	}
 
+	Orbit::profiler.close(mark);
 	return 0;
 }
 
 
+// Upvalues: the copyPixels and silhouette closures.
 int image_index(lua_State *L) {
-	Image *img = static_cast<Image *>(luaL_checkudata(L, 1, META));
-	const char *field = luaL_checkstring(L, 2);
-
-	auto* runtime = static_cast<Orbit::Lua::LuaRuntime*>(lua_touserdata(L, lua_upvalueindex(1)));
-	
-	if (std::strcmp(field, "width") == 0) lua_pushnumber(L, img->width);
-	else if (std::strcmp(field, "height") == 0) lua_pushnumber(L, img->height);
-	else if (std::strcmp(field, "clear") == 0) lua_pushcfunction(L, image_fill);
-	else if (std::strcmp(field, "rect") == 0) lua_pushcfunction(L, image_rect);
-	else if (std::strcmp(field, "copyPixels") == 0) {
-		lua_pushlightuserdata(L, runtime);
-		lua_pushcclosure(L, image_copy_pixels, 1);
+	Canvas *img = static_cast<Canvas *>(luaL_checkudata(L, 1, META));
+
+	switch (FIELDS.find(L, 2)) {
+		case FIELDS["width"]: lua_pushnumber(L, img->width()); break;
+		case FIELDS["height"]: lua_pushnumber(L, img->height()); break;
+		case FIELDS["clear"]: lua_pushcfunction(L, image_fill); break;
+		case FIELDS["rect"]: lua_pushcfunction(L, image_rect); break;
+		case FIELDS["copyPixels"]: lua_pushvalue(L, lua_upvalueindex(1)); break;
+		case FIELDS["silhouette"]: lua_pushvalue(L, lua_upvalueindex(2)); break;
+		default: lua_pushnil(L);
 	}
-	else if (std::strcmp(field, "silhouette") == 0) {
-		lua_pushlightuserdata(L, runtime);
-		lua_pushcclosure(L, image_make_silhouette, 1);
-	}
-	else lua_pushnil(L);
 
 	return 1;
 }
 
 int image_eq(lua_State *L) {
-	Image *a = static_cast<Image *>(luaL_checkudata(L, 1, META));
-	Image *b = static_cast<Image *>(luaL_checkudata(L, 2, META));
+	Canvas *a = static_cast<Canvas *>(luaL_checkudata(L, 1, META));
+	Canvas *b = static_cast<Canvas *>(luaL_checkudata(L, 2, META));
 
 	lua_pushboolean(L, a == b);
 
@@ -354,8 +387,8 @@ int image_eq(lua_State *L) {
 }
 
 int image_gc(lua_State *L) {
-	Image *img = static_cast<Image *>(luaL_checkudata(L, 1, META));
-	UnloadImage(*img);
+	Canvas *img = static_cast<Canvas *>(luaL_checkudata(L, 1, META));
+	img->~Canvas();
 	return 0;
 }
 
@@ -371,41 +404,57 @@ CopyImageParams::CopyImageParams(
     float blend, 
     std::optional<Color> color, 
     CopyImageInk ink, 
-    Image *mask
+    Canvas *mask
 ) : 
     blend(blend), 
     color(color), 
     ink(ink), 
     mask(mask) {}
 
+bool CopyImageParams::samples_destination() const {
+	switch (ink) {
+		case CopyImageInk::Darkest: return true;
+		
+		case CopyImageInk::None:
+		case CopyImageInk::TransparentBackground: return blend < 0.987f;
+	}
+
+	return false;
+}
+
 
 void CopyImage_GPU(
 	const Orbit::CopyPixelsShader *shader, 
-	const Image *src, 
-	Image *dst, 
+	Canvas *src, 
+	Canvas *dst, 
 	const Orbit::Lua::Rect *from, 
 	const Orbit::Lua::Rect *to, 
-	const CopyImageParams &params
+	const CopyImageParams &params,
+	Atlas *atlas
 ) {
-    auto srcT = LoadTextureFromImage(*src);
-	auto dstT = LoadTextureFromImage(*dst);
-	Texture2D *mask = nullptr;
-	auto canvas = LoadRenderTexture(dstT.width, dstT.height);
+	// The destination can't be sampled while it's being rendered to,
+	// so those blits go through the canvas' scratch buffer.
+	bool feedback = params.samples_destination() || src == dst || params.mask == dst;
 
-    if (params.mask) *mask = LoadTextureFromImage(*params.mask);
-		
-    BeginTextureMode(canvas);
-    DrawTexture(dstT, 0, 0, WHITE);
+	auto source = atlas ? atlas->view(*src) : TextureView{ src->texture(), Rectangle{0, 0, 1, 1} };
+    auto srcT = source.texture;
+	auto dstT = dst->texture();
+	Texture2D mask;
+
+    if (params.mask) mask = params.mask->texture();
+
+    dst->begin(feedback);
     
     BeginShaderMode(shader->shader);
     shader->prepare(
         srcT, 
-        dstT, 
+        feedback ? dstT : srcT, 
         params.color != std::nullopt, 
         static_cast<int>(params.ink), 
         params.blend,
-        false,
-        mask
+        true,
+        params.mask ? &mask : nullptr,
+        source.region
     );
     DrawTexturePro(
         srcT, 
@@ -416,61 +465,48 @@ void CopyImage_GPU(
         params.color.value_or(WHITE)
     );
     EndShaderMode();
-    EndTextureMode();
 
-    UnloadImage(*dst);
-	*dst = LoadImageFromTexture(canvas.texture);
-	ImageFlipVertical(dst);
-
-	UnloadTexture(srcT);
-	UnloadTexture(dstT);
-	if (mask) UnloadTexture(*mask);
-	UnloadRenderTexture(canvas);
+    dst->end();
 }
 
 void CopyImage_GPU(
 	const Orbit::InvbCopyPixelsShader *shader, 
-	const Image *src, 
-	Image *dst, 
+	Canvas *src, 
+	Canvas *dst, 
 	const Orbit::Lua::Rect *from, 
 	const Orbit::Lua::Quad *to, 
-	const CopyImageParams &params
+	const CopyImageParams &params,
+	Atlas *atlas
 ) {
-	auto srcT = LoadTextureFromImage(*src);
-	auto dstT = LoadTextureFromImage(*dst);
-	Texture2D *mask = nullptr;
-	auto canvas = LoadRenderTexture(dstT.width, dstT.height);
+	bool feedback = params.samples_destination() || src == dst || params.mask == dst;
+
+	auto source = atlas ? atlas->view(*src) : TextureView{ src->texture(), Rectangle{0, 0, 1, 1} };
+	auto srcT = source.texture;
+	auto dstT = dst->texture();
+	Texture2D mask;
 	auto srcRect = Rectangle{from->_left, from->_top, from->width(), from->height()};
 
-    if (params.mask) *mask = LoadTextureFromImage(*params.mask);
+    if (params.mask) mask = params.mask->texture();
 		
-    BeginTextureMode(canvas);
-    DrawTexture(dstT, 0, 0, WHITE);
+    dst->begin(feedback);
     
     BeginShaderMode(shader->shader);
     shader->prepare(
         srcT, 
-        dstT,
+        feedback ? dstT : srcT,
 		srcRect,
 		to->vertices,
         params.color != std::nullopt, 
         static_cast<int>(params.ink), 
         params.blend,
-        false,
-        mask
+        true,
+        params.mask ? &mask : nullptr,
+        source.region
     );
 	Orbit::RlExt::DrawTexture(&srcT, &srcRect, to->vertices, params.color.value_or(WHITE));
     EndShaderMode();
-    EndTextureMode();
 
-    UnloadImage(*dst);
-	*dst = LoadImageFromTexture(canvas.texture);
-	ImageFlipVertical(dst);
-
-	UnloadTexture(srcT);
-	UnloadTexture(dstT);
-	if (mask) UnloadTexture(*mask);
-	UnloadRenderTexture(canvas);
+    dst->end();
 }
 
 };
@@ -487,24 +523,26 @@ void LuaRuntime::_register_image() {
 	lua_pushcfunction(L, image_concat);
 	lua_setfield(L, -2, "__concat");
 
-	lua_pushlightuserdata(L, this);
-	lua_pushcclosure(L, image_index, 1);
-	lua_setfield(L, -2, "__index");
-
 	lua_pushcfunction(L, image_eq);
 	lua_setfield(L, -2, "__eq");
 
 	lua_pushcfunction(L, image_gc);
 	lua_setfield(L, -2, "__gc");
 
-    lua_pushlightuserdata(L, this);
-	lua_pushcclosure(L, image_make_silhouette, 1);
-	lua_setglobal(L, "silhouette");
-
+	// Made once, and shared by the globals and the methods of every image
 	lua_pushlightuserdata(L, this);
 	lua_pushcclosure(L, image_copy_pixels, 1);
+	lua_pushvalue(L, -1);
 	lua_setglobal(L, "copyPixels");
 
+	lua_pushlightuserdata(L, this);
+	lua_pushcclosure(L, image_make_silhouette, 1);
+	lua_pushvalue(L, -1);
+	lua_setglobal(L, "silhouette");
+
+	lua_pushcclosure(L, image_index, 2);
+	lua_setfield(L, -2, "__index");
+
 	lua_pop(L, 1);
 
 }
@@ -7,6 +7,7 @@
 #ifdef _WIN32
 
 #include <windows.h>
+#include <stdexcept>
 
 namespace Orbit {
 
@@ -26,6 +27,74 @@ size_t get_path_max_len() {
     return MAX_PATH;
 }
 
+void MappedFile::_unmap() {
+    if (_data != nullptr) UnmapViewOfFile(_data);
+    if (_mapping != nullptr) CloseHandle(_mapping);
+    if (_file != INVALID_HANDLE_VALUE) CloseHandle(_file);
+
+    _data = nullptr;
+    _mapping = nullptr;
+    _file = INVALID_HANDLE_VALUE;
+    _size = 0;
+}
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept {
+    if (this == &other) return *this;
+
+    _unmap();
+
+    _data = other._data;
+    _size = other._size;
+    _file = other._file;
+    _mapping = other._mapping;
+
+    other._data = nullptr;
+    other._size = 0;
+    other._file = INVALID_HANDLE_VALUE;
+    other._mapping = nullptr;
+
+    return *this;
+}
+
+MappedFile::MappedFile(MappedFile &&other) noexcept : 
+    _data(other._data), _size(other._size), _file(other._file), _mapping(other._mapping) {
+    other._data = nullptr;
+    other._size = 0;
+    other._file = INVALID_HANDLE_VALUE;
+    other._mapping = nullptr;
+}
+
+MappedFile::MappedFile(const std::filesystem::path &path) : 
+    _data(nullptr), _size(0), _file(INVALID_HANDLE_VALUE), _mapping(nullptr) {
+    _file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+    if (_file == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("failed to open " + path.string());
+    }
+
+    LARGE_INTEGER size;
+    
+    if (!GetFileSizeEx(_file, &size)) {
+        _unmap();
+        throw std::runtime_error("failed to read the size of " + path.string());
+    }
+
+    // Empty files can't be mapped
+    if (size.QuadPart == 0) return;
+
+    _mapping = CreateFileMappingW(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (_mapping != nullptr) _data = static_cast<const char *>(MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0));
+
+    if (_data == nullptr) {
+        _unmap();
+        throw std::runtime_error("failed to map " + path.string());
+    }
+
+    _size = static_cast<size_t>(size.QuadPart);
+}
+
+MappedFile::~MappedFile() { _unmap(); }
+
 };
 
 #else
@@ -36,6 +105,9 @@ size_t get_path_max_len() {
 #include <vector>
 #include <limits.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 namespace Orbit {
 
@@ -53,6 +125,65 @@ size_t get_path_max_len() {
     return PATH_MAX;
 }
 
+void MappedFile::_unmap() {
+    if (_data != nullptr) munmap(const_cast<char *>(_data), _size);
+
+    _data = nullptr;
+    _size = 0;
+}
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept {
+    if (this == &other) return *this;
+
+    _unmap();
+
+    _data = other._data;
+    _size = other._size;
+
+    other._data = nullptr;
+    other._size = 0;
+
+    return *this;
+}
+
+MappedFile::MappedFile(MappedFile &&other) noexcept : _data(other._data), _size(other._size) {
+    other._data = nullptr;
+    other._size = 0;
+}
+
+MappedFile::MappedFile(const std::filesystem::path &path) : _data(nullptr), _size(0) {
+    int fd = open(path.c_str(), O_RDONLY);
+
+    if (fd == -1) {
+        throw std::runtime_error("failed to open " + path.string());
+    }
+
+    struct stat info;
+
+    if (fstat(fd, &info) == -1) {
+        close(fd);
+        throw std::runtime_error("failed to read the size of " + path.string());
+    }
+
+    // Empty files can't be mapped
+    if (info.st_size == 0) {
+        close(fd);
+        return;
+    }
+
+    void *mapped = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (mapped == MAP_FAILED) {
+        throw std::runtime_error("failed to map " + path.string());
+    }
+
+    _data = static_cast<const char *>(mapped);
+    _size = static_cast<size_t>(info.st_size);
+}
+
+MappedFile::~MappedFile() { _unmap(); }
+
 };
 
 #endif
\ No newline at end of file
@@ -1,7 +1,10 @@
 #include <Orbit/Lua/runtime.h>
+#include <Orbit/RlExt/canvas.h>
+#include <Orbit/profiler.h>
 
 #include <unordered_map>
 #include <cstring>
+#include <new>
 #include <iostream>
 #include <sstream>
 #include <fstream>
@@ -20,6 +23,8 @@ using std::unordered_map;
 using std::stringstream;
 using std::string;
 
+using Orbit::RlExt::Canvas;
+
 int concat(lua_State *L) {
 	string a = luaL_tolstring(L, 1, nullptr);
 	string b = luaL_tolstring(L, 2, nullptr);
@@ -50,7 +55,144 @@ int member_tostring(lua_State *L) {
     return 1;
 }
 
+// __index of a cast member table: the image and the text are served by the cast cache.
+// The dimensions come from the cast index, so they never require decoding.
+int castmember_field(lua_State *L) {
+    const char *field = luaL_checkstring(L, 2);
+
+    auto* runtime = static_cast<Orbit::Lua::LuaRuntime*>(lua_touserdata(L, lua_upvalueindex(1)));
+    auto* member = static_cast<const Orbit::Lua::CastMember*>(lua_touserdata(L, lua_upvalueindex(2)));
+
+    if (std::strcmp(field, "image") == 0 && member->path.extension() == ".png") {
+        const auto mark = Orbit::profiler.open("member.image");
+        runtime->cast_cache.push_image(L, *member);
+        Orbit::profiler.close(mark);
+    }
+    else if (std::strcmp(field, "width") == 0 && member->path.extension() == ".png") {
+        lua_pushinteger(L, member->width);
+    }
+    else if (std::strcmp(field, "height") == 0 && member->path.extension() == ".png") {
+        lua_pushinteger(L, member->height);
+    }
+    else if (std::strcmp(field, "text") == 0 && member->path.extension() == ".txt") {
+        const auto mark = Orbit::profiler.open("member.text");
+
+        try {
+            runtime->cast_cache.push_text(L, *member);
+        } catch (const std::exception &e) {
+            runtime->logger->error("[runtime] {}", e.what());
+            lua_pushnil(L);
+        }
+
+        Orbit::profiler.close(mark);
+    }
+    else lua_pushnil(L);
+
+    return 1;
+}
+
+// importFileInto of a cast member table: replaces the text or the image of the member.
+int member_import_file_into(lua_State *L) {
+    luaL_checktype(L, 1, LUA_TTABLE);
+    const char *p = luaL_checkstring(L, 2);
+
+    auto* runtime = static_cast<Orbit::Lua::LuaRuntime*>(lua_touserdata(L, lua_upvalueindex(1)));
+    
+    auto path = runtime->paths->data() / p;
+
+    if (!std::filesystem::exists(path)) return 0;
+
+    if (path.extension() == ".txt") {
+        std::ifstream file(path);
+        if (!file) {
+            runtime->logger->error("[runtime] failed to open cast member file {}", path.string());
+            return 0;
+        }
+
+        stringstream buffer;
+        buffer << file.rdbuf();
+        auto str = buffer.str();
+
+        lua_pushlstring(L, str.data(), str.size());
+        lua_setfield(L, 1, "text");
+    }
+    else if (path.extension() == ".png") {
+        Image loaded = LoadImage(path.string().c_str());
+        if (loaded.data == nullptr) return 0;
+
+        Canvas *image = static_cast<Canvas *>(lua_newuserdata(L, sizeof(Canvas)));
+        new (image) Canvas(loaded);
+
+        luaL_getmetatable(L, "image");
+        lua_setmetatable(L, -2);
+
+        // Shadows the cached image from now on
+        lua_setfield(L, 1, "image");
+    }
+
+    return 0;
+}
+
+// The registry table holding the member tables, keyed by CastMember
+static const char MEMBER_TABLES = 0;
+
+// Pushes the table of a cast member.
+//
+// Tables are created once and kept in the registry, so every lookup of
+// a member returns the same table.
+void push_member(lua_State *L, Orbit::Lua::LuaRuntime *runtime, const Orbit::Lua::CastMember *member) {
+    if (lua_rawgetp(L, LUA_REGISTRYINDEX, &MEMBER_TABLES) == LUA_TNIL) {
+        lua_pop(L, 1);
+        lua_newtable(L);
+        lua_pushvalue(L, -1);
+        lua_rawsetp(L, LUA_REGISTRYINDEX, &MEMBER_TABLES);
+    }
+
+    if (lua_rawgetp(L, -1, member) != LUA_TNIL) {
+        lua_remove(L, -2);
+        return;
+    }
+
+    lua_pop(L, 1);
+
+    lua_newtable(L);
+
+    lua_pushstring(L, member->name.c_str());
+    lua_setfield(L, -2, "name");
+
+    lua_pushinteger(L, member->id);
+    lua_setfield(L, -2, "number");
+
+    lua_pushstring(L, member->path.string().c_str());
+    lua_setfield(L, -2, "path");
+
+    lua_pushlightuserdata(L, runtime);
+    lua_pushcclosure(L, member_import_file_into, 1);
+    lua_setfield(L, -2, "importFileInto");
+
+    lua_newtable(L);
+
+    lua_pushlightuserdata(L, runtime);
+    lua_pushlightuserdata(L, const_cast<Orbit::Lua::CastMember *>(member));
+    lua_pushcclosure(L, castmember_field, 2);
+    lua_setfield(L, -2, "__index");
+
+    lua_pushcfunction(L, member_tostring);
+    lua_setfield(L, -2, "__tostring");
+
+    lua_pushcfunction(L, concat);
+    lua_setfield(L, -2, "__concat");
+
+    lua_setmetatable(L, -2);
+
+    lua_pushvalue(L, -1);
+    lua_rawsetp(L, -3, member);
+    lua_remove(L, -2);
+}
+
 int member_lookup(lua_State *L) {
+    const auto mark = Orbit::profiler.open("member");
+
     int args = lua_gettop(L);
     
     auto* runtime = static_cast<Orbit::Lua::LuaRuntime*>(lua_touserdata(L, lua_upvalueindex(1)));
@@ -130,104 +272,97 @@ int member_lookup(lua_State *L) {
         }
     }
 
-    if (member) {
-        auto path = member->path.string();
+    if (member) push_member(L, runtime, member);
+    else lua_pushnil(L);
 
-        lua_newtable(L);
+    Orbit::profiler.close(mark);
+    return 1;
+}
 
-        lua_pushstring(L, "number");
-        lua_pushinteger(L, member->id);
-        lua_settable(L, -3);
+// __index of a library's member table
+int castlib_member(lua_State *L) {
+    const auto mark = Orbit::profiler.open("castLib.member");
 
-        lua_pushstring(L, "name");
-        lua_pushstring(L, member->name.c_str());
-        lua_settable(L, -3);
-        
-        lua_pushstring(L, "path");
-        lua_pushstring(L, path.c_str());
-        lua_settable(L, -3);
+    auto* runtime = static_cast<Orbit::Lua::LuaRuntime*>(lua_touserdata(L, lua_upvalueindex(1)));
+    auto* lib = static_cast<Orbit::Lua::CastLib*>(lua_touserdata(L, lua_upvalueindex(2)));
 
-        lua_pushlightuserdata(L, runtime);
-        lua_pushcclosure(L, [](lua_State *L2) {
-            const char *p = lua_tostring(L2, 2);
-            auto* runtime = static_cast<Orbit::Lua::LuaRuntime*>(lua_touserdata(L2, lua_upvalueindex(1)));
-            
-            auto path = runtime->paths->data() / p;
+    Orbit::Lua::CastMember *member = nullptr;
 
-            if (!std::filesystem::exists(path)) return 0;
+    if (lua_isinteger(L, 2)) {
+        member = lib->find(static_cast<int>(lua_tointeger(L, 2))).get();
+    } else if (lua_isstring(L, 2)) {
+        auto found = lib->names().find(lua_tostring(L, 2));
+        if (found != lib->names().end()) member = found->second.get();
+    }
 
-            if (path.extension() == ".txt") {
-                std::ifstream file(path);
-                if (!file) {
-                    runtime->logger->error("[runtime] failed to open cast member file {FILE}", path.string());
-                    return 0;
-                }
+    if (member == nullptr) {
+        lua_pushnil(L);
 
-                stringstream buffer;
-                buffer << file.rdbuf();
-                auto str = buffer.str();
+        Orbit::profiler.close(mark);
+        return 1;
+    }
 
-                lua_pushstring(L2, str.c_str());
-                lua_setfield(L2, -3, "text");
-            }
-            else if (path.extension() == ".png") {
-                lua_getfield(L2, -2, "image");
-                
-                Image *image = static_cast<Image *>(luaL_testudata(L2, -1, "image"));
-                if (image) {
-                    UnloadImage(*image);
-                }
-                else {
-                    image = static_cast<Image *>(lua_newuserdata(L2, sizeof(Image)));
-                }
+    push_member(L, runtime, member);
 
-                *image = LoadImage(path.string().c_str());
+    lua_pushvalue(L, 2);
+    lua_pushvalue(L, -2);
+    lua_rawset(L, 1);
 
-                lua_pop(L2, -1);
-            }
+    Orbit::profiler.close(mark);
+    return 1;
+}
 
-            return 0;
-        }, 1);
-        lua_setfield(L, -2, "importFileInto");
+// __index of _movie.castLib, by library name or number
+int castlib_index(lua_State *L) {
+    auto* runtime = static_cast<Orbit::Lua::LuaRuntime*>(lua_touserdata(L, lua_upvalueindex(1)));
 
-        if (member->path.extension() == ".png") {
-            lua_pushstring(L, "image");
-            
-            Image *img = static_cast<Image *>(lua_newuserdata(L, sizeof(Image)));
-            *img = LoadImage(member->path.string().c_str());
-        
-            luaL_getmetatable(L, "image");
-            lua_setmetatable(L, -2);
+    std::shared_ptr<Orbit::Lua::CastLib> lib = nullptr;
 
-            lua_settable(L, -3);
-        }
-        else if (member->path.extension() == ".txt") {
-            std::ifstream file(member->path);
-            if (!file) {
-                runtime->logger->error("[runtime] failed to open cast member file {FILE}", member->path.string());
-                
-                lua_pushnil(L);
-                return 1;
-            }
+    if (lua_isinteger(L, 2)) {
+        auto index = lua_tointeger(L, 2);
+        if (index > 0 && index <= static_cast<lua_Integer>(runtime->castlibs().size())) lib = runtime->castlibs()[index - 1];
+    } else if (lua_isstring(L, 2)) {
+        auto found = runtime->castlib_names().find(lua_tostring(L, 2));
+        if (found != runtime->castlib_names().end()) lib = found->second;
+    }
 
-            stringstream buffer;
-            buffer << file.rdbuf();
-            auto text = buffer.str();
+    if (lib == nullptr) {
+        lua_pushnil(L);
+        return 1;
+    }
 
-            lua_pushstring(L, "text");
-            lua_pushstring(L, text.c_str());
-            lua_settable(L, -3);
-        }
+    // the same library may be asked for by name and by number
+    lua_pushstring(L, lib->name().c_str());
+    lua_rawget(L, 1);
+
+    if (lua_isnil(L, -1)) {
+        lua_pop(L, 1);
 
         lua_newtable(L);
-        lua_pushcfunction(L, member_tostring);
-        lua_setfield(L, -2, "__tostring");
 
-        lua_pushcfunction(L, concat);
-        lua_setfield(L, -2, "__concat");
+        lua_pushstring(L, lib->name().c_str());
+        lua_setfield(L, -2, "name");
+
+        lua_pushinteger(L, lib->offset());
+        lua_setfield(L, -2, "number");
+
+        lua_newtable(L);
+        lua_newtable(L);
+        lua_pushlightuserdata(L, runtime);
+        lua_pushlightuserdata(L, lib.get());
+        lua_pushcclosure(L, castlib_member, 2);
+        lua_setfield(L, -2, "__index");
         lua_setmetatable(L, -2);
+        lua_setfield(L, -2, "member");
+
+        lua_pushstring(L, lib->name().c_str());
+        lua_pushvalue(L, -2);
+        lua_rawset(L, 1);
     }
-    else lua_pushnil(L);
+
+    lua_pushvalue(L, 2);
+    lua_pushvalue(L, -2);
+    lua_rawset(L, 1);
 
     return 1;
 }
@@ -416,87 +551,13 @@ void LuaRuntime::_register_lingo_api() {
     }
 
     { // castLib
+        // Libraries, members and their images are only looked up when a script asks for them.
         lua_pushstring(L, "castLib");
         lua_newtable(L);
 
-        for (const auto &lib : _castlibs) {
-            lua_pushstring(L, lib->name().c_str());
-            lua_newtable(L);
-
-            lua_pushstring(L, lib->name().c_str());
-            lua_pushstring(L,"name");
-            lua_settable(L, -3);
-            
-            lua_pushinteger(L, lib->offset());
-            lua_pushstring(L, "number");
-            lua_settable(L, -3);
-
-            lua_pushstring(L, "member");
-            lua_newtable(L);
-            for (const auto &mem : lib->members()) {
-                lua_pushstring(L, mem->name.c_str());
-                lua_newtable(L);
-                
-                lua_pushstring(L, "name");
-                lua_pushstring(L, mem->name.c_str());
-                lua_settable(L, -3);
-                
-                lua_pushstring(L, "number");
-                lua_pushinteger(L, mem->id);
-                lua_settable(L, -3);
-
-                if (mem->path.extension() == ".png") {
-                    lua_pushstring(L, "image");
-
-                    Image *nimg = static_cast<Image *>(lua_newuserdata(L, sizeof(Image)));
-                    *nimg = LoadImage(mem->path.string().c_str());
-
-                    luaL_getmetatable(L, "image");
-                    lua_setmetatable(L, -2);
-
-                    lua_settable(L, -3);
-                }
-                else if (mem->path.extension() == ".txt") {
-                    std::ifstream file(mem->path);
-                    if (!file) {
-                        throw std::runtime_error("failed to load member file: " + mem->path.string());
-                    }
-
-                    std::stringstream buffer;
-                    buffer << file.rdbuf();
-                    auto text = buffer.str();
-
-                    lua_pushstring(L, "text");
-                    lua_pushstring(L, text.c_str());
-                    lua_settable(L, -3);
-                }
-
-                lua_settable(L, -3);
-            }
-            lua_settable(L, -3);            
-            lua_settable(L, -3);            
-        }
-
         lua_newtable(L);
         lua_pushlightuserdata(L, this);
-        lua_pushcclosure(L, [](lua_State *L){
-            const char *castLibName = luaL_checkstring(L, 2);
-
-            auto* runtime = static_cast<LuaRuntime *>(lua_touserdata(L, lua_upvalueindex(1)));
-
-            auto found = runtime->castlib_names().find(castLibName);
-            
-            if (found == runtime->castlib_names().end()) {
-                lua_pushnil(L);
-                return 1;
-            }
-
-            auto &lib = found->second;
-
-
-
-            return 1;
-        }, 1);
+        lua_pushcclosure(L, castlib_index, 1);
         lua_setfield(L, -2, "__index");
         lua_setmetatable(L, -2);
 
@@ -513,7 +574,8 @@ void LuaRuntime::_register_lingo_api() {
     lua_pushcfunction(L, concat);
     lua_setfield(L, -2, "__concat");
 
-    lua_pushcfunction(L, [](lua_State *L) {
+    lua_pushlightuserdata(L, this);
+    lua_pushcclosure(L, [](lua_State *L) {
         const char *field = luaL_checkstring(L, 2);
         
         if (std::strcmp(field, "frame") == 0) {
@@ -522,9 +584,17 @@ void LuaRuntime::_register_lingo_api() {
         else if (std::strcmp(field, "go") == 0) {
             lua_pushcfunction(L, [](lua_State *L) { return 0; });
         }
+        else if (std::strcmp(field, "halt") == 0) {
+            lua_pushvalue(L, lua_upvalueindex(1));
+            lua_pushcclosure(L, [](lua_State *L) {
+                auto* runtime = static_cast<LuaRuntime *>(lua_touserdata(L, lua_upvalueindex(1)));
+                runtime->halt();
+                return 0;
+            }, 1);
+        }
         else lua_pushnil(L);
         return 1;
-    });
+    }, 1);
     lua_setfield(L, -2, "__index");
 
     lua_setmetatable(L, -2);
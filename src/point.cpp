@@ -5,6 +5,7 @@
 #include <math.h>
 
 #include <Orbit/Lua/runtime.h>
+#include <Orbit/Lua/fields.h>
 
 #include <raylib.h>
 #include <raymath.h>
@@ -17,6 +18,8 @@ extern "C" {
 
 namespace Orbit::Lua {
 
+static constexpr auto FIELDS = fields("x", "y");
+
 void LuaRuntime::_register_point() {
 	const auto make = [](lua_State *L) {
 		float x = luaL_checknumber(L, 1);
@@ -35,11 +38,12 @@ void LuaRuntime::_register_point() {
 
 	const auto read = [](lua_State *L) {
 		Vector2 *p = static_cast<Vector2 *>(luaL_checkudata(L, 1, "point"));
-		const char *field = luaL_checkstring(L, 2);
 
-		if (std::strcmp(field, "x") == 0) lua_pushnumber(L, p->x);
-		else if (std::strcmp(field, "y") == 0) lua_pushnumber(L, p->y);
-		else lua_pushnil(L);
+		switch (FIELDS.find(L, 2)) {
+			case FIELDS["x"]: lua_pushnumber(L, p->x); break;
+			case FIELDS["y"]: lua_pushnumber(L, p->y); break;
+			default: lua_pushnil(L);
+		}
 
 		return 1;
 	};
@@ -47,12 +51,14 @@ void LuaRuntime::_register_point() {
 	const auto write = [](lua_State *L) {
 		Vector2 *p = static_cast<Vector2 *>(luaL_checkudata(L, 1, "point"));
 
-		const char *field = luaL_checkstring(L, 2);
+		const int field = FIELDS.find(L, 2);
 		float value = luaL_checknumber(L, 3);
 
-		if (std::strcmp(field, "x") == 0) p->x = value;
-		else if (std::strcmp(field, "y") == 0) p->y = value;
-		else luaL_error(L, "invalid field '%s' in point", field);
+		switch (field) {
+			case FIELDS["x"]: p->x = value; break;
+			case FIELDS["y"]: p->y = value; break;
+			default: luaL_error(L, "invalid field '%s' in point", lua_tostring(L, 2));
+		}
 
 		return 0;
 	};
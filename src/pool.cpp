@@ -0,0 +1,119 @@
+#include <Orbit/Lua/pool.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+namespace Orbit::Lua {
+
+void *Pool::_carve(size_t size_class) {
+	const size_t size = (size_class + 1) * GRANULE;
+
+	if (static_cast<size_t>(_end - _cursor) < size) {
+		// The rest of the last slab is too small, and is left unused
+		char *slab = static_cast<char *>(std::malloc(SLAB_SIZE));
+		if (slab == nullptr) return nullptr;
+
+		_slabs.push_back(slab);
+		_cursor = slab;
+		_end = slab + SLAB_SIZE;
+	}
+
+	void *block = _cursor;
+	_cursor += size;
+
+	return block;
+}
+
+void *Pool::allocate(size_t size) {
+	if (size > MAX_SIZE) return std::malloc(size);
+
+	const auto size_class = _class(size);
+	Slot *slot = _free[size_class];
+
+	if (slot == nullptr) return _carve(size_class);
+
+	_free[size_class] = slot->next;
+	return slot;
+}
+
+void Pool::deallocate(void *block, size_t size) {
+	if (block == nullptr) return;
+
+	if (size > MAX_SIZE) {
+		std::free(block);
+		return;
+	}
+
+	const auto size_class = _class(size);
+	Slot *slot = static_cast<Slot *>(block);
+
+	slot->next = _free[size_class];
+	_free[size_class] = slot;
+}
+
+void *Pool::reallocate(void *block, size_t old_size, size_t new_size) {
+	if (block == nullptr) return allocate(new_size);
+
+	if (new_size == 0) {
+		deallocate(block, old_size);
+		return nullptr;
+	}
+
+	if (old_size > MAX_SIZE && new_size > MAX_SIZE) return std::realloc(block, new_size);
+	if (old_size <= MAX_SIZE && new_size <= MAX_SIZE && _class(old_size) == _class(new_size)) return block;
+
+	void *moved = allocate(new_size);
+	if (moved == nullptr) return nullptr;
+
+	std::memcpy(moved, block, std::min(old_size, new_size));
+	deallocate(block, old_size);
+
+	return moved;
+}
+
+void Pool::_count(void *block, size_t old_size, size_t new_size) {
+	// Without a block, the old size is the type of the object to be made
+	if (block == nullptr) old_size = 0;
+
+	if (new_size == 0) {
+		if (block != nullptr) stats.frees++;
+	} else if (block == nullptr) {
+		stats.allocations++;
+	}
+
+	if (new_size > old_size) stats.bytes += new_size - old_size;
+
+	_in_use = _in_use + new_size - old_size;
+}
+
+void *Pool::lua_alloc(void *pool, void *block, size_t old_size, size_t new_size) {
+	auto *self = static_cast<Pool *>(pool);
+
+	self->_count(block, old_size, new_size);
+
+	if (block == nullptr) return new_size == 0 ? nullptr : self->allocate(new_size);
+
+	return self->reallocate(block, old_size, new_size);
+}
+
+void *Pool::lua_system_alloc(void *pool, void *block, size_t old_size, size_t new_size) {
+	static_cast<Pool *>(pool)->_count(block, old_size, new_size);
+
+	if (new_size == 0) {
+		std::free(block);
+		return nullptr;
+	}
+
+	return std::realloc(block, new_size);
+}
+
+Pool::Pool() : stats({}), _free({}), _slabs({}), _cursor(nullptr), _end(nullptr), _in_use(0) {
+	_slabs.reserve(64);
+}
+
+Pool::~Pool() {
+	for (auto *slab : _slabs) std::free(slab);
+}
+
+};
@@ -0,0 +1,154 @@
+#include <Orbit/profiler.h>
+
+#include <cstdio>
+#include <fstream>
+#include <algorithm>
+
+#include <raylib.h>
+
+namespace Orbit {
+
+Profiler profiler;
+
+void Profiler::_record(const char *name, int64_t start, int64_t end) {
+	const double seconds = (end - start) / 1e9;
+
+	auto &totals = _scopes[name];
+	totals.seconds += seconds;
+	totals.calls++;
+
+	// Nested scopes are already part of the outer one
+	if (_depth == 0) _native += seconds;
+
+	if (_events.size() < MAX_EVENTS) _events.push_back(Event{ name, start, end - start });
+	else _dropped++;
+}
+
+void Profiler::enable() {
+	if (_enabled) return;
+
+	_enabled = true;
+	_origin = clock::now();
+	_events.reserve(MAX_EVENTS / 16);
+}
+
+void Profiler::begin_frame(const char *name) {
+	if (!_enabled) return;
+
+	_depth = 0;
+	_frame_name = name;
+	_frame_start = _now();
+	_native = 0;
+	_transfers = {};
+	_scopes.clear();
+}
+
+void Profiler::end_frame() {
+	if (!_enabled || _frame_name == nullptr) return;
+
+	const auto end = _now();
+
+	_last.name = _frame_name;
+	_last.seconds = (end - _frame_start) / 1e9;
+	_last.native = _native;
+	_last.transfers = _transfers;
+	_last.scopes.assign(_scopes.begin(), _scopes.end());
+
+	std::sort(_last.scopes.begin(), _last.scopes.end(), [](const auto &a, const auto &b) {
+		return a.second.seconds > b.second.seconds;
+	});
+
+	if (_events.size() < MAX_EVENTS) _events.push_back(Event{ _frame_name, _frame_start, end - _frame_start });
+	else _dropped++;
+
+	_samples.push_back(Sample{ _frame_start, _transfers });
+
+	// Scopes cut short by an error that wasn't caught by a script never closed
+	_depth = 0;
+	_frame_name = nullptr;
+}
+
+void Profiler::draw_overlay() const {
+	if (!_enabled || !overlay || _last.name == nullptr) return;
+
+	constexpr int SIZE = 10, LINE = 12, MAX_SCOPES = 12;
+
+	const int lines = 2 + static_cast<int>(std::min<size_t>(_last.scopes.size(), MAX_SCOPES));
+	DrawRectangle(0, 0, 330, 8 + lines * LINE, Color{ 0, 0, 0, 180 });
+
+	char text[128];
+	int y = 4;
+
+	std::snprintf(
+		text, sizeof(text), "%s: %.2f ms (lua %.2f ms, native %.2f ms)",
+		_last.name, _last.seconds * 1e3, (_last.seconds - _last.native) * 1e3, _last.native * 1e3
+	);
+	DrawText(text, 4, y, SIZE, WHITE);
+	y += LINE;
+
+	const auto &t = _last.transfers;
+	std::snprintf(
+		text, sizeof(text), "uploads: %zu (%.1f KB), readbacks: %zu (%.1f KB)",
+		t.uploads, t.upload_bytes / 1024.0, t.readbacks, t.readback_bytes / 1024.0
+	);
+	DrawText(text, 4, y, SIZE, WHITE);
+	y += LINE;
+
+	for (int i = 0; i < lines - 2; i++) {
+		const auto &[name, totals] = _last.scopes[i];
+
+		std::snprintf(
+			text, sizeof(text), "%.*s: %.2f ms, %zu calls",
+			static_cast<int>(name.size()), name.data(), totals.seconds * 1e3, totals.calls
+		);
+		DrawText(text, 12, y, SIZE, LIGHTGRAY);
+		y += LINE;
+	}
+}
+
+void Profiler::write_trace(const std::filesystem::path &file) const {
+	std::ofstream out(file);
+	if (!out) return;
+
+	out << "{\"traceEvents\":[\n";
+
+	bool first = true;
+	char line[256];
+
+	for (const auto &e : _events) {
+		std::snprintf(
+			line, sizeof(line), "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f}",
+			first ? "" : ",\n", e.name, e.start / 1e3, e.duration / 1e3
+		);
+		out << line;
+		first = false;
+	}
+
+	for (const auto &s : _samples) {
+		std::snprintf(
+			line, sizeof(line), "%s{\"name\":\"transfers\",\"ph\":\"C\",\"pid\":1,\"ts\":%.3f,\"args\":{\"upload bytes\":%zu,\"readback bytes\":%zu}}",
+			first ? "" : ",\n", s.time / 1e3, s.transfers.upload_bytes, s.transfers.readback_bytes
+		);
+		out << line;
+		first = false;
+	}
+
+	out << "\n],\"displayTimeUnit\":\"ms\",\"otherData\":{\"dropped events\":" << _dropped << "}}\n";
+}
+
+Profiler::Profiler() :
+	_enabled(false),
+	_origin(),
+	_depth(0),
+	_frame_name(nullptr),
+	_frame_start(0),
+	_native(0),
+	_transfers({}),
+	_scopes({}),
+	_last({}),
+	_events({}),
+	_samples({}),
+	_dropped(0),
+	overlay(false) {}
+
+};
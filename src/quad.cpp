@@ -6,6 +6,8 @@
 
 #include <Orbit/Lua/runtime.h>
 #include <Orbit/Lua/quad.h>
+#include <Orbit/Lua/userdata.h>
+#include <Orbit/Lua/fields.h>
 
 #include <xsimd/xsimd.hpp>
 #include <xsimd/config/xsimd_config.hpp>
@@ -20,6 +22,8 @@ extern "C" {
     #include <lualib.h>
 }
 
+static constexpr auto FIELDS = Orbit::Lua::fields("topleft", "topright", "bottomright", "bottomleft");
+
 inline Vector2 rotate_vector(Vector2 v, float degrees, Vector2 p) {
 	float rad = fmodf(degrees, 360.0f) * PI / 180.0f;
 
@@ -333,30 +337,19 @@ void LuaRuntime::_register_quad() {
 	};
 
 	const auto read = [](lua_State *L) {
-		Quad *q = *static_cast<Quad **>(luaL_checkudata(L, 1, "quad"));
-		const char *field = luaL_checkstring(L, 2);
-
-		if (std::strcmp(field, "topleft") == 0) {
-			Vector2 *p = static_cast<Vector2 *>(lua_newuserdata(L, sizeof(Vector2)));
-			*p = q->topleft;
-			luaL_getmetatable(L, "point");
-			lua_setmetatable(L, -2);
+		Quad *q = check_value<Quad>(L, 1, "quad");
+		const Vector2 *corner = nullptr;
+
+		switch (FIELDS.find(L, 2)) {
+			case FIELDS["topleft"]: corner = &q->topleft; break;
+			case FIELDS["topright"]: corner = &q->topright; break;
+			case FIELDS["bottomright"]: corner = &q->bottomright; break;
+			case FIELDS["bottomleft"]: corner = &q->bottomleft; break;
 		}
-		else if (std::strcmp(field, "topright") == 0) {
-			Vector2 *p = static_cast<Vector2 *>(lua_newuserdata(L, sizeof(Vector2)));
-			*p = q->topright;
-			luaL_getmetatable(L, "point");
-			lua_setmetatable(L, -2);
-		}
-		else if (std::strcmp(field, "bottomright") == 0) {
-			Vector2 *p = static_cast<Vector2 *>(lua_newuserdata(L, sizeof(Vector2)));
-			*p = q->bottomright;
-			luaL_getmetatable(L, "point");
-			lua_setmetatable(L, -2);
-		}
-		else if (std::strcmp(field, "bottomleft") == 0) {
+
+		if (corner != nullptr) {
 			Vector2 *p = static_cast<Vector2 *>(lua_newuserdata(L, sizeof(Vector2)));
-			*p = q->bottomleft;
+			*p = *corner;
 			luaL_getmetatable(L, "point");
 			lua_setmetatable(L, -2);
 		}
@@ -366,51 +359,30 @@ void LuaRuntime::_register_quad() {
 	};
 
 	const auto write = [](lua_State *L) {
-		Quad *q = *static_cast<Quad **>(luaL_checkudata(L, 1, "quad"));
+		Quad *q = check_value<Quad>(L, 1, "quad");
 
-		const char *field = luaL_checkstring(L, 2);
+		const int field = FIELDS.find(L, 2);
 		Vector2 *value = static_cast<Vector2 *>(luaL_checkudata(L, 3, "point"));
 
-		
-		if (std::strcmp(field, "topleft") == 0) {
-			q->topleft = *value;
-		}
-		else if (std::strcmp(field, "topright") == 0) {
-			q->topright = *value;
+		switch (field) {
+			case FIELDS["topleft"]: q->topleft = *value; break;
+			case FIELDS["topright"]: q->topright = *value; break;
+			case FIELDS["bottomright"]: q->bottomright = *value; break;
+			case FIELDS["bottomleft"]: q->bottomleft = *value; break;
+			default: return luaL_error(L, "invalid field '%s' on quad", lua_tostring(L, 2));
 		}
-		else if (std::strcmp(field, "bottomright") == 0) {
-			q->bottomright = *value;	
-		}
-		else if (std::strcmp(field, "bottomleft") == 0) {
-			q->bottomleft = *value;	
-		}
-		else return luaL_error(L, "invalid field '%s' on quad", field);		
 
 		return 0;
 	};
 
 	const auto add = [](lua_State *L) {
-		Quad a = **static_cast<Quad **>(luaL_checkudata(L, 1, "quad"));
+		const Quad *a = check_value<Quad>(L, 1, "quad");
 		void *rhs = nullptr;
 
 		if ((rhs = luaL_testudata(L, 2, "quad")) != nullptr) {
-			Quad b = **static_cast<Quad **>(rhs);
-	
-			Quad **res = static_cast<Quad **>(lua_newuserdata(L, sizeof(Quad *)));
-	
-			*res = new Quad(a + b);
-	
-			luaL_getmetatable(L, "quad");
-			lua_setmetatable(L, -2);
+			push_value(L, *a + *userdata_value<Quad>(rhs), "quad");
 		} else if ((rhs = luaL_testudata(L, 2, "point")) != nullptr) {
-			Vector2 b = *static_cast<Vector2 *>(rhs);
-	
-			Quad **res = static_cast<Quad **>(lua_newuserdata(L, sizeof(Quad *)));
-	
-			*res = new Quad(a + b);
-	
-			luaL_getmetatable(L, "quad");
-			lua_setmetatable(L, -2);
+			push_value(L, *a + *static_cast<Vector2 *>(rhs), "quad");
 		} else return luaL_error(L, "invalid right side operand");
 
 
@@ -418,63 +390,41 @@ void LuaRuntime::_register_quad() {
 	};
 
 	const auto subtract = [](lua_State *L) {
-		Quad a = **static_cast<Quad **>(luaL_checkudata(L, 1, "quad"));
+		const Quad *a = check_value<Quad>(L, 1, "quad");
 		void *rhs = nullptr;
 
 		if ((rhs = luaL_testudata(L, 2, "quad")) != nullptr) {
-			Quad b = **static_cast<Quad **>(rhs);
-	
-			Quad **res = static_cast<Quad **>(lua_newuserdata(L, sizeof(Quad *)));
-	
-			*res = new Quad(a - b);
-	
-			luaL_getmetatable(L, "quad");
-			lua_setmetatable(L, -2);
+			push_value(L, *a - *userdata_value<Quad>(rhs), "quad");
 		} else if ((rhs = luaL_testudata(L, 2, "point")) != nullptr) {
-			Vector2 b = *static_cast<Vector2 *>(rhs);
-	
-			Quad **res = static_cast<Quad **>(lua_newuserdata(L, sizeof(Quad *)));
-	
-			*res = new Quad(a - b);
-	
-			luaL_getmetatable(L, "quad");
-			lua_setmetatable(L, -2);
+			push_value(L, *a - *static_cast<Vector2 *>(rhs), "quad");
 		} else return luaL_error(L, "invalid right side operand");
 
 		return 1;
 	};
 
 	const auto multiply = [](lua_State *L) {
-		Quad a = **static_cast<Quad **>(luaL_checkudata(L, 1, "quad"));
+		const Quad *a = check_value<Quad>(L, 1, "quad");
 		float b = static_cast<float>(luaL_checknumber(L, 2));
 		
-		Quad **res = static_cast<Quad **>(lua_newuserdata(L, sizeof(Quad *)));
-		*res = new Quad(a * b);
-
-		luaL_getmetatable(L, "quad");
-		lua_setmetatable(L, -2);
+		push_value(L, *a * b, "quad");
 
 		return 1;
 	};
 	
 	const auto divide = [](lua_State *L) {
-		Quad a = **static_cast<Quad **>(luaL_checkudata(L, 1, "quad"));
+		const Quad *a = check_value<Quad>(L, 1, "quad");
 		float b = static_cast<float>(luaL_checknumber(L, 2));
 		
-		Quad **res = static_cast<Quad **>(lua_newuserdata(L, sizeof(Quad *)));
-		*res = new Quad(a / b);
-
-		luaL_getmetatable(L, "quad");
-		lua_setmetatable(L, -2);
+		push_value(L, *a / b, "quad");
 
 		return 1;
 	};
 
 	const auto equals = [](lua_State *L) {
-		Quad a = **static_cast<Quad **>(luaL_checkudata(L, 1, "quad"));
-		Quad b = **static_cast<Quad **>(luaL_checkudata(L, 2, "quad"));
+		const Quad *a = check_value<Quad>(L, 1, "quad");
+		const Quad *b = check_value<Quad>(L, 2, "quad");
 		
-		bool res = a == b;
+		bool res = *a == *b;
 
 		lua_pushboolean(L, res);
 
@@ -482,7 +432,7 @@ void LuaRuntime::_register_quad() {
 	};
 
 	const auto tostring = [](lua_State *L) {
-		Quad *a = *static_cast<Quad **>(luaL_checkudata(L, 1, "quad"));
+		Quad *a = check_value<Quad>(L, 1, "quad");
 		auto str = a->tostring();
 		lua_pushstring(L, str.c_str());
 		return 1;
@@ -525,14 +475,6 @@ void LuaRuntime::_register_quad() {
 	lua_pushcfunction(L, equals);
 	lua_setfield(L, -2, "__eq");
 
-	lua_pushcfunction(L, [](lua_State *L) {
-		Quad *ptr = *static_cast<Quad **>(lua_touserdata(L, 1));
-		delete ptr;
-
-		return 0;
-	});
-	lua_setfield(L, -2, "__gc");
-
 	lua_pop(L, 1);
 }
 
@@ -0,0 +1,54 @@
+#include <Orbit/Lua/reader.h>
+#include <Orbit/parallel.h>
+#include <Orbit/io.h>
+
+#include <string>
+#include <stdexcept>
+#include <string_view>
+
+#include <MobitParser/file.h>
+
+namespace Orbit::Lua {
+
+namespace {
+
+// The number of the line the position is on; a section can span several, when
+// a bracket or a string does.
+size_t line_of(const char *text, const char *position) {
+	size_t line = 1;
+
+	for (const char *c = text; c < position; c++) {
+		if (*c == '\n' || (*c == '\r' && (c + 1 == position || c[1] != '\n'))) line++;
+	}
+
+	return line;
+}
+
+};
+
+std::vector<mp::tree> read_lingo_file(const std::filesystem::path &path) {
+	const MappedFile file(path);
+	const auto sections = mp::split_sections(std::string_view(file.data(), file.size()));
+
+	std::vector<mp::tree> trees(sections.size());
+
+	// Kept per section rather than thrown, so the first invalid one is reported
+	// whichever thread gets to it first
+	std::vector<std::string> errors(sections.size());
+
+	parallel_for(sections.size(), [&](size_t i) {
+		try {
+			trees[i] = mp::parse(sections[i]);
+		} catch (const std::exception &e) {
+			errors[i] = e.what();
+		}
+	});
+
+	for (size_t i = 0; i < errors.size(); i++) {
+		if (!errors[i].empty()) throw std::runtime_error("line " + std::to_string(line_of(file.data(), sections[i].data())) + ": " + errors[i]);
+	}
+
+	return trees;
+}
+
+};
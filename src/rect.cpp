@@ -8,6 +8,8 @@
 
 #include <Orbit/Lua/runtime.h>
 #include <Orbit/Lua/rect.h>
+#include <Orbit/Lua/userdata.h>
+#include <Orbit/Lua/fields.h>
 
 #include <xsimd/xsimd.hpp>
 
@@ -19,8 +21,13 @@ extern "C" {
 
 #define META "rect"
 
+static constexpr auto FIELDS = Orbit::Lua::fields("left", "top", "right", "bottom", "width", "height", "pos");
+
 namespace Orbit::Lua {
 
+// The four components, without reading the padding that a full register would cover
+using lanes = xsimd::make_sized_batch_t<float, 4>;
+
 std::string Rect::tostring() const {
 	std::stringstream ss;
 
@@ -35,8 +42,8 @@ std::string Rect::tostring() const {
 }
 
 Rect Rect::operator+(Rect const &v) const {
-	auto ba = xsimd::load_aligned(_data);
-	auto bb = xsimd::load_aligned(v._data);
+	auto ba = lanes::load_aligned(_data);
+	auto bb = lanes::load_aligned(v._data);
 
 	auto res = ba + bb;
 
@@ -48,8 +55,8 @@ Rect Rect::operator+(Rect const &v) const {
 }
 
 Rect Rect::operator-(Rect const &v) const {
-	auto ba = xsimd::load_aligned(_data);
-	auto bb = xsimd::load_aligned(v._data);
+	auto ba = lanes::load_aligned(_data);
+	auto bb = lanes::load_aligned(v._data);
 
 	auto res = ba - bb;
 
@@ -61,7 +68,7 @@ Rect Rect::operator-(Rect const &v) const {
 }
 
 Rect Rect::operator*(float f) const {
-	auto ba = xsimd::load_aligned(_data);
+	auto ba = lanes::load_aligned(_data);
 
 	auto res = ba * f;
 
@@ -73,7 +80,7 @@ Rect Rect::operator*(float f) const {
 }
 
 Rect Rect::operator/(float f) const {
-	auto ba = xsimd::load_aligned(_data);
+	auto ba = lanes::load_aligned(_data);
 
 	auto res = ba / f;
 
@@ -105,88 +112,66 @@ void LuaRuntime::_register_rectangle() {
 		float z = luaL_checknumber(L, 3);
 		float w = luaL_checknumber(L, 4);
 
-		Rect *p = new Rect();
-
-		p->_data[0] = x;
-		p->_data[1] = y;
-		p->_data[2] = z;
-		p->_data[3] = w;
-
-		Rect **udata = static_cast<Rect **>(lua_newuserdata(L, sizeof(Rect *)));
-		*udata = p;
-
-		luaL_getmetatable(L, META);
-		lua_setmetatable(L, -2);
+		push_value(L, Rect(x, y, z, w), META);
 
 		return 1;
 	};
 
 	const auto read = [](lua_State *L) {
-		Rect *p = *static_cast<Rect **>(luaL_checkudata(L, 1, META));
-		const char *field = luaL_checkstring(L, 2);
-
-		if (std::strcmp(field, "left") == 0) lua_pushnumber(L, p->_data[0]);
-		else if (std::strcmp(field, "top") == 0) lua_pushnumber(L, p->_data[1]);
-		else if (std::strcmp(field, "right") == 0) lua_pushnumber(L, p->_data[2]);
-		else if (std::strcmp(field, "bottom") == 0) lua_pushnumber(L, p->_data[3]);
-		else if (std::strcmp(field, "width") == 0) lua_pushnumber(L, p->width());
-		else if (std::strcmp(field, "height") == 0) lua_pushnumber(L, p->height());
-		else if (std::strcmp(field, "pos") == 0) {
-			Vector2 *pos = static_cast<Vector2 *>(lua_newuserdata(L, sizeof(Vector2)));
-
-			*pos = *reinterpret_cast<Vector2 *>(p->_data);
-
-			luaL_getmetatable(L, "point");
-			lua_setmetatable(L, -2);
+		Rect *p = check_value<Rect>(L, 1, META);
+
+		switch (FIELDS.find(L, 2)) {
+			case FIELDS["left"]: lua_pushnumber(L, p->_data[0]); break;
+			case FIELDS["top"]: lua_pushnumber(L, p->_data[1]); break;
+			case FIELDS["right"]: lua_pushnumber(L, p->_data[2]); break;
+			case FIELDS["bottom"]: lua_pushnumber(L, p->_data[3]); break;
+			case FIELDS["width"]: lua_pushnumber(L, p->width()); break;
+			case FIELDS["height"]: lua_pushnumber(L, p->height()); break;
+			case FIELDS["pos"]: {
+				Vector2 *pos = static_cast<Vector2 *>(lua_newuserdata(L, sizeof(Vector2)));
+
+				*pos = *reinterpret_cast<Vector2 *>(p->_data);
+
+				luaL_getmetatable(L, "point");
+				lua_setmetatable(L, -2);
+			} break;
+			default: lua_pushnil(L);
 		}
-		else lua_pushnil(L);
 
 		return 1;
 	};
 
 	const auto write = [](lua_State *L) {
-		Rect *p = *static_cast<Rect **>(luaL_checkudata(L, 1, META));
+		Rect *p = check_value<Rect>(L, 1, META);
 
-		const char *field = luaL_checkstring(L, 2);
+		const int field = FIELDS.find(L, 2);
 		float value = luaL_checknumber(L, 3);
 
-		if (std::strcmp(field, "left") == 0) p->_data[0] = value;
-		else if (std::strcmp(field, "top") == 0) p->_data[1] = value;
-		else if (std::strcmp(field, "right") == 0) p->_data[2] = value;
-		else if (std::strcmp(field, "bottom") == 0) p->_data[3] = value;
-		else luaL_error(L, "invalid field '%s' in rectangle", field);
+		switch (field) {
+			case FIELDS["left"]: p->_data[0] = value; break;
+			case FIELDS["top"]: p->_data[1] = value; break;
+			case FIELDS["right"]: p->_data[2] = value; break;
+			case FIELDS["bottom"]: p->_data[3] = value; break;
+			default: luaL_error(L, "invalid field '%s' in rectangle", lua_tostring(L, 2));
+		}
 
 		return 0;
 	};
 
 	const auto add = [](lua_State *L) {
-		Rect a = **static_cast<Rect **>(luaL_checkudata(L, 1, META));
-		Rect b = **static_cast<Rect **>(luaL_checkudata(L, 2, META));
-		
-		Rect *res = new Rect();
-		*res = a + b;
-
-		Rect **udata = static_cast<Rect **>(lua_newuserdata(L, sizeof(Rect *)));
-		*udata = res;
+		const Rect *a = check_value<Rect>(L, 1, META);
+		const Rect *b = check_value<Rect>(L, 2, META);
 
-		luaL_getmetatable(L, META);
-		lua_setmetatable(L, -2);
+		push_value(L, *a + *b, META);
 
 		return 1;
 	};
 
 	const auto subtract = [](lua_State *L) {
-		Rect a = **static_cast<Rect **>(luaL_checkudata(L, 1, META));
-		Rect b = **static_cast<Rect **>(luaL_checkudata(L, 2, META));
-		
-		Rect *res = new Rect();
-		*res = a - b;
-
-		Rect **udata = static_cast<Rect **>(lua_newuserdata(L, sizeof(Rect *)));
-		*udata = res;
+		const Rect *a = check_value<Rect>(L, 1, META);
+		const Rect *b = check_value<Rect>(L, 2, META);
 
-		luaL_getmetatable(L, META);
-		lua_setmetatable(L, -2);
+		push_value(L, *a - *b, META);
 
 		return 1;
 	};
@@ -195,10 +180,10 @@ void LuaRuntime::_register_rectangle() {
 		Rect *v = nullptr;
 		float n = 0.0f;
 		
-		if ((v = *static_cast<Rect **>(luaL_testudata(L, 1, META))) != nullptr && lua_isnumber(L, 2)) {
+		if ((v = test_value<Rect>(L, 1, META)) != nullptr && lua_isnumber(L, 2)) {
 			n = static_cast<float>(lua_tonumber(L, 2));
 		}
-		else if ((v = *static_cast<Rect **>(luaL_testudata(L, 2, META))) != nullptr && lua_isnumber(L, 1)) {
+		else if ((v = test_value<Rect>(L, 2, META)) != nullptr && lua_isnumber(L, 1)) {
 
 			n = static_cast<float>(lua_tonumber(L, 1));
 		}
@@ -206,19 +191,7 @@ void LuaRuntime::_register_rectangle() {
 			return luaL_error(L, "invalid operands to rectangle multiplication");
 		}
 
-		Rect *res = new Rect();
-
-		auto r = *v * n;
-			
-		*res = r;
-
-		Rect **udata = static_cast<Rect **>(lua_newuserdata(L, sizeof(Rect *)));
-		*udata = res;
-
-		//*res = (*v) * n;
-
-		luaL_getmetatable(L, META);
-		lua_setmetatable(L, -2);
+		push_value(L, *v * n, META);
 
 		return 1;
 	};
@@ -227,10 +200,10 @@ void LuaRuntime::_register_rectangle() {
 		Rect *v = nullptr;
 		float n = 0.0f;
 		
-		if ((v = *static_cast<Rect **>(luaL_testudata(L, 1, META))) != nullptr && lua_isnumber(L, 2)) {
+		if ((v = test_value<Rect>(L, 1, META)) != nullptr && lua_isnumber(L, 2)) {
 			n = static_cast<float>(lua_tonumber(L, 2));
 		}
-		else if ((v = *static_cast<Rect **>(luaL_testudata(L, 2, META))) != nullptr && lua_isnumber(L, 1)) {
+		else if ((v = test_value<Rect>(L, 2, META)) != nullptr && lua_isnumber(L, 1)) {
 
 			n = static_cast<float>(lua_tonumber(L, 1));
 		}
@@ -238,27 +211,15 @@ void LuaRuntime::_register_rectangle() {
 			return luaL_error(L, "invalid operands to rectangle multiplication");
 		}
 
-		Rect *res = new Rect();
-
-		auto r = *v / n;
-			
-		*res = r;
-
-		Rect **udata = static_cast<Rect **>(lua_newuserdata(L, sizeof(Rect *)));
-		*udata = res;
-
-		//*res = (*v) * n;
-
-		luaL_getmetatable(L, META);
-		lua_setmetatable(L, -2);
+		push_value(L, *v / n, META);
 
 		return 1;
 	};
 	const auto equals = [](lua_State *L) {
-		Rect a = **static_cast<Rect **>(luaL_checkudata(L, 1, META));
-		Rect b = **static_cast<Rect **>(luaL_checkudata(L, 2, META));
+		const Rect *a = check_value<Rect>(L, 1, META);
+		const Rect *b = check_value<Rect>(L, 2, META);
 		
-		bool res = a == b;
+		bool res = *a == *b;
 
 		lua_pushboolean(L, res);
 
@@ -266,7 +227,7 @@ void LuaRuntime::_register_rectangle() {
 	};
 
 	const auto tostring = [](lua_State *L) {
-		Rect *v = *static_cast<Rect **>(luaL_checkudata(L, 1, META));
+		Rect *v = check_value<Rect>(L, 1, META);
 		
 		auto str = v->tostring();	
 
@@ -312,13 +273,6 @@ void LuaRuntime::_register_rectangle() {
 	lua_pushcfunction(L, equals);
 	lua_setfield(L, -2, "__eq");
 
-	lua_pushcfunction(L, [](lua_State *L){
-		Rect *ptr = *static_cast<Rect **>(lua_touserdata(L, 1));
-		delete ptr;
-		return 0;
-	});
-	lua_setfield(L, -2, "__gc");
-
 	lua_pop(L, 1);
 }
 
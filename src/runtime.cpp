@@ -2,6 +2,7 @@
 #include <vector>
 #include <string>
 #include <sstream>
+#include <cstring>
 #include <iostream>
 #include <stdexcept>
 #include <filesystem>
@@ -10,8 +11,10 @@
 
 #include <Orbit/Lua/runtime.h>
 #include <Orbit/Lua/castlib.h>
+#include <Orbit/Lua/castindex.h>
 #include <Orbit/config.h>
 #include <Orbit/paths.h>
+#include <Orbit/profiler.h>
 
 #include <spdlog/spdlog.h>
 
@@ -40,6 +43,7 @@ void LuaRuntime::_register_lib() {
 	_register_color();
 	_register_quad();
 	_register_image();
+	_register_array();
 	_register_utils();
 	_register_xtra();
 	_register_lingo_api();
@@ -47,59 +51,66 @@ void LuaRuntime::_register_lib() {
 
 void LuaRuntime::_load_cast_libs() {
 	const auto castpath = paths->data() / "Cast";
+	const auto packpath = paths->data() / "Cast.pack";
 
-	if (!exists(castpath) || !is_directory(castpath)) return;
+	if (exists(packpath)) {
+		try {
+			_cast_pack = std::make_unique<CastPack>(packpath, castpath);
+		} catch (const std::exception &e) {
+			logger->error("failed to open the cast pack: {}", e.what());
+		}
 
-	auto Internal_ptr 		= std::make_shared<CastLib>(CastLib::OFFSET * 0, "Internal");
-	auto customMems_ptr 	= std::make_shared<CastLib>(CastLib::OFFSET * 2, "customMems");
-	auto soundCast_ptr 		= std::make_shared<CastLib>(CastLib::OFFSET * 3, "soundCast");
-	auto levelEditor_ptr 	= std::make_shared<CastLib>(CastLib::OFFSET * 4, "levelEditor");
-	auto exportBitmaps_ptr 	= std::make_shared<CastLib>(CastLib::OFFSET * 5, "exportBitmaps");
-	auto Drought_ptr 		= std::make_shared<CastLib>(CastLib::OFFSET * 6, "Drought");
-	auto Dry_Editor_ptr 	= std::make_shared<CastLib>(CastLib::OFFSET * 7, "Dry Editor");
-	auto MSC_ptr 			= std::make_shared<CastLib>(CastLib::OFFSET * 8, "MSC");
+		if (_cast_pack && _cast_pack->stale()) {
+			logger->warn("the cast pack is older than {}; loading the loose files instead", castpath.string());
+			_cast_pack.reset();
+		}
+	}
 
-	Internal_ptr->load_members(castpath);
-	customMems_ptr->load_members(castpath);
-	soundCast_ptr->load_members(castpath);
-	levelEditor_ptr->load_members(castpath);
-	exportBitmaps_ptr->load_members(castpath);
-	Drought_ptr->load_members(castpath);
-	Dry_Editor_ptr->load_members(castpath);
-	MSC_ptr->load_members(castpath);
+	if (!_cast_pack && (!exists(castpath) || !is_directory(castpath))) return;
 
-	for (auto &m : Internal_ptr->members()) _castmembers.insert({ m->name, m });
-	for (auto &m : customMems_ptr->members()) _castmembers.insert({ m->name, m });
-	for (auto &m : soundCast_ptr->members()) _castmembers.insert({ m->name, m });
-	for (auto &m : levelEditor_ptr->members()) _castmembers.insert({ m->name, m });
-	for (auto &m : exportBitmaps_ptr->members()) _castmembers.insert({ m->name, m });
-	for (auto &m : Drought_ptr->members()) _castmembers.insert({ m->name, m });
-	for (auto &m : Dry_Editor_ptr->members()) _castmembers.insert({ m->name, m });
-	for (auto &m : MSC_ptr->members()) _castmembers.insert({ m->name, m });
+	static const std::pair<int, const char *> libs[] = {
+		{ 0, "Internal" },
+		{ 2, "customMems" },
+		{ 3, "soundCast" },
+		{ 4, "levelEditor" },
+		{ 5, "exportBitmaps" },
+		{ 6, "Drought" },
+		{ 7, "Dry Editor" },
+		{ 8, "MSC" },
+	};
 
-	_castlibs.push_back(Internal_ptr);
-	_castlib_names.insert({ Internal_ptr->name(), Internal_ptr });
+	std::vector<CastLib *> loading;
 
-	_castlibs.push_back(customMems_ptr);
-	_castlib_names.insert({ customMems_ptr->name(), customMems_ptr });
+	for (const auto &[index, name] : libs) {
+		auto lib = std::make_shared<CastLib>(CastLib::OFFSET * index, name);
 
-	_castlibs.push_back(soundCast_ptr);
-	_castlib_names.insert({ soundCast_ptr->name(), soundCast_ptr });
+		_castlibs.push_back(lib);
+		_castlib_names.insert({ lib->name(), lib });
+		loading.push_back(lib.get());
+	}
 
-	_castlibs.push_back(levelEditor_ptr);
-	_castlib_names.insert({ levelEditor_ptr->name(), levelEditor_ptr });
+	if (_cast_pack) {
+		logger->info("loading the cast from {}", packpath.string());
 
-	_castlibs.push_back(exportBitmaps_ptr);
-	_castlib_names.insert({ exportBitmaps_ptr->name(), exportBitmaps_ptr });
+		CastLib::load_members(*_cast_pack, loading);
+	} else {
+		CastIndex index(castpath, paths->data() / "Cast.index");
+		index.update();
 
-	_castlibs.push_back(Drought_ptr);
-	_castlib_names.insert({ Drought_ptr->name(), Drought_ptr });
+		CastLib::load_members(index, loading);
 
-	_castlibs.push_back(Dry_Editor_ptr);
-	_castlib_names.insert({ Dry_Editor_ptr->name(), Dry_Editor_ptr });
+		logger->debug("cast index: {} entries reused, {} rescanned", index.reused(), index.rescanned());
 
-	_castlibs.push_back(MSC_ptr);
-	_castlib_names.insert({ MSC_ptr->name(), MSC_ptr });
+		try {
+			index.save();
+		} catch (const std::exception &e) {
+			logger->warn("failed to save the cast index: {}", e.what());
+		}
+	}
+
+	for (auto &lib : _castlibs) {
+		for (auto &m : lib->members()) _castmembers.insert({ m->name, m });
+	}
 
 	return;
 
@@ -146,7 +157,12 @@ void LuaRuntime::load_file(std::filesystem::path const &file) {
 	if (!std::filesystem::is_regular_file(file) || file.extension() != ".lua")
 		throw std::invalid_argument("invalid script file");
 
-	if (luaL_dofile(L, file.string().c_str()) != LUA_OK) {
+	_sampler.resume();
+	const int res = luaL_dofile(L, file.string().c_str());
+
+	draw_queue.flush();
+
+	if (res != LUA_OK) {
 		const char *err_msg = lua_tostring(L, -1);
 		lua_pop(L, 1);
 
@@ -180,8 +196,20 @@ void LuaRuntime::init() {
 		return;
 	}
 
+	_pool.stats = {};
+	profiler.begin_frame("initFrame");
+
+	_sampler.resume();
 	int res = lua_pcall(L, 0, 0, 0);
 
+	{
+		Profiler::Scope scope("draw queue");
+		draw_queue.flush();
+	}
+
+	profiler.end_frame();
+	_log_allocations(_init.c_str());
+
 	if (res != LUA_OK) {
 		std::string err = lua_tostring(L, -1);
 		logger->error(std::string("failed to run init function '") + _init + "': " + err);
@@ -198,8 +226,20 @@ void LuaRuntime::process_frame() {
 		return;
 	}
 
+	_pool.stats = {};
+	profiler.begin_frame("exitFrame");
+
+	_sampler.resume();
 	int res = lua_pcall(L, 0, 0, 0);
 
+	{
+		Profiler::Scope scope("draw queue");
+		draw_queue.flush();
+	}
+
+	profiler.end_frame();
+	_log_allocations(_entry.c_str());
+
 	if (res != LUA_OK) {
 		std::string err = lua_tostring(L, -1);
 		logger->error(std::string("failed to run entry function '") + _entry + "': " + err);
@@ -208,6 +248,15 @@ void LuaRuntime::process_frame() {
 	}
 }
 
+void LuaRuntime::_log_allocations(const char *call) const {
+	const auto &stats = _pool.stats;
+
+	logger->trace(
+		"{}: {} allocations ({} bytes), {} frees; {} bytes in use, {} bytes of slabs",
+		call, stats.allocations, stats.bytes, stats.frees, _pool.in_use(), _pool.reserved()
+	);
+}
+
 void LuaRuntime::draw_frame() {
 	if (_redraw) {
 		// redraw here
@@ -217,6 +266,27 @@ void LuaRuntime::draw_frame() {
 	}
 }
 
+// Like the one luaL_newstate sets, but warnings start on and go to the log;
+// "@off" and "@on" still turn them off and on.
+void LuaRuntime::_warn(void *runtime, const char *message, int to_continue) {
+	auto *self = static_cast<LuaRuntime *>(runtime);
+
+	if (self->_warning.empty() && !to_continue && message[0] == '@') {
+		if (std::strcmp(message, "@off") == 0) self->_warnings = false;
+		else if (std::strcmp(message, "@on") == 0) self->_warnings = true;
+
+		return;
+	}
+
+	self->_warning += message;
+
+	if (to_continue) return;
+
+	if (self->_warnings) self->logger->warn("[script]: {}", self->_warning);
+
+	self->_warning.clear();
+}
+
 LuaRuntime::LuaRuntime(
 	int width, 
 	int height, 
@@ -227,16 +297,40 @@ LuaRuntime::LuaRuntime(
 ) : 
 	_width(width), 
 	_height(height),
+	_redraw(false),
+	_halted(false),
+	_entry("exitFrame"),
+	_init("initFrame"),
+	_output(paths->executable()),
+	_warning(""),
+	_warnings(true),
 	paths(paths),
 	logger(logger),
 	shaders(shaders),
 	config(config),
-	_redraw(false),
-	_entry("exitFrame"),
-	_init("initFrame") {
+	cast_cache(static_cast<size_t>(config->cast_cache_mb) << 20),
+	viewport{},
+	draw_queue(viewport, shaders.get()) {
+
+	L = lua_newstate(
+		config->lua_allocator == Orbit::Config::Allocator::System ? Pool::lua_system_alloc : Pool::lua_alloc,
+		&_pool
+	);
 
-	L =  luaL_newstate();
+	lua_atpanic(L, [](lua_State *L) {
+		const char *message = lua_tostring(L, -1);
+		std::cerr << "unprotected error in call to Lua API (" << (message ? message : "error object is not a string") << ")" << std::endl;
+		return 0;
+	});
+
+	lua_setwarnf(L, _warn, this);
+
+	if (config->sample_lua) _sampler.attach(L);
 	
+	// Queued draws may sample the regions about to be reused
+	atlas.on_clear = [this] { draw_queue.flush(); };
+	cast_cache.on_unload = [this](const Image *pixels) { atlas.release(pixels); };
+
 	luaopen_base(L);
 	luaopen_math(L);
 	luaopen_string(L);
@@ -244,11 +338,15 @@ LuaRuntime::LuaRuntime(
 	_load_cast_libs();
 	_register_lib();
 
-	viewport = LoadRenderTexture(1400, 800);
+	if (IsWindowReady()) {
+		viewport = LoadRenderTexture(1400, 800);
 
-	BeginTextureMode(viewport);
-	ClearBackground(WHITE);
-	EndTextureMode();
+		BeginTextureMode(viewport);
+		ClearBackground(WHITE);
+		EndTextureMode();
+	} else {
+		viewport = RenderTexture2D{};
+	}
 
 	_castlibs.reserve(8);
 	_castlib_names.reserve(12);
@@ -256,6 +354,9 @@ LuaRuntime::LuaRuntime(
 
 LuaRuntime::~LuaRuntime() {
     lua_close(L);
+
+    // The atlas goes before the pixels the cache still holds
+    cast_cache.on_unload = nullptr;
 }
 
 };
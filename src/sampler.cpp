@@ -0,0 +1,79 @@
+#include <Orbit/Lua/sampler.h>
+
+#include <fstream>
+#include <cstring>
+
+extern "C" {
+    #include <lua.h>
+    #include <lauxlib.h>
+}
+
+namespace Orbit::Lua {
+
+void Sampler::_hook(lua_State *L, lua_Debug *) {
+	auto *self = *static_cast<Sampler **>(lua_getextraspace(L));
+	if (self != nullptr) self->_sample(L);
+}
+
+void Sampler::_sample(lua_State *L) {
+	const auto now = clock::now();
+	const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(now - _last).count();
+	_last = now;
+
+	_frames.clear();
+
+	lua_Debug ar;
+
+	for (int level = 0; lua_getstack(L, level, &ar) != 0; level++) {
+		lua_getinfo(L, "Sn", &ar);
+
+		std::string frame = ar.name != nullptr ? ar.name : "?";
+
+		if (std::strcmp(ar.what, "C") == 0) {
+			frame += " [C]";
+		} else {
+			if (std::strcmp(ar.what, "main") == 0) frame = "main chunk";
+
+			frame += " (";
+			frame += ar.short_src;
+			frame += ':';
+			frame += std::to_string(ar.linedefined);
+			frame += ')';
+		}
+
+		_frames.push_back(std::move(frame));
+	}
+
+	// Root first
+	_stack.clear();
+
+	for (auto frame = _frames.rbegin(); frame != _frames.rend(); frame++) {
+		if (!_stack.empty()) _stack += ';';
+		_stack += *frame;
+	}
+
+	_stacks[_stack] += static_cast<uint64_t>(elapsed);
+}
+
+void Sampler::attach(lua_State *L) {
+	*static_cast<Sampler **>(lua_getextraspace(L)) = this;
+
+	lua_sethook(L, _hook, LUA_MASKCOUNT, PERIOD);
+
+	_attached = true;
+	resume();
+}
+
+void Sampler::write(const std::filesystem::path &file) const {
+	std::ofstream out(file);
+	if (!out) return;
+
+	for (const auto &[stack, nanoseconds] : _stacks) {
+		const auto microseconds = nanoseconds / 1000;
+		if (microseconds > 0) out << stack << ' ' << microseconds << '\n';
+	}
+}
+
+Sampler::Sampler() : _attached(false), _last(), _stacks({}), _frames({}), _stack("") {}
+
+};
@@ -215,6 +215,9 @@ CopyPixelsShader::CopyPixelsShader() {
         uniform vec2 texture0_size;
         uniform vec2 texture1_size;
         uniform vec2 mask_size;
+
+        // where the source image is in texture0 (see Orbit::RlExt::Atlas)
+        uniform vec4 source_region;
         
         uniform int use_mask;
         uniform int use_color;
@@ -240,9 +243,19 @@ CopyPixelsShader::CopyPixelsShader() {
             if (uv.x < 0.0 || uv.x > 1.0 || uv.y < 0.0 || uv.y > 1.0) {
                 c = white;
             } else {
-                if (bool(use_mask) && texture(mask, ((uv * texture0_size) / mask_size)) != white) discard;
+                if (bool(use_mask)) {
+                    // the mask lines up with the top left corner of the source,
+                    // so the scaling has to happen top-down
+                    vec2 muv = uv;
+                    if (bool(vflip)) muv.y = 1.0 - muv.y;
+
+                    muv = (muv * texture0_size) / mask_size;
+                    if (bool(vflip)) muv.y = 1.0 - muv.y;
 
-                c = texture(texture0, uv);
+                    if (texture(mask, muv) != white) discard;
+                }
+
+                c = texture(texture0, source_region.xy + uv * source_region.zw);
 
                 if (bool(use_color) && c != white) {
                     c = fragColor;
@@ -252,7 +265,7 @@ CopyPixelsShader::CopyPixelsShader() {
             if (ink == 39) { // darkest
                 finalColor = c;
 
-                vec4 c2 = texture(texture1, ((uv * texture0_size) / texture1_size));
+                vec4 c2 = texture(texture1, gl_FragCoord.xy / texture1_size);
 
                 finalColor.r = min(c.r, c2.r);
                 finalColor.g = min(c.g, c2.g);
@@ -263,7 +276,7 @@ CopyPixelsShader::CopyPixelsShader() {
                 if (c == white) discard;
 
                 if (blend < 0.987) {
-                    vec4 c2 = texture(texture1, ((uv * texture0_size) / texture1_size));
+                    vec4 c2 = texture(texture1, gl_FragCoord.xy / texture1_size);
                     finalColor = mix(c2, c, blend);
                     // finalColor = vec4(c.rgb, blend);
                 } else {
@@ -271,7 +284,7 @@ CopyPixelsShader::CopyPixelsShader() {
                 }
             } else if (ink == 0) { // default
                 if (blend < 0.987) {
-                    vec4 c2 = texture(texture1, ((uv * texture0_size) / texture1_size));
+                    vec4 c2 = texture(texture1, gl_FragCoord.xy / texture1_size);
                     finalColor = mix(c2, c, blend);
                     // finalColor = vec4(c.rgb, blend);
                 } else {
@@ -291,6 +304,8 @@ CopyPixelsShader::CopyPixelsShader() {
     use_color_loc = GetShaderLocation(shader, "use_color");
     blend_loc = GetShaderLocation(shader, "blend");
     ink_loc = GetShaderLocation(shader, "ink");
+    vflip_loc = GetShaderLocation(shader, "vflip");
+    source_region_loc = GetShaderLocation(shader, "source_region");
 }
 
 InvbCopyPixelsShader::InvbCopyPixelsShader() {
@@ -334,6 +349,9 @@ InvbCopyPixelsShader::InvbCopyPixelsShader() {
         uniform vec2 texture0_size;
         uniform vec2 texture1_size;
         uniform vec2 mask_size;
+
+        // where the source image is in texture0 (see Orbit::RlExt::Atlas)
+        uniform vec4 source_region;
         
         uniform int use_mask;
         uniform int use_color;
@@ -413,9 +431,19 @@ InvbCopyPixelsShader::InvbCopyPixelsShader() {
             if (uv.x < 0.0 || uv.x > 1.0 || uv.y < 0.0 || uv.y > 1.0) {
                 c = white;
             } else {
-                if (bool(use_mask) && texture(mask, ((uv * texture0_size) / mask_size)) != white) discard;
+                if (bool(use_mask)) {
+                    // the mask lines up with the top left corner of the source,
+                    // so the scaling has to happen top-down
+                    vec2 muv = uv;
+                    if (bool(vflip)) muv.y = 1.0 - muv.y;
+
+                    muv = (muv * texture0_size) / mask_size;
+                    if (bool(vflip)) muv.y = 1.0 - muv.y;
 
-                c = texture(texture0, uv);
+                    if (texture(mask, muv) != white) discard;
+                }
+
+                c = texture(texture0, source_region.xy + uv * source_region.zw);
 
                 if (bool(use_color) && c != white) {
                     c = fragColor;
@@ -425,7 +453,7 @@ InvbCopyPixelsShader::InvbCopyPixelsShader() {
             if (ink == 39) { // darkest
                 finalColor = c;
 
-                vec4 c2 = texture(texture1, ((uv * texture0_size) / texture1_size));
+                vec4 c2 = texture(texture1, gl_FragCoord.xy / texture1_size);
 
                 finalColor.r = min(c.r, c2.r);
                 finalColor.g = min(c.g, c2.g);
@@ -436,7 +464,7 @@ InvbCopyPixelsShader::InvbCopyPixelsShader() {
                 if (c == white) discard;
 
                 if (blend < 0.987) {
-                    vec4 c2 = texture(texture1, ((uv * texture0_size) / texture1_size));
+                    vec4 c2 = texture(texture1, gl_FragCoord.xy / texture1_size);
                     finalColor = mix(c2, c, blend);
                     // finalColor = vec4(c.rgb, blend);
                 } else {
@@ -444,7 +472,7 @@ InvbCopyPixelsShader::InvbCopyPixelsShader() {
                 }
             } else if (ink == 0) { // default
                 if (blend < 0.987) {
-                    vec4 c2 = texture(texture1, ((uv * texture0_size) / texture1_size));
+                    vec4 c2 = texture(texture1, gl_FragCoord.xy / texture1_size);
                     finalColor = mix(c2, c, blend);
                     // finalColor = vec4(c.rgb, blend);
                 } else {
@@ -464,6 +492,8 @@ InvbCopyPixelsShader::InvbCopyPixelsShader() {
     use_color_loc = GetShaderLocation(shader, "use_color");
     blend_loc = GetShaderLocation(shader, "blend");
     ink_loc = GetShaderLocation(shader, "ink");
+    vflip_loc = GetShaderLocation(shader, "vflip");
+    source_region_loc = GetShaderLocation(shader, "source_region");
     vertices_loc = GetShaderLocation(shader, "vertex_pos");
     src_coords_loc = GetShaderLocation(shader, "tex_coord_pos");
 }
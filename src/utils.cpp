@@ -1,19 +1,29 @@
+#include <new>
+#include <cstdio>
+#include <vector>
 #include <cstring>
 #include <iomanip>
 #include <sstream>
 #include <iostream>
 #include <filesystem>
+#include <string_view>
 
 #include <Orbit/Lua/runtime.h>
 #include <Orbit/Lua/random.h>
 #include <Orbit/Lua/vector.h>
 #include <Orbit/Lua/rect.h>
 #include <Orbit/Lua/quad.h>
+#include <Orbit/Lua/userdata.h>
+#include <Orbit/Lua/writer.h>
+#include <Orbit/Lua/reader.h>
 #include <Orbit/RlExt/image.h>
+#include <Orbit/RlExt/canvas.h>
 #include <Orbit/RlExt/rl.h>
+#include <Orbit/profiler.h>
 
 #include <MobitParser/tokens.h>
 #include <MobitParser/nodes.h>
+#include <MobitParser/exceptions.h>
 
 #include <spdlog/spdlog.h>
 #include <raylib.h>
@@ -28,6 +38,11 @@ extern "C" {
 using Orbit::Lua::Vector;
 using Orbit::Lua::Rect;
 using Orbit::Lua::Quad;
+using Orbit::Lua::userdata_value;
+using Orbit::Lua::push_value;
+using Orbit::Lua::test_value;
+using Orbit::Lua::check_value;
+using Orbit::RlExt::Canvas;
 
 inline Orbit::RlExt::CopyImageParams parse_params(lua_State *L, int index) {
 	luaL_checktype(L, index, LUA_TTABLE);
@@ -55,7 +70,7 @@ inline Orbit::RlExt::CopyImageParams parse_params(lua_State *L, int index) {
 	
 	lua_getfield(L, index, "mask");
 	if (!lua_isnil(L, -1)) {
-		Image *i = static_cast<Image *>(luaL_checkudata(L, -1, "image"));
+		Canvas *i = static_cast<Canvas *>(luaL_checkudata(L, -1, "image"));
 		params.mask = i;
 	}
 	lua_pop(L, 1);
@@ -117,7 +132,7 @@ int distance(lua_State *L) {
 			(p1 = luaL_testudata(L, 1, "vector")) != nullptr &&
 			(p2 = luaL_testudata(L, 2, "vector")) != nullptr
 		) {
-		return distance_vector(L, *static_cast<Vector **>(p1), *static_cast<Vector **>(p2));
+		return distance_vector(L, userdata_value<Vector>(p1), userdata_value<Vector>(p2));
 	}
 	else if (
 			(p1 = luaL_testudata(L, 1, "point")) != nullptr &&
@@ -133,16 +148,7 @@ int distance(lua_State *L) {
 //
 
 int mix_vector(lua_State *L, const Vector *v1, const Vector *v2, float t) {
-	auto res = v1->mix(*v2, t);
-
-	Vector *res_vec = new Vector();
-	*res_vec = res;
-
-	Vector **udata = static_cast<Vector **>(lua_newuserdata(L, sizeof(Vector*)));
-	*udata = res_vec;
-
-	luaL_getmetatable(L, "vector");
-	lua_setmetatable(L, -2);
+	push_value(L, v1->mix(*v2, t), "vector");
 
 	return 1;
 }
@@ -170,7 +176,7 @@ int mix(lua_State *L) {
 			(p1 = luaL_testudata(L, 1, "vector")) != nullptr &&
 			(p2 = luaL_testudata(L, 2, "vector")) != nullptr
 		) {
-		return mix_vector(L, *static_cast<Vector **>(p1), *static_cast<Vector **>(p2), t);
+		return mix_vector(L, userdata_value<Vector>(p1), userdata_value<Vector>(p2), t);
 	}
 	else if (
 			(p1 = luaL_testudata(L, 1, "point")) != nullptr &&
@@ -187,15 +193,16 @@ int mix(lua_State *L) {
 
 
 int make_vector(lua_State *L) {
-	Vector **v = nullptr;
+	Vector *v = nullptr;
 
 	Vector2 *p1 = nullptr;
 	Vector2 *p2 = nullptr;
 
-	Vector *p = new Vector();
+	Vector result;
+	Vector *p = &result;
 
-	if ((v = static_cast<Vector **>(luaL_testudata(L, 1, "vector"))) != nullptr) {
-		memcpy(p->_data, (*v)->_data, sizeof(float) * 4);
+	if ((v = test_value<Vector>(L, 1, "vector")) != nullptr) {
+		memcpy(p->_data, v->_data, sizeof(float) * 4);
 	} else if (
 			(p1 = static_cast<Vector2 *>(luaL_testudata(L, 1, "point"))) != nullptr &&
 			(p2 = static_cast<Vector2 *>(luaL_testudata(L, 2, "point"))) != nullptr
@@ -212,11 +219,7 @@ int make_vector(lua_State *L) {
 		p->_data[3] = lua_tonumber(L, 4);
 	}
 
-	Vector **udata = static_cast<Vector **>(lua_newuserdata(L, sizeof(Vector*)));
-	*udata = p;
-
-	luaL_getmetatable(L, "vector");
-	lua_setmetatable(L, -2);
+	push_value(L, result, "vector");
 	
 	return 1;
 }
@@ -240,19 +243,21 @@ int make_point(lua_State *L) {
 
 }
 int make_rect(lua_State *L) {
-	Vector **v = nullptr;
+	Rect *r = nullptr;
+	Vector *v = nullptr;
 
 	Vector2 *p1 = nullptr;
 	Vector2 *p2 = nullptr;
 
 	Color *c = nullptr;
 
-	Rect *p = new Rect();
+	Rect result;
+	Rect *p = &result;
 
-	if ((v = static_cast<Vector **>(luaL_testudata(L, 1, "rect"))) != nullptr) {
-		memcpy(p->_data, (*v)->_data, sizeof(float) * 4);
-	} else if ((v = static_cast<Vector **>(luaL_testudata(L, 1, "vector"))) != nullptr) {
-		memcpy(p->_data, (*v)->_data, sizeof(float) * 4);
+	if ((r = test_value<Rect>(L, 1, "rect")) != nullptr) {
+		memcpy(p->_data, r->_data, sizeof(float) * 4);
+	} else if ((v = test_value<Vector>(L, 1, "vector")) != nullptr) {
+		memcpy(p->_data, v->_data, sizeof(float) * 4);
 	} else if (
 			(p1 = static_cast<Vector2 *>(luaL_testudata(L, 1, "point"))) != nullptr &&
 			(p2 = static_cast<Vector2 *>(luaL_testudata(L, 2, "point"))) != nullptr
@@ -273,11 +278,7 @@ int make_rect(lua_State *L) {
 		p->_data[3] = lua_tonumber(L, 4);
 	}
 
-	Rect **udata = static_cast<Rect **>(lua_newuserdata(L, sizeof(Rect*)));
-	*udata = p;
-
-	luaL_getmetatable(L, "rect");
-	lua_setmetatable(L, -2);
+	push_value(L, result, "rect");
 	
 	return 1;
 }
@@ -371,12 +372,7 @@ int rotate_point(lua_State *L, const Vector2 *p, float degrees, const Vector2 *c
 }
 
 int rotate_quad(lua_State *L, const Quad *q, float degrees, const Vector2 *center) {
-	Quad **nq = static_cast<Quad **>(lua_newuserdata(L, sizeof(Quad *)));
-
-	*nq = new Quad(q->rotate(degrees, (center == nullptr) ? q->center() : *center));
-
-	luaL_getmetatable(L, "quad");
-	lua_setmetatable(L, -2);
+	push_value(L, q->rotate(degrees, (center == nullptr) ? q->center() : *center), "quad");
 
 	return 1;
 }
@@ -389,11 +385,7 @@ int rotate_rect(lua_State *L, const Rect *r, float degrees, const Vector2 *cente
 				Vector2{r->left(), r->bottom()}
 			);
 
-	Quad **nq = static_cast<Quad **>(lua_newuserdata(L, sizeof(Quad *)));
-	*nq = new Quad(q.rotate(degrees, (center == nullptr) ? q.center() : *center));
-
-	luaL_getmetatable(L, "quad");
-	lua_setmetatable(L, -2);
+	push_value(L, q.rotate(degrees, (center == nullptr) ? q.center() : *center), "quad");
 
 	return 1;
 }
@@ -413,12 +405,12 @@ int rotate(lua_State *L) {
 	else if (
 			(p1 = luaL_testudata(L, 1, "quad")) != nullptr
 	) {
-		return rotate_quad(L, *static_cast<Quad **>(p1), degrees, center);
+		return rotate_quad(L, userdata_value<Quad>(p1), degrees, center);
 	}
 	else if (
 			(p1 = luaL_testudata(L, 1, "rect")) != nullptr
 	) {
-		return rotate_rect(L, static_cast<Rect *>(p1), degrees, center);
+		return rotate_rect(L, userdata_value<Rect>(p1), degrees, center);
 	}
 	else {
 		return luaL_error(L, "invalid parameters");
@@ -434,29 +426,17 @@ int make_quad(lua_State *L) {
 			void *p = nullptr;
 	
 			if ((p = luaL_checkudata(L, 1, "quad")) != nullptr) {
-				Quad **q = static_cast<Quad **>(lua_newuserdata(L, sizeof(Quad *)));
-
-				*q = new Quad(*static_cast<Quad *>(p));
-			
-				luaL_getmetatable(L, "quad");
-				lua_setmetatable(L, -2);
+				push_value(L, *userdata_value<Quad>(p), "quad");
 			}
 			else if ((p = luaL_checkudata(L, 1, "rectangle")) != nullptr) {
-				Rect *r = static_cast<Rect *>(p);
+				Rect *r = userdata_value<Rect>(p);
 				
-				auto *nptr = new Quad(
+				push_value(L, Quad(
 					Vector2{r->left(), r->top()}, 
 					Vector2{r->right(), r->top()}, 
 					Vector2{r->right(), r->bottom()}, 
 					Vector2{r->left(), r->bottom()}
-				);
-
-				Quad **q = static_cast<Quad **>(lua_newuserdata(L, sizeof(Quad *)));
-
-				*q = nptr;
-				
-				luaL_getmetatable(L, "quad");
-				lua_setmetatable(L, -2);
+				), "quad");
 			}
 		} break;
 
@@ -466,13 +446,7 @@ int make_quad(lua_State *L) {
 			Vector2 *br = static_cast<Vector2 *>(luaL_checkudata(L, 3, "point"));
 			Vector2 *bl = static_cast<Vector2 *>(luaL_checkudata(L, 4, "point"));
 				
-			Quad *nptr = new Quad(*tl, *tr, *br, *bl);
-			
-			Quad **q = static_cast<Quad **>(lua_newuserdata(L, sizeof(Quad *)));
-			*q = nptr;	
-			
-			luaL_getmetatable(L, "quad");
-			lua_setmetatable(L, -2);
+			push_value(L, Quad(*tl, *tr, *br, *bl), "quad");
 		} break;
 	
 		default: return luaL_error(L, "invalid number of arguments to quad");
@@ -491,7 +465,7 @@ int enclose(lua_State *L) {
 		void *arg1 = nullptr;
 
 		if ((arg1 = luaL_testudata(L, c, "rectangle")) != nullptr) {
-			Rect *r = *static_cast<Rect **>(arg1);
+			Rect *r = userdata_value<Rect>(arg1);
 
 			if (c == 0) {
 				std::memcpy(rect._data, r->_data, sizeof(float) * 4);
@@ -511,7 +485,7 @@ int enclose(lua_State *L) {
 			if (r->bottom() < rect.top()) rect.top() = r->bottom();
 		}
 		else if ((arg1 = luaL_testudata(L, c, "quad")) != nullptr) {
-			Quad *quad = *static_cast<Quad **>(arg1);
+			Quad *quad = userdata_value<Quad>(arg1);
 
 			float minx = std::min(std::min(quad->topleft.x, quad->topright.x), std::min(quad->bottomleft.x, quad->bottomright.x));
 			float miny = std::min(std::min(quad->topleft.y, quad->topright.y), std::min(quad->bottomleft.y, quad->bottomright.y));
@@ -533,23 +507,19 @@ int enclose(lua_State *L) {
 			if (p->y > rect.bottom()) rect.bottom() = p->y;
 		}
 		else if ((arg1 = luaL_testudata(L, c, "image")) != nullptr) {
-			Image *i = static_cast<Image *>(arg1);
+			Canvas *i = static_cast<Canvas *>(arg1);
 
 			rect._data[0] = 0;
 			rect._data[1] = 0;
-			rect._data[2] = i->width;
-			rect._data[3] = i->height;
+			rect._data[2] = i->width();
+			rect._data[3] = i->height();
 		}
 		else {
 			return luaL_error(L, "invalid enclose argument %d", c);
 		}	
 	}
 
-	Rect **res = static_cast<Rect **>(lua_newuserdata(L, sizeof(Rect *)));
-	**res = rect;
-
-	luaL_getmetatable(L, "rectangle");
-	lua_setmetatable(L, -2);
+	push_value(L, rect, "rectangle");
 
 	return 1;
 }
@@ -565,17 +535,17 @@ int center(lua_State *L) {
 		*res = *p;
 	}
 	else if ((arg = luaL_testudata(L, 1, "rectangle"))) {
-		Rect *r = *static_cast<Rect **>(arg);
+		Rect *r = userdata_value<Rect>(arg);
 
 		*res = Vector2{(r->left() + r->right()) / 2.0f, (r->top() + r->bottom()) / 2.0f};
 	}
 	else if ((arg = luaL_testudata(L, 1, "vector"))) {
-		Vector *v = *static_cast<Vector **>(arg);
+		Vector *v = userdata_value<Vector>(arg);
 
 		*res = Vector2{(v->x() + v->y()) / 2.0f, (v->z() + v->w()) / 2.0f};
 	}
 	else if ((arg = luaL_testudata(L, 1, "quad"))) {
-		Quad *q = *static_cast<Quad **>(arg);
+		Quad *q = userdata_value<Quad>(arg);
 
 		*res = q->center();
 	}
@@ -590,6 +560,8 @@ int center(lua_State *L) {
 }
 
 int make_image(lua_State *L) {
+	const auto mark = Orbit::profiler.open("image");
+
 		int count = lua_gettop(L);
 
 		switch (count) {
@@ -601,14 +573,14 @@ int make_image(lua_State *L) {
 					
 					auto full = runtime->paths->data() / std::string(path);
 
-					Image *img = static_cast<Image *>(lua_newuserdata(L, sizeof(Image)));
-					*img = LoadImage(full.string().c_str());
+					Canvas *img = static_cast<Canvas *>(lua_newuserdata(L, sizeof(Canvas)));
+					new (img) Canvas(LoadImage(full.string().c_str()));
 				} else {
-					Image *img = static_cast<Image *>(luaL_checkudata(L, 1, "image"));
+					Canvas *img = static_cast<Canvas *>(luaL_checkudata(L, 1, "image"));
 
-					Image *copy = static_cast<Image *>(lua_newuserdata(L, sizeof(Image)));
+					Canvas *copy = static_cast<Canvas *>(lua_newuserdata(L, sizeof(Canvas)));
 
-					*copy = ImageCopy(*img);
+					new (copy) Canvas(img->duplicate());
 				}			
 			}
 			break;
@@ -617,8 +589,8 @@ int make_image(lua_State *L) {
 				int width = luaL_checkinteger(L, 1);
 				int height = luaL_checkinteger(L, 2);
 		
-				Image *img = static_cast<Image *>(lua_newuserdata(L, sizeof(Image)));
-				*img = GenImageColor(width, height, WHITE);;
+				Canvas *img = static_cast<Canvas *>(lua_newuserdata(L, sizeof(Canvas)));
+				new (img) Canvas(GenImageColor(width, height, WHITE));
 			}
 			break;
 
@@ -627,8 +599,8 @@ int make_image(lua_State *L) {
 				int height = luaL_checkinteger(L, 2);
 				Color *color = static_cast<Color *>(luaL_checkudata(L, 3, "color"));
 
-				Image *img = static_cast<Image *>(lua_newuserdata(L, sizeof(Image)));
-				*img = GenImageColor(width, height, *color);;
+				Canvas *img = static_cast<Canvas *>(lua_newuserdata(L, sizeof(Canvas)));
+				new (img) Canvas(GenImageColor(width, height, *color));
 			}
 			break;
 		}
@@ -636,6 +608,7 @@ int make_image(lua_State *L) {
 		luaL_getmetatable(L, "image");
 		lua_setmetatable(L, -2);
 
+		Orbit::profiler.close(mark);
 		return 1;
 };
 
@@ -660,25 +633,42 @@ int random_gen(lua_State *L) {
 }
 
 int draw(lua_State *L) {
+	const auto mark = Orbit::profiler.open("draw");
+
 	void *ptr = nullptr;
 	const char *text = nullptr;
-	Image *img = nullptr;
+	Canvas *img = nullptr;
 
 	auto* runtime = static_cast<Orbit::Lua::LuaRuntime*>(lua_touserdata(L, lua_upvalueindex(1)));
 
+	// Nothing to present to without a context
+	if (runtime->viewport.id == 0) {
+		Orbit::profiler.close(mark);
+		return 0;
+	}
+
+	auto &queue = runtime->draw_queue;
+
 	if ((text = lua_tostring(L, 1)) != nullptr) {
 		int x = lua_tonumber(L, 2);
 		int y = lua_tonumber(L, 3);
 		Color *c = static_cast<Color *>(luaL_testudata(L, 4, "color"));
 		int size = lua_tonumber(L, 5);
 	
-		BeginTextureMode(runtime->viewport);
-		DrawText(text, x, y, size ? 20 : size, c ? *c : BLACK);
-		EndTextureMode();
+		queue.text(text, x, y, size ? 20 : size, c ? *c : BLACK);
 	
 		runtime->_set_redraw();
 	} else if (luaL_testudata(L, 1, "image") != nullptr) {
-		img = static_cast<Image *>(luaL_checkudata(L, 1, "image"));
+		img = static_cast<Canvas *>(luaL_checkudata(L, 1, "image"));
+
+		// Cast member images are drawn out of the atlas, so that consecutive ones share a draw call
+		auto view = runtime->atlas.view(*img);
+		auto t = view.bound();
+		Canvas *sampled = view.texture.id == img->target.texture.id ? img : nullptr;
+
+		// canvas textures are stored bottom-up
+		auto source = view.source();
+		auto flipped = Rectangle{source.x, source.y, source.width, -source.height};
 
 		if (lua_isnumber(L, 2) && lua_isnumber(L, 3)) { 
 			// draw(image, x, y, {opt})
@@ -689,13 +679,7 @@ int draw(lua_State *L) {
 			Orbit::RlExt::CopyImageParams params;
 			if (lua_istable(L, 4)) params = parse_params(L, 4);
 
-			auto t = LoadTextureFromImage(*img);
-
-			BeginTextureMode(runtime->viewport);
-			DrawTexture(t, x, y, WHITE);
-			EndTextureMode();
-
-			UnloadTexture(t);
+			queue.texture(t, flipped, Rectangle{x, y, source.width, source.height}, WHITE, sampled);
 		} else if (luaL_testudata(L, 2, "point")) {
 			// draw(image, x, y, {opt})
 
@@ -704,20 +688,14 @@ int draw(lua_State *L) {
 			Orbit::RlExt::CopyImageParams params;
 			if (lua_istable(L, 3)) params = parse_params(L, 3);
 
-			auto t = LoadTextureFromImage(*img);
-
-			BeginTextureMode(runtime->viewport);
-			DrawTextureV(t, x, WHITE);
-			EndTextureMode();
-
-			UnloadTexture(t);
+			queue.texture(t, flipped, Rectangle{x.x, x.y, source.width, source.height}, WHITE, sampled);
 		} else if (luaL_testudata(L, 2, "rect")) {
-			Rect *src = *static_cast<Rect **>(luaL_checkudata(L, 2, "rect"));
+			Rect *src = check_value<Rect>(L, 2, "rect");
 			
 			if (luaL_testudata(L, 3, "rect")) { 
 				// draw(image, src, dest, {opt})
 
-				Rect *dst = *static_cast<Rect **>(luaL_checkudata(L, 3, "rect"));
+				Rect *dst = check_value<Rect>(L, 3, "rect");
 
 				Orbit::RlExt::CopyImageParams params;
 				if (lua_istable(L, 4)) params = parse_params(L, 4);
@@ -725,7 +703,7 @@ int draw(lua_State *L) {
 			} else if (luaL_testudata(L, 3, "quad")) { 
 				// draw(image, src, quad, {opt})
 
-				Quad *dst = *static_cast<Quad **>(luaL_checkudata(L, 3, "quad"));
+				Quad *dst = check_value<Quad>(L, 3, "quad");
 
 				Orbit::RlExt::CopyImageParams params;
 				if (lua_istable(L, 4)) params = parse_params(L, 4);
@@ -736,51 +714,31 @@ int draw(lua_State *L) {
 				Orbit::RlExt::CopyImageParams params;
 				if (lua_istable(L, 3)) params = parse_params(L, 3);
 
-				auto t = LoadTextureFromImage(*img);
-
-				BeginTextureMode(runtime->viewport);
-				DrawTexturePro(
+				queue.texture(
 					t,
-					{0, 0, static_cast<float>(t.width), static_cast<float>(t.height)},
+					flipped,
 					{ src->left(), src->top(), src->width(), src->height()},
-					{0, 0},
-					0,
-					WHITE
+					WHITE,
+					sampled
 				);
-				EndTextureMode();
-
-				UnloadTexture(t);
 			} 
 		} else if (luaL_testudata(L, 2, "quad")) {
-			Quad *dst = *static_cast<Quad **>(luaL_checkudata(L, 2, "quad"));
+			Quad *dst = check_value<Quad>(L, 2, "quad");
 
 			Orbit::RlExt::CopyImageParams params;
 			if (lua_istable(L, 3)) params = parse_params(L, 3);
 
-			auto t = LoadTextureFromImage(*img);
-			auto &s = runtime->shaders->invb;
-			auto srcRect = Rectangle{0, 0, (float)t.width, (float)t.height};
+			// The invb shader maps the whole texture, so this one is never drawn out of the atlas
+			auto own = img->texture();
+			auto srcRect = Rectangle{0, (float)own.height, (float)own.width, -(float)own.height};
 
-			BeginTextureMode(runtime->viewport);
-			BeginShaderMode(s.shader);
-			s.prepare(t, srcRect, dst->vertices);
-			Orbit::RlExt::DrawTexture(&t, &srcRect, dst->vertices, WHITE);
-			EndShaderMode();
-			EndTextureMode();
-
-			UnloadTexture(t);
+			queue.quad(own, srcRect, dst->vertices, WHITE, img);
 		}
 		else {
 			Orbit::RlExt::CopyImageParams params;
 			if (lua_istable(L, 2)) params = parse_params(L, 2);
 
-			auto t = LoadTextureFromImage(*img);
-
-			BeginTextureMode(runtime->viewport);
-			DrawTexture(t, 0, 0, WHITE);
-			EndTextureMode();
-
-			UnloadTexture(t);
+			queue.texture(t, flipped, Rectangle{0, 0, source.width, source.height}, WHITE, sampled);
 		}
 	} else if (luaL_testudata(L, 1, "point") && luaL_testudata(L, 2, "point")) {
 		Vector2 *v1 = static_cast<Vector2 *>(luaL_checkudata(L, 1, "point"));
@@ -788,16 +746,16 @@ int draw(lua_State *L) {
 		Color *c = static_cast<Color *>(luaL_testudata(L, 3, "color"));
 		float thickness = lua_tonumber(L, 4);
 
-		BeginTextureMode(runtime->viewport);
-		DrawLineEx(*v1, *v2, thickness ? thickness : 1, c ? *c : BLACK);
-		EndTextureMode();
+		queue.line(*v1, *v2, thickness ? thickness : 1, c ? *c : BLACK);
 	}
 
-
+	Orbit::profiler.close(mark);
 	return 0;
 }
 
 int clear(lua_State *L) {
+	const auto mark = Orbit::profiler.open("clear");
+
 	int count = lua_gettop(L);
 
 	switch (count) {
@@ -805,16 +763,13 @@ int clear(lua_State *L) {
 			Color *c = nullptr;
 		
 			auto* runtime = static_cast<Orbit::Lua::LuaRuntime*>(lua_touserdata(L, lua_upvalueindex(1)));
-		
-			BeginTextureMode(runtime->viewport);
+			if (runtime->viewport.id == 0) break;
 		
 			if ((c = static_cast<Color *>(luaL_testudata(L, 1, "point"))) != nullptr) {
-				ClearBackground(*c);
+				runtime->draw_queue.clear(*c);
 			} else {
-				ClearBackground(WHITE);
+				runtime->draw_queue.clear(WHITE);
 			}
-		
-			EndTextureMode();
 		}
 		break;
 
@@ -823,177 +778,383 @@ int clear(lua_State *L) {
 				Color *c = static_cast<Color *>(luaL_checkudata(L, 1, "color"));
 			
 				auto* runtime = static_cast<Orbit::Lua::LuaRuntime*>(lua_touserdata(L, lua_upvalueindex(1)));
+				if (runtime->viewport.id == 0) break;
 			
-				BeginTextureMode(runtime->viewport);
-				ClearBackground(*c);
-				EndTextureMode();
+				runtime->draw_queue.clear(*c);
 			} else if (luaL_testudata(L, 1, "image")) {
-				Image *i = static_cast<Image *>(luaL_checkudata(L, 1, "image"));
-				ImageClearBackground(i, WHITE);
+				Canvas *i = static_cast<Canvas *>(luaL_checkudata(L, 1, "image"));
+				i->clear(WHITE);
 			}
 		}
 		break;
 
 		case 2: {
-			Image *i = static_cast<Image *>(luaL_checkudata(L, 1, "image"));
-			Color *c = static_cast<Color *>(luaL_checkudata(L, 1, "point"));
-			ImageClearBackground(i, *c);
+			Canvas *i = static_cast<Canvas *>(luaL_checkudata(L, 1, "image"));
+			Color *c = static_cast<Color *>(luaL_checkudata(L, 2, "color"));
+			i->clear(*c);
 		}
 		break;
 	}
 
+	Orbit::profiler.close(mark);
 	return 0;
 }
 
 int log(lua_State *L) {
-	const char *text = luaL_checkstring(L, 1);
-
 	auto* runtime = static_cast<Orbit::Lua::LuaRuntime*>(lua_touserdata(L, lua_upvalueindex(1)));
 
-	runtime->logger->info(std::string("[script]: ") + text);
+	size_t length = 0;
+	const char *text = luaL_checklstring(L, 1, &length);
+
+	runtime->logger->info("[script]: {}", std::string_view(text, length));
 
 	return 0;
 }
 
-void parse_lingo_expr_tree(lua_State *L, mp::Node *nodes) {
-	if (nodes == nullptr) {
-		lua_pushnil(L);
-		return;
+// Pushes the values of a Lingo expression as they're parsed.
+//
+// The values of a collection wait on the stack, up to CHUNK of them, so that
+// its table is created with the right size when there are few; past that they
+// are moved into the table a chunk at a time, so the stack grows with the
+// nesting and not with the length. The arguments of point(), rect() and
+// color() are kept aside until the call ends.
+class LingoPusher : public mp::handler {
+
+	static constexpr int CHUNK = 256;
+
+	struct Frame {
+		enum class Kind : uint8_t { List, Props, Call } kind;
+		// point, rect or color, or nullptr for other calls
+		const char *call;
+		// the stack index of the table of a collection, with the values waiting
+		// above it; before there's a table, where it goes
+		int base;
+		bool table;
+		// values in the table, and waiting
+		int count;
+		int waiting;
+		float args[4];
+		bool whole[4];
+	};
+
+	lua_State *L;
+	std::vector<Frame> _frames;
+
+	void _reserve(int slots) {
+		if (!lua_checkstack(L, slots)) throw mp::parse_failure("expression is nested too deeply");
 	}
 
-	auto *v = dynamic_cast<mp::Void *>(nodes);
-	if (v) {
-		lua_pushnil(L);
-		return;
+	// Keeps the number for the call it's an argument of.
+	bool _argument(float number, bool whole) {
+		if (_frames.empty() || _frames.back().kind != Frame::Kind::Call) return false;
+
+		auto &frame = _frames.back();
+
+		if (frame.count < 4) {
+			frame.args[frame.count] = number;
+			frame.whole[frame.count] = whole;
+		}
+
+		frame.count++;
+		return true;
+	}
+
+	// Moves the waiting values of the collection into its table, creating it
+	// if there's none yet.
+	void _move(Frame &frame) {
+		_reserve(3);
+
+		const bool list = frame.kind == Frame::Kind::List;
+
+		if (!frame.table) {
+			lua_createtable(L, list ? frame.waiting : 0, list ? 0 : frame.waiting);
+			lua_insert(L, frame.base);
+			frame.table = true;
+		}
+
+		if (list) {
+			for (int i = 1; i <= frame.waiting; i++) {
+				lua_pushvalue(L, frame.base + i);
+				lua_rawseti(L, frame.base, frame.count + i);
+			}
+		} else {
+			// In order, so that the last of repeated keys wins
+			for (int i = 0; i < frame.waiting; i++) {
+				lua_pushvalue(L, frame.base + 2 * i + 1);
+				lua_pushvalue(L, frame.base + 2 * i + 2);
+				lua_rawset(L, frame.base);
+			}
+		}
+
+		lua_settop(L, frame.base);
+
+		frame.count += frame.waiting;
+		frame.waiting = 0;
+	}
+
+	// Counts the value on top of the stack in its collection.
+	void _added() {
+		if (_frames.empty()) return;
+
+		auto &frame = _frames.back();
+
+		// Other arguments have no use
+		if (frame.kind == Frame::Kind::Call) {
+			if (frame.count < 4) {
+				frame.args[frame.count] = 0;
+				frame.whole[frame.count] = false;
+			}
+
+			lua_pop(L, 1);
+			frame.count++;
+			return;
+		}
+
+		if (++frame.waiting == CHUNK) _move(frame);
+	}
+
+	void _begin(Frame::Kind kind) {
+		_frames.push_back(Frame{ kind, nullptr, lua_gettop(L) + 1, false, 0, 0, {}, {} });
+	}
+
+	// Leaves the finished table on top of the stack, in place of its values.
+	void _end() {
+		auto frame = _frames.back();
+		_frames.pop_back();
+
+		_move(frame);
+		_added();
 	}
 
-	auto *integer = dynamic_cast<mp::Int *>(nodes);
-	if (integer) {
-		lua_pushinteger(L, integer->number);
-		return;
+public:
+
+	void on_void() override {
+		_reserve(1);
+		lua_pushnil(L);
+		_added();
 	}
 
-	auto *floating = dynamic_cast<mp::Float *>(nodes);
-	if (floating) {
-		lua_pushnumber(L, floating->number);
-		return;
+	void on_integer(int number) override {
+		if (_argument(static_cast<float>(number), true)) return;
+
+		_reserve(1);
+		lua_pushinteger(L, number);
+		_added();
 	}
 
-	auto *str = dynamic_cast<mp::String *>(nodes);
-	if (str) {
-		lua_pushstring(L, str->str.c_str());
-		return;
+	void on_floating(float number) override {
+		if (_argument(number, false)) return;
+
+		_reserve(1);
+		lua_pushnumber(L, number);
+		_added();
 	}
 
-	auto *sym = dynamic_cast<mp::Symbol *>(nodes);
-	if (sym) {
-		lua_pushstring(L, sym->str.c_str());
-		return;
+	void on_string(std::string_view str) override {
+		_reserve(1);
+		lua_pushlstring(L, str.data(), str.size());
+		_added();
 	}
 
-	auto *list = dynamic_cast<mp::List *>(nodes);
-	if (list) {
-		lua_newtable(L);
-		for (int i = 0; i < list->elements.size(); i++) {
-			parse_lingo_expr_tree(L, list->elements[i].get());
-			lua_rawseti(L, -2, i+1);
+	void on_symbol(std::string_view str) override { on_string(str); }
+
+	void begin_list() override { _begin(Frame::Kind::List); }
+	void end_list() override { _end(); }
+
+	// Straight into the table, without waiting on the stack
+	void on_integers(const int32_t *numbers, size_t count) override {
+		_reserve(2);
+		lua_createtable(L, static_cast<int>(count), 0);
+
+		for (size_t i = 0; i < count; i++) {
+			lua_pushinteger(L, numbers[i]);
+			lua_rawseti(L, -2, static_cast<lua_Integer>(i + 1));
 		}
-		return;
+
+		_added();
 	}
 
-	auto *props = dynamic_cast<mp::Props *>(nodes);
-	if (props) {
-		lua_newtable(L);
-		for (auto &p : props->map) {
-			lua_pushstring(L, p.first.c_str());
-			parse_lingo_expr_tree(L, p.second.get());
-			lua_settable(L, -3);
+	void on_floats(const float *numbers, size_t count) override {
+		_reserve(2);
+		lua_createtable(L, static_cast<int>(count), 0);
+
+		for (size_t i = 0; i < count; i++) {
+			lua_pushnumber(L, numbers[i]);
+			lua_rawseti(L, -2, static_cast<lua_Integer>(i + 1));
 		}
-		return;
+
+		_added();
+	}
+
+	void begin_props() override { _begin(Frame::Kind::Props); }
+	void end_props() override { _end(); }
+
+	void on_key(std::string_view key) override {
+		_reserve(2);
+		lua_pushlstring(L, key.data(), key.size());
 	}
 
-	//
+	void begin_call(std::string_view name) override {
+		const char *call = nullptr;
 
-	auto *gcall = dynamic_cast<mp::GCall *>(nodes);
-	if (gcall) {
-		auto &name = gcall->name;
+		if (name == "point") call = "point";
+		else if (name == "rect") call = "rect";
+		else if (name == "color") call = "color";
 
-		if (name == "point") {
-			auto *argi1 = dynamic_cast<mp::Int *>(gcall->args[0].get());
-			auto *argf1 = dynamic_cast<mp::Float *>(gcall->args[0].get());
-			auto *argi2 = dynamic_cast<mp::Int *>(gcall->args[1].get());
-			auto *argf2 = dynamic_cast<mp::Float *>(gcall->args[1].get());
+		_frames.push_back(Frame{ Frame::Kind::Call, call, 0, false, 0, 0, {}, {} });
+	}
+
+	void end_call() override {
+		const auto frame = _frames.back();
+		_frames.pop_back();
+
+		_reserve(2);
 
+		const auto *args = frame.args;
+
+		if (frame.call == nullptr) {
+			lua_pushnil(L);
+		}
+		else if (std::strcmp(frame.call, "point") == 0) {
 			Vector2 *v = static_cast<Vector2 *>(lua_newuserdata(L, sizeof(Vector2)));
 
-			v->x = argi1 ? argi1->number : (argf1 ? argf1->number : 0);
-			v->y = argi2 ? argi2->number : (argf2 ? argf2->number : 0);
+			v->x = args[0];
+			v->y = args[1];
 
 			luaL_getmetatable(L, "point");
 			lua_setmetatable(L, -2);
-			return;
 		}
+		else if (std::strcmp(frame.call, "rect") == 0) {
+			push_value(L, Rect(args[0], args[1], args[2], args[3]), "rect");
+		}
+		else {
+			Color *c = static_cast<Color *>(lua_newuserdata(L, sizeof(Color)));
 
-		if (name == "rect") {
-			auto *argi1 = dynamic_cast<mp::Int *>(gcall->args[0].get());
-			auto *argf1 = dynamic_cast<mp::Float *>(gcall->args[0].get());
-			
-			auto *argi2 = dynamic_cast<mp::Int *>(gcall->args[1].get());
-			auto *argf2 = dynamic_cast<mp::Float *>(gcall->args[1].get());
-			
-			auto *argi3 = dynamic_cast<mp::Int *>(gcall->args[2].get());
-			auto *argf3 = dynamic_cast<mp::Float *>(gcall->args[2].get());
-			
-			auto *argi4 = dynamic_cast<mp::Int *>(gcall->args[3].get());
-			auto *argf4 = dynamic_cast<mp::Float *>(gcall->args[3].get());
-		
-			Rect **r = static_cast<Rect **>(lua_newuserdata(L, sizeof(Rect *)));
-
-			auto *newRect = new Rect(
-				argi1 ? argi1->number : (argf1 ? argf1->number : 0),
-				argi2 ? argi2->number : (argf2 ? argf2->number : 0),
-				argi3 ? argi3->number : (argf3 ? argf3->number : 0),
-				argi4 ? argi4->number : (argf4 ? argf4->number : 0)
-			);
+			// Channels have to be whole numbers
+			const auto channel = [&](int index) -> unsigned char {
+				return frame.whole[index] ? static_cast<int>(args[index]) : 0;
+			};
 
-			*r = newRect;
+			c->r = channel(0);
+			c->g = channel(1);
+			c->b = channel(2);
+			c->a = 255;
 
-			luaL_getmetatable(L, "rect");
+			luaL_getmetatable(L, "color");
 			lua_setmetatable(L, -2);
 		}
 
-		if (name == "color") {
-			auto *argi1 = dynamic_cast<mp::Int *>(gcall->args[0].get());
-			auto *argi2 = dynamic_cast<mp::Int *>(gcall->args[1].get());
-			auto *argi3 = dynamic_cast<mp::Int *>(gcall->args[2].get());
+		_added();
+	}
 
-			Color *c = static_cast<Color *>(lua_newuserdata(L, sizeof(Color)));
+	LingoPusher(lua_State *L) : L(L), _frames({}) {}
+};
 
-			c->r = argi1 ? argi1->number : 0;
-			c->g = argi2 ? argi2->number : 0;
-			c->b = argi3 ? argi3->number : 0;
-			c->a = 255;
+int parse_lingo_expr(lua_State *L) {
+	size_t length = 0;
+	const char *expr = luaL_checklstring(L, 1, &length);
 
-			luaL_getmetatable(L, "color");
-			lua_setmetatable(L, -2);
-			return;
+	const int top = lua_gettop(L);
+	char error[256] = "";
+
+	try {
+		LingoPusher pusher(L);
+		mp::parse(std::string_view(expr, length), pusher);
+	} catch (const std::exception &e) {
+		std::snprintf(error, sizeof(error), "%s", e.what());
+	}
+
+	// Raised out here, where nothing is left to be destroyed
+	if (error[0] != '\0') {
+		lua_settop(L, top);
+		return luaL_error(L, "fromLingo: %s", error);
+	}
+
+	if (lua_gettop(L) == top) lua_pushnil(L);
+
+	return 1;
+}
+
+// fromLingoFile(path): the values of the file's non-void lines, parsed in parallel
+int parse_lingo_file(lua_State *L) {
+	auto *runtime = static_cast<Orbit::Lua::LuaRuntime*>(lua_touserdata(L, lua_upvalueindex(1)));
+
+	const char *path = luaL_checkstring(L, 1);
+
+	const int top = lua_gettop(L);
+	char error[256] = "";
+
+	try {
+		std::filesystem::path file(path);
+		if (file.is_relative()) file = runtime->paths->data() / file;
+
+		const auto trees = Orbit::Lua::read_lingo_file(file);
+
+		lua_createtable(L, static_cast<int>(trees.size()), 0);
+		const int list = lua_gettop(L);
+
+		LingoPusher pusher(L);
+		lua_Integer count = 0;
+
+		// Empty lines, and lines that are void, are skipped, so the list has no holes
+		for (const auto &line : trees) {
+			if (line.empty()) continue;
+
+			mp::parse(line, pusher);
+
+			if (lua_gettop(L) == list) continue;
+
+			if (lua_isnil(L, -1)) lua_pop(L, 1);
+			else lua_rawseti(L, list, ++count);
 		}
+	} catch (const std::exception &e) {
+		std::snprintf(error, sizeof(error), "%s", e.what());
+	}
 
-		lua_pushnil(L);
-		return;
+	if (error[0] != '\0') {
+		lua_settop(L, top);
+		return luaL_error(L, "fromLingoFile: %s", error);
 	}
+
+	return 1;
 }
 
-int parse_lingo_expr(lua_State *L) {
-	const char *expr_cstr = luaL_checkstring(L, 1);
-	const std::string expr_str(expr_cstr);
+int write_lingo_expr(lua_State *L) {
+	luaL_checkany(L, 1);
+
+	const int top = lua_gettop(L);
+	char error[256] = "";
 
-	auto nodes = mp::parse(expr_str);
+	try {
+		Orbit::Lua::LingoWriter writer;
+		writer.write(L, 1);
+
+		lua_pushlstring(L, writer.str().data(), writer.str().size());
+	} catch (const std::exception &e) {
+		std::snprintf(error, sizeof(error), "%s", e.what());
+	}
+
+	if (error[0] != '\0') {
+		lua_settop(L, top);
+		return luaL_error(L, "toLingo: %s", error);
+	}
 
-	parse_lingo_expr_tree(L, nodes.get());
 	return 1;
 }
 
+// pcall and xpcall while profiling, with the base one as the upvalue. An error
+// they catch may have cut the profiler's scopes short, so its depth is put back.
+int protected_call(lua_State *L) {
+	const int depth = Orbit::profiler.depth();
+
+	lua_pushvalue(L, lua_upvalueindex(1));
+	lua_insert(L, 1);
+	lua_call(L, lua_gettop(L) - 1, LUA_MULTRET);
+
+	Orbit::profiler.restore(depth);
+	return lua_gettop(L);
+}
+
 int string_split(lua_State *L) {
 	if (lua_isnil(L, 1) || lua_isnil(L, 2)) return luaL_error(L, "invalid 'split()' arguments");
 
@@ -1040,6 +1201,15 @@ int string_split(lua_State *L) {
 namespace Orbit::Lua {
 
 void LuaRuntime::_register_utils() {
+	// only the profiler needs them, and they cost every protected call a C frame
+	if (Orbit::profiler.enabled()) {
+		for (const char *name : { "pcall", "xpcall" }) {
+			lua_getglobal(L, name);
+			lua_pushcclosure(L, protected_call, 1);
+			lua_setglobal(L, name);
+		}
+	}
+
 	lua_pushcfunction(L, distance);
 	lua_setglobal(L, "distance");
 
@@ -1086,7 +1256,8 @@ void LuaRuntime::_register_utils() {
 	lua_pushcclosure(L, draw, 1);
 	lua_setglobal(L, "draw");
 
-	lua_pushcfunction(L, log);
+	lua_pushlightuserdata(L, this);
+	lua_pushcclosure(L, log, 1);
 	lua_setglobal(L, "log");
 
 	lua_pushlightuserdata(L, this);
@@ -1096,6 +1267,13 @@ void LuaRuntime::_register_utils() {
 	lua_pushcfunction(L, parse_lingo_expr);
 	lua_setglobal(L, "fromLingo");
 
+	lua_pushlightuserdata(L, this);
+	lua_pushcclosure(L, parse_lingo_file, 1);
+	lua_setglobal(L, "fromLingoFile");
+
+	lua_pushcfunction(L, write_lingo_expr);
+	lua_setglobal(L, "toLingo");
+
 	lua_pushcfunction(L, string_split);
 	lua_setglobal(L, "split");
 }
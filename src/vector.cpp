@@ -7,6 +7,8 @@
 
 #include <Orbit/Lua/runtime.h>
 #include <Orbit/Lua/vector.h>
+#include <Orbit/Lua/userdata.h>
+#include <Orbit/Lua/fields.h>
 
 #include <xsimd/xsimd.hpp>
 
@@ -18,11 +20,16 @@ extern "C" {
 
 #define META "vector"
 
+static constexpr auto FIELDS = Orbit::Lua::fields("x", "y", "z", "w");
+
 namespace Orbit::Lua {
 
+// The four components, without reading the padding that a full register would cover
+using lanes = xsimd::make_sized_batch_t<float, 4>;
+
 float Vector::distance(Vector const &v) const {
-	auto a = xsimd::load_aligned(_data);
-	auto b = xsimd::load_aligned(v._data);
+	auto a = lanes::load_aligned(_data);
+	auto b = lanes::load_aligned(v._data);
 
 	auto diff = xsimd::sub(a, b);
 
@@ -32,10 +39,10 @@ float Vector::distance(Vector const &v) const {
 }
 
 Vector Vector::mix(Vector const &v, float t) const {
-	auto a = xsimd::load_aligned(_data);
-	auto b = xsimd::load_aligned(v._data);
+	auto a = lanes::load_aligned(_data);
+	auto b = lanes::load_aligned(v._data);
 
-	auto simd_t = xsimd::broadcast<float>(t);
+	auto simd_t = lanes(t);
 
 	auto diff = xsimd::sub(b, a);
 	auto scaled = xsimd::mul(simd_t, diff);
@@ -74,8 +81,8 @@ std::string Vector::tostring() const {
 }
 
 Vector Vector::operator+(Vector const &v) const {
-	auto ba = xsimd::load_aligned(_data);
-	auto bb = xsimd::load_aligned(v._data);
+	auto ba = lanes::load_aligned(_data);
+	auto bb = lanes::load_aligned(v._data);
 
 	auto res = ba + bb;
 
@@ -87,8 +94,8 @@ Vector Vector::operator+(Vector const &v) const {
 }
 
 Vector Vector::operator-(Vector const &v) const {
-	auto ba = xsimd::load_aligned(_data);
-	auto bb = xsimd::load_aligned(v._data);
+	auto ba = lanes::load_aligned(_data);
+	auto bb = lanes::load_aligned(v._data);
 
 	auto res = ba - bb;
 
@@ -100,7 +107,7 @@ Vector Vector::operator-(Vector const &v) const {
 }
 
 Vector Vector::operator*(float f) const {
-	auto ba = xsimd::load_aligned(_data);
+	auto ba = lanes::load_aligned(_data);
 
 	auto res = ba * f;
 
@@ -112,7 +119,7 @@ Vector Vector::operator*(float f) const {
 }
 
 Vector Vector::operator/(float f) const {
-	auto ba = xsimd::load_aligned(_data);
+	auto ba = lanes::load_aligned(_data);
 
 	auto res = ba / f;
 
@@ -167,73 +174,48 @@ void LuaRuntime::_register_vector() {
 		float z = luaL_checknumber(L, 3);
 		float w = luaL_checknumber(L, 4);
 
-		Vector *p = new Vector(x, y, z, w);
-
-		Vector **u_data = static_cast<Vector **>(lua_newuserdata(L, sizeof(Vector*)));
-		*u_data = p;
-
-		luaL_getmetatable(L, META);
-		lua_setmetatable(L, -2);
+		push_value(L, Vector(x, y, z, w), META);
 	
 		return 1;
 	};
 
 	const auto read = [](lua_State *L) {
-		Vector *p = *static_cast<Vector **>(luaL_checkudata(L, 1, META));
-		const char *field = luaL_checkstring(L, 2);
+		Vector *p = check_value<Vector>(L, 1, META);
+		const int field = FIELDS.find(L, 2);
 
-		if (std::strcmp(field, "x") == 0) lua_pushnumber(L, p->_data[0]);
-		else if (std::strcmp(field, "y") == 0) lua_pushnumber(L, p->_data[1]);
-		else if (std::strcmp(field, "z") == 0) lua_pushnumber(L, p->_data[2]);
-		else if (std::strcmp(field, "w") == 0) lua_pushnumber(L, p->_data[3]);
+		// The fields are the components, in order
+		if (field >= 0) lua_pushnumber(L, p->_data[field]);
 		else lua_pushnil(L);
 
 		return 1;
 	};
 
 	const auto write = [](lua_State *L) {
-		Vector *p = *static_cast<Vector **>(luaL_checkudata(L, 1, META));
+		Vector *p = check_value<Vector>(L, 1, META);
 
-		const char *field = luaL_checkstring(L, 2);
+		const int field = FIELDS.find(L, 2);
 		float value = luaL_checknumber(L, 3);
 
-		if (std::strcmp(field, "x") == 0) p->_data[0] = value;
-		else if (std::strcmp(field, "y") == 0) p->_data[1] = value;
-		else if (std::strcmp(field, "z") == 0) p->_data[2] = value;
-		else if (std::strcmp(field, "w") == 0) p->_data[3] = value;
-		else luaL_error(L, "invalid field '%s' in point", field);
+		if (field >= 0) p->_data[field] = value;
+		else luaL_error(L, "invalid field '%s' in point", lua_tostring(L, 2));
 
 		return 0;
 	};
 
 	const auto add = [](lua_State *L) {
-		Vector a = **static_cast<Vector **>(luaL_checkudata(L, 1, META));
-		Vector b = **static_cast<Vector **>(luaL_checkudata(L, 2, META));
-		
-		Vector *res = new Vector();
-		*res = a + b;
+		const Vector *a = check_value<Vector>(L, 1, META);
+		const Vector *b = check_value<Vector>(L, 2, META);
 
-		Vector **u_data = static_cast<Vector **>(lua_newuserdata(L, sizeof(Vector*)));
-		*u_data = res;
-
-		luaL_getmetatable(L, META);
-		lua_setmetatable(L, -2);
+		push_value(L, *a + *b, META);
 
 		return 1;
 	};
 
 	const auto subtract = [](lua_State *L) {
-		Vector a = **static_cast<Vector **>(luaL_checkudata(L, 1, META));
-		Vector b = **static_cast<Vector **>(luaL_checkudata(L, 2, META));
-			
-		Vector *res = new Vector();
-		*res = a - b;
-
-		Vector **u_data = static_cast<Vector **>(lua_newuserdata(L, sizeof(Vector*)));
-		*u_data = res;
+		const Vector *a = check_value<Vector>(L, 1, META);
+		const Vector *b = check_value<Vector>(L, 2, META);
 
-		luaL_getmetatable(L, META);
-		lua_setmetatable(L, -2);
+		push_value(L, *a - *b, META);
 
 		return 1;
 	};
@@ -242,10 +224,10 @@ void LuaRuntime::_register_vector() {
 		Vector *v = nullptr;
 		float n = 0.0f;
 		
-		if ((v = *static_cast<Vector **>(luaL_testudata(L, 1, META))) != nullptr && lua_isnumber(L, 2)) {
+		if ((v = test_value<Vector>(L, 1, META)) != nullptr && lua_isnumber(L, 2)) {
 			n = static_cast<float>(lua_tonumber(L, 2));
 		}
-		else if ((v = *static_cast<Vector **>(luaL_testudata(L, 2, META))) != nullptr && lua_isnumber(L, 1)) {
+		else if ((v = test_value<Vector>(L, 2, META)) != nullptr && lua_isnumber(L, 1)) {
 
 			n = static_cast<float>(lua_tonumber(L, 1));
 		}
@@ -253,19 +235,7 @@ void LuaRuntime::_register_vector() {
 			return luaL_error(L, "invalid operands to vector multiplication");
 		}
 
-		Vector *res = new Vector();
-
-		auto r = *v * n;
-			
-		*res = r;
-
-		Vector **u_data = static_cast<Vector **>(lua_newuserdata(L, sizeof(Vector*)));
-		*u_data = res;
-
-		//*res = (*v) * n;
-
-		luaL_getmetatable(L, META);
-		lua_setmetatable(L, -2);
+		push_value(L, *v * n, META);
 
 		return 1;
 	};
@@ -274,10 +244,10 @@ void LuaRuntime::_register_vector() {
 		Vector *v = nullptr;
 		float n = 0.0f;
 		
-		if ((v = *static_cast<Vector **>(luaL_testudata(L, 1, META))) != nullptr && lua_isnumber(L, 2)) {
+		if ((v = test_value<Vector>(L, 1, META)) != nullptr && lua_isnumber(L, 2)) {
 			n = static_cast<float>(lua_tonumber(L, 2));
 		}
-		else if ((v = *static_cast<Vector **>(luaL_testudata(L, 2, META))) != nullptr && lua_isnumber(L, 1)) {
+		else if ((v = test_value<Vector>(L, 2, META)) != nullptr && lua_isnumber(L, 1)) {
 
 			n = static_cast<float>(lua_tonumber(L, 1));
 		}
@@ -285,27 +255,15 @@ void LuaRuntime::_register_vector() {
 			return luaL_error(L, "invalid operands to vector multiplication");
 		}
 
-		Vector *res = new Vector();
-
-		auto r = *v / n;
-			
-		*res = r;
-
-		Vector **u_data = static_cast<Vector **>(lua_newuserdata(L, sizeof(Vector*)));
-		*u_data = res;
-
-		//*res = (*v) * n;
-
-		luaL_getmetatable(L, META);
-		lua_setmetatable(L, -2);
+		push_value(L, *v / n, META);
 
 		return 1;
 	};
 	const auto equals = [](lua_State *L) {
-		Vector a = **static_cast<Vector **>(luaL_checkudata(L, 1, META));
-		Vector b = **static_cast<Vector **>(luaL_checkudata(L, 2, META));
+		const Vector *a = check_value<Vector>(L, 1, META);
+		const Vector *b = check_value<Vector>(L, 2, META);
 		
-		bool res = a == b;
+		bool res = *a == *b;
 
 		lua_pushboolean(L, res);
 
@@ -313,7 +271,7 @@ void LuaRuntime::_register_vector() {
 	};
 
 	const auto tostring = [](lua_State *L) {
-		Vector *v = *static_cast<Vector **>(luaL_checkudata(L, 1, META));
+		Vector *v = check_value<Vector>(L, 1, META);
 		
 		auto str = v->tostring();	
 
@@ -359,13 +317,6 @@ void LuaRuntime::_register_vector() {
 	lua_pushcfunction(L, equals);
 	lua_setfield(L, -2, "__eq");
 
-	lua_pushcfunction(L, [](lua_State *L){
-		Vector *ptr = *static_cast<Vector **>(lua_touserdata(L, 1));
-		delete ptr;
-		return 0;
-	});
-	lua_setfield(L, -2, "__gc");
-
 	lua_pop(L, 1);
 
 }
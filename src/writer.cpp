@@ -0,0 +1,307 @@
+#include <Orbit/Lua/writer.h>
+#include <Orbit/Lua/userdata.h>
+#include <Orbit/Lua/rect.h>
+#include <Orbit/Lua/quad.h>
+
+#include <cmath>
+#include <vector>
+#include <cstring>
+#include <charconv>
+#include <algorithm>
+#include <stdexcept>
+
+#include <raylib.h>
+
+extern "C" {
+    #include <lua.h>
+    #include <lauxlib.h>
+}
+
+namespace Orbit::Lua {
+
+namespace {
+
+// A key of a property list, borrowed from the table.
+struct Key {
+	bool integer;
+	lua_Integer number;
+	std::string_view str;
+};
+
+// Symbols only hold what the lexer reads after a '#'
+bool is_symbol(std::string_view str) {
+	if (str.empty()) return false;
+
+	for (const char c : str) {
+		if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'))) return false;
+	}
+
+	return true;
+}
+
+};
+
+void LingoWriter::_array(const Array &array, size_t *indexes, int dimension) {
+	const size_t length = array.shape(dimension);
+	const bool last = dimension == array.dimensions() - 1;
+
+	_put('[');
+
+	for (size_t i = 0; i < length; i++) {
+		if (i > 0) _put(", ");
+
+		indexes[dimension] = i;
+
+		if (!last) _array(array, indexes, dimension + 1);
+		else if (array.type() == Array::Type::Float32) _float(array.get(indexes));
+		else _integer(static_cast<lua_Integer>(array.get(indexes)));
+	}
+
+	_put(']');
+
+	if (_file != nullptr && _buffer.size() >= FLUSH_SIZE) flush();
+}
+
+void LingoWriter::_integer(lua_Integer number) {
+	char digits[24];
+	const auto result = std::to_chars(digits, digits + sizeof(digits), number);
+	_put(std::string_view(digits, result.ptr - digits));
+}
+
+// Director prints floats with its default floatPrecision of 4
+void LingoWriter::_float(double number) {
+	if (std::isnan(number)) { _put("NAN"); return; }
+	if (std::isinf(number)) { _put(number < 0 ? "-INF" : "INF"); return; }
+
+	char digits[64];
+	const auto result = std::to_chars(digits, digits + sizeof(digits), number, std::chars_format::fixed, 4);
+
+	if (result.ec != std::errc()) throw std::invalid_argument("number is too large for Lingo");
+
+	_put(std::string_view(digits, result.ptr - digits));
+}
+
+void LingoWriter::_coordinate(float number) {
+	if (std::floor(number) == number && std::fabs(number) < 1e9f) _integer(static_cast<lua_Integer>(number));
+	else _float(number);
+}
+
+// Lingo strings can't hold quotes or line breaks; they're concatenated in.
+void LingoWriter::_string(std::string_view str) {
+	if (str.empty()) { _put("\"\""); return; }
+
+	bool first = true;
+	size_t start = 0;
+
+	const auto text = [&](size_t end) {
+		if (end == start) return;
+		if (!first) _put(" & ");
+
+		_put('"');
+		_put(str.substr(start, end - start));
+		_put('"');
+
+		first = false;
+	};
+
+	for (size_t i = 0; i < str.size(); i++) {
+		const char c = str[i];
+		if (c != '"' && c != '\n' && c != '\r') continue;
+
+		text(i);
+
+		if (!first) _put(" & ");
+		_put(c == '"' ? "QUOTE" : "RETURN");
+		first = false;
+
+		// One RETURN for a CRLF
+		if (c == '\r' && i + 1 < str.size() && str[i + 1] == '\n') i++;
+
+		start = i + 1;
+	}
+
+	text(str.size());
+}
+
+void LingoWriter::_table(lua_State *L, int index, int depth) {
+	if (depth >= MAX_DEPTH) throw std::invalid_argument("table is nested too deeply, or contains itself");
+	if (!lua_checkstack(L, 3)) throw std::invalid_argument("table is nested too deeply");
+
+	std::vector<Key> keys;
+	// The largest key, while they're all positive integers
+	lua_Integer length = 0;
+
+	lua_pushnil(L);
+
+	while (lua_next(L, index) != 0) {
+		lua_pop(L, 1);
+
+		if (lua_type(L, -1) == LUA_TNUMBER && lua_isinteger(L, -1)) {
+			const auto number = lua_tointeger(L, -1);
+
+			if (length >= 0) length = number > 0 ? std::max(length, number) : -1;
+
+			keys.push_back(Key{ true, number, {} });
+		}
+		else if (lua_type(L, -1) == LUA_TSTRING) {
+			size_t size = 0;
+			const char *str = lua_tolstring(L, -1, &size);
+
+			length = -1;
+			keys.push_back(Key{ false, 0, std::string_view(str, size) });
+		}
+		else {
+			throw std::invalid_argument(std::string("a ") + luaL_typename(L, -1) + " key can't be written as Lingo");
+		}
+	}
+
+	// A list that had voids in it comes back with holes; they're filled in
+	// again, unless it's mostly holes.
+	if (length >= 0 && length <= static_cast<lua_Integer>(keys.size()) * 2) {
+		_put('[');
+
+		for (lua_Integer i = 1; i <= length; i++) {
+			if (i > 1) _put(", ");
+
+			lua_rawgeti(L, index, i);
+			_value(L, lua_gettop(L), depth + 1);
+			lua_pop(L, 1);
+		}
+
+		_put(']');
+		return;
+	}
+
+	// Lua forgets the order, so the output is at least always the same
+	std::sort(keys.begin(), keys.end(), [](const Key &a, const Key &b) {
+		if (a.integer != b.integer) return a.integer;
+		return a.integer ? a.number < b.number : a.str < b.str;
+	});
+
+	_put('[');
+
+	for (size_t i = 0; i < keys.size(); i++) {
+		const auto &key = keys[i];
+
+		if (i > 0) _put(", ");
+
+		if (key.integer) {
+			_integer(key.number);
+			lua_pushinteger(L, key.number);
+		} else {
+			if (is_symbol(key.str)) {
+				_put('#');
+				_put(key.str);
+			}
+			else _string(key.str);
+
+			lua_pushlstring(L, key.str.data(), key.str.size());
+		}
+
+		_put(": ");
+
+		lua_rawget(L, index);
+		_value(L, lua_gettop(L), depth + 1);
+		lua_pop(L, 1);
+	}
+
+	_put(']');
+}
+
+void LingoWriter::_value(lua_State *L, int index, int depth) {
+	switch (lua_type(L, index)) {
+		case LUA_TNIL: _put("void"); break;
+
+		// TRUE and FALSE are numbers in Lingo
+		case LUA_TBOOLEAN: _put(lua_toboolean(L, index) ? '1' : '0'); break;
+
+		case LUA_TNUMBER:
+		if (lua_isinteger(L, index)) _integer(lua_tointeger(L, index));
+		else _float(lua_tonumber(L, index));
+		break;
+
+		case LUA_TSTRING: {
+			size_t size = 0;
+			const char *str = lua_tolstring(L, index, &size);
+			_string(std::string_view(str, size));
+		}
+		break;
+
+		case LUA_TTABLE: _table(L, index, depth); break;
+
+		case LUA_TUSERDATA: {
+			if (const auto *p = static_cast<const Vector2 *>(luaL_testudata(L, index, "point"))) {
+				_put("point(");
+				_coordinate(p->x);
+				_put(", ");
+				_coordinate(p->y);
+				_put(')');
+			}
+			else if (const auto *r = test_value<Rect>(L, index, "rect")) {
+				_put("rect(");
+				_coordinate(r->left());
+				_put(", ");
+				_coordinate(r->top());
+				_put(", ");
+				_coordinate(r->right());
+				_put(", ");
+				_coordinate(r->bottom());
+				_put(')');
+			}
+			else if (const auto *c = static_cast<const Color *>(luaL_testudata(L, index, "color"))) {
+				_put("color(");
+				_integer(c->r);
+				_put(", ");
+				_integer(c->g);
+				_put(", ");
+				_integer(c->b);
+				_put(')');
+			}
+			else if (const auto *q = test_value<Quad>(L, index, "quad")) {
+				_put('[');
+
+				for (int v = 0; v < 4; v++) {
+					if (v > 0) _put(", ");
+					_put("point(");
+					_coordinate(q->vertices[v].x);
+					_put(", ");
+					_coordinate(q->vertices[v].y);
+					_put(')');
+				}
+
+				_put(']');
+			}
+			else if (const auto *a = static_cast<const Array *>(luaL_testudata(L, index, "array"))) {
+				size_t indexes[Array::MAX_DIMENSIONS] = {};
+				_array(*a, indexes, 0);
+			}
+			else throw std::invalid_argument("this userdata can't be written as Lingo");
+		}
+		break;
+
+		default:
+		throw std::invalid_argument(std::string("a ") + luaL_typename(L, index) + " can't be written as Lingo");
+	}
+
+	if (_file != nullptr && _buffer.size() >= FLUSH_SIZE) flush();
+}
+
+void LingoWriter::write(lua_State *L, int index) {
+	_value(L, lua_absindex(L, index), 0);
+}
+
+void LingoWriter::flush() {
+	if (_file == nullptr || _buffer.empty()) return;
+
+	if (std::fwrite(_buffer.data(), 1, _buffer.size(), _file) != _buffer.size()) {
+		throw std::runtime_error("failed to write to the file");
+	}
+
+	_buffer.clear();
+}
+
+LingoWriter::LingoWriter(std::FILE *file) : _buffer(""), _file(file) {
+	_buffer.reserve(file != nullptr ? FLUSH_SIZE * 2 : 4096);
+}
+
+};
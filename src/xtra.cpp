@@ -1,6 +1,15 @@
+#include <cstdio>
 #include <string>
+#include <utility>
+#include <exception>
+#include <filesystem>
 
 #include <Orbit/Lua/runtime.h>
+#include <Orbit/Lua/writer.h>
+#include <Orbit/RlExt/canvas.h>
+#include <Orbit/profiler.h>
+
+#include <raylib.h>
 
 extern "C" {
     #include <lua.h>
@@ -9,6 +18,150 @@ extern "C" {
 }
 
 using std::string;
+using Orbit::RlExt::Canvas;
+
+// ix_saveImage({ image = img, filename = "path.png" })
+int ix_save_image(lua_State *L) {
+    const auto mark = Orbit::profiler.open("ix_saveImage");
+
+    luaL_checktype(L, 1, LUA_TTABLE);
+
+    auto* runtime = static_cast<Orbit::Lua::LuaRuntime*>(lua_touserdata(L, lua_upvalueindex(1)));
+
+    lua_getfield(L, 1, "image");
+    Canvas *img = static_cast<Canvas *>(luaL_checkudata(L, -1, "image"));
+
+    lua_getfield(L, 1, "filename");
+    std::filesystem::path file(luaL_checkstring(L, -1));
+
+    if (file.is_relative()) file = runtime->output() / file;
+
+    std::error_code ec;
+    if (file.has_parent_path()) std::filesystem::create_directories(file.parent_path(), ec);
+
+    bool saved = ExportImage(img->pixels(), file.string().c_str());
+
+    if (!saved) runtime->logger->error("failed to save image '{}'", file.string());
+
+    lua_pop(L, 2);
+    lua_pushboolean(L, saved);
+
+    Orbit::profiler.close(mark);
+    return 1;
+}
+
+struct FileIO {
+    std::FILE *file;
+};
+
+inline Orbit::Lua::LuaRuntime *fio_runtime(lua_State *L) {
+    return static_cast<Orbit::Lua::LuaRuntime*>(lua_touserdata(L, lua_upvalueindex(1)));
+}
+
+inline FileIO *fio_instance(lua_State *L) {
+    return static_cast<FileIO *>(lua_touserdata(L, lua_upvalueindex(2)));
+}
+
+inline void fio_close(FileIO *fio) {
+    if (fio->file == nullptr) return;
+
+    std::fclose(fio->file);
+    fio->file = nullptr;
+}
+
+int fio_gc(lua_State *L) {
+    fio_close(static_cast<FileIO *>(luaL_checkudata(L, 1, "fileio")));
+    return 0;
+}
+
+// Opens the file at the path, relative to the output directory, for the mode.
+// Returns whether it was opened.
+bool fio_open(lua_State *L, const char *mode) {
+    auto *runtime = fio_runtime(L);
+    auto *fio = fio_instance(L);
+
+    std::filesystem::path file(luaL_checkstring(L, 1));
+    if (file.is_relative()) file = runtime->output() / file;
+
+    fio_close(fio);
+
+    std::error_code ec;
+    if (mode[0] == 'w' && file.has_parent_path()) std::filesystem::create_directories(file.parent_path(), ec);
+
+    // Director opens for reading and writing without truncating
+    if (mode[0] == 'r' && mode[1] == '+' && !std::filesystem::exists(file, ec)) mode = "w+b";
+
+    fio->file = std::fopen(file.string().c_str(), mode);
+
+    if (fio->file == nullptr) runtime->logger->error("failed to open file '{}'", file.string());
+
+    return fio->file != nullptr;
+}
+
+// fileio.createFile(path)
+int fio_create_file(lua_State *L) {
+    lua_pushboolean(L, fio_open(L, "wb"));
+    return 1;
+}
+
+// fileio.openFile(path, mode): 1 for reading, 0 or 2 for reading and writing
+int fio_open_file(lua_State *L) {
+    const auto mode = luaL_optinteger(L, 2, 0);
+
+    lua_pushboolean(L, fio_open(L, mode == 1 ? "rb" : "r+b"));
+    return 1;
+}
+
+// fileio.writeString(str)
+int fio_write_string(lua_State *L) {
+    auto *fio = fio_instance(L);
+
+    size_t length = 0;
+    const char *str = luaL_checklstring(L, 1, &length);
+
+    if (fio->file == nullptr) return luaL_error(L, "writeString: no file is open");
+
+    const bool written = std::fwrite(str, 1, length, fio->file) == length;
+    if (!written) fio_runtime(L)->logger->error("failed to write to file");
+
+    lua_pushboolean(L, written);
+    return 1;
+}
+
+// fileio.writeLingo(value), the same as writeString(toLingo(value)) without
+// the string in between
+int fio_write_lingo(lua_State *L) {
+    auto *fio = fio_instance(L);
+
+    luaL_checkany(L, 1);
+
+    if (fio->file == nullptr) return luaL_error(L, "writeLingo: no file is open");
+
+    const int top = lua_gettop(L);
+    char error[256] = "";
+
+    try {
+        Orbit::Lua::LingoWriter writer(fio->file);
+        writer.write(L, 1);
+        writer.flush();
+    } catch (const std::exception &e) {
+        std::snprintf(error, sizeof(error), "%s", e.what());
+    }
+
+    if (error[0] != '\0') {
+        lua_settop(L, top);
+        return luaL_error(L, "writeLingo: %s", error);
+    }
+
+    lua_pushboolean(L, true);
+    return 1;
+}
+
+// fileio.closeFile()
+int fio_close_file(lua_State *L) {
+    fio_close(fio_instance(L));
+    return 0;
+}
 
 int global_xtra(lua_State *L) {
     const string name(luaL_checkstring(L, 1));
@@ -16,30 +169,34 @@ int global_xtra(lua_State *L) {
     lua_newtable(L);
 
     if (name == "fileio") {
-        lua_pushcfunction(L, [](lua_State *L2) {
-            return 0;
-        });
-        lua_setfield(L, -2, "openFile");
-        lua_settable(L, -3);
-
-        lua_pushcfunction(L, [](lua_State *L2) {
-            return 0;
-        });
-        lua_setfield(L, -2, "writeString");
-        lua_settable(L, -3);
-
-        lua_pushcfunction(L, [](lua_State *L2) {
-            return 0;
-        });
-        lua_setfield(L, -2, "closeFile");
-        lua_settable(L, -3);
+        // One file per instance; the methods share it as an upvalue
+        auto *fio = static_cast<FileIO *>(lua_newuserdata(L, sizeof(FileIO)));
+        fio->file = nullptr;
+        luaL_setmetatable(L, "fileio");
+
+        const int instance = lua_gettop(L);
+
+        const std::pair<const char *, lua_CFunction> methods[] = {
+            { "createFile", fio_create_file },
+            { "openFile", fio_open_file },
+            { "writeString", fio_write_string },
+            { "writeLingo", fio_write_lingo },
+            { "closeFile", fio_close_file },
+        };
+
+        for (const auto &[method, function] : methods) {
+            lua_pushvalue(L, lua_upvalueindex(1));
+            lua_pushvalue(L, instance);
+            lua_pushcclosure(L, function, 2);
+            lua_setfield(L, -3, method);
+        }
+
+        lua_pop(L, 1);
     }
     else if (name == "ImgXtra") {
-        lua_pushcfunction(L, [](lua_State *L2) {
-            return 0;
-        });
+        lua_pushvalue(L, lua_upvalueindex(1));
+        lua_pushcclosure(L, ix_save_image, 1);
         lua_setfield(L, -2, "ix_saveImage");
-        lua_settable(L, -3);
     }
 
     return 1;
@@ -48,8 +205,14 @@ int global_xtra(lua_State *L) {
 namespace Orbit::Lua {
 
 void LuaRuntime::_register_xtra() {
-    lua_pushcfunction(L, global_xtra);
+    luaL_newmetatable(L, "fileio");
+    lua_pushcfunction(L, fio_gc);
+    lua_setfield(L, -2, "__gc");
+    lua_pop(L, 1);
+
+    lua_pushlightuserdata(L, this);
+    lua_pushcclosure(L, global_xtra, 1);
     lua_setglobal(L, "xtra");
 }
 
-};
\ No newline at end of file
+};